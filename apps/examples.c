@@ -1,6 +1,7 @@
 #include "apps.h"
 #include "../gui/gui.h"
 #include "../fs/fs.h"
+#include "../kernel/init.h"
 #include <stdio.h>
 
 // 示例应用程序：简单的文件管理器
@@ -303,23 +304,18 @@ void start_system_info(void) {
 void launch_desktop_apps(void) {
     printf("启动桌面应用程序...\n");
     
-    // 等待GUI系统完全初始化
-    for (int i = 0; i < 10; i++) {
-        sleep(100);
+    // 等待GUI系统就绪 (不在初始化图中运行时立即返回)
+    if (init_wait("gui") == INIT_FAILED) {
+        printf("图形界面初始化失败，不启动桌面应用程序\n");
+        return;
     }
     
     // 启动系统信息查看器
     start_system_info();
     
-    // 等待一下再启动其他应用
-    sleep(500);
-    
-    // 启动文件管理器
+    // 启动文件管理器 (窗口创建是同步的，不需要等待前一个应用)
     start_file_manager();
     
-    // 等待一下再启动文本编辑器
-    sleep(500);
-    
     // 启动文本编辑器
     start_text_editor();
     
@@ -1,4 +1,7 @@
 #include "boot.h"
+#include "../kernel/kernel.h"
+#include "../kernel/clock.h"
+#include "../kernel/boottime.h"
 
 // 简单的 VGA 文本模式输出
 #define VGA_TEXT_ADDR        0xB8000
@@ -28,6 +31,30 @@ static int vga_x = 0;
 static int vga_y = 0;
 static boot_info_t boot_info;
 
+// 引导加载程序传入的魔术字和信息结构地址
+static u32 loader_magic __attribute__((used));
+static u32 loader_info __attribute__((used));
+
+// Multiboot 头 (必须位于内核映像前 8KB)
+static const u32 multiboot_header[3] __attribute__((section(".kernel_start"), used, aligned(4))) = {
+    MULTIBOOT_HEADER_MAGIC,
+    MULTIBOOT_HEADER_FLAGS,
+    -(MULTIBOOT_HEADER_MAGIC + MULTIBOOT_HEADER_FLAGS)
+};
+
+// 内核入口: 建立栈，保存 EAX/EBX 后进入 boot_main
+__asm__ (
+    ".section .text\n"
+    ".global _start\n"
+    "_start:\n"
+    "    movl $__stack_end, %esp\n"
+    "    movl %eax, loader_magic\n"
+    "    movl %ebx, loader_info\n"
+    "    call boot_main\n"
+    "1:  hlt\n"
+    "    jmp 1b\n"
+);
+
 // 内联汇编宏
 #define PORT_OUTB(port, value) __asm__ __volatile__ ("outb %0, %1" : : "a"(value), "Nd"(port))
 #define PORT_INB(port) __asm__ __volatile__ ("inb %1, %0" : "=a"(value) : "Nd"(port))
@@ -117,22 +144,32 @@ void boot_print_dec(uint32_t value) {
     }
 }
 
-// 延迟函数
+// 延迟函数 (只用于硬件确实需要等待的场合，启动路径上不使用)
 void boot_delay(uint32_t ms) {
-    // 简单的忙等待延迟
-    for (uint32_t i = 0; i < ms * 1000; i++) {
-        __asm__ __volatile__ ("nop");
-    }
+    // 按校准过的 TSC 忙等待，与 CPU 主频无关
+    clock_delay_ns((u64)ms * NSEC_PER_MSEC);
 }
 
 // 内存检测函数
 static void detect_memory(void) {
     boot_print("检测内存...\n");
     
-    // 简化实现，假设有 64MB 内存
-    boot_info.mem_lower = 640;     // 640KB 低内存
-    boot_info.mem_upper = 63488;   // 62MB 高内存
-    boot_info.flags |= BOOT_FLAG_MEM_INFO;
+    // 复制引导加载程序提供的信息 (其结构不含魔术字字段)
+    if (loader_magic == BOOT_MAGIC && loader_info) {
+        const u32* src = (const u32*)loader_info;
+        u32* dst = &boot_info.flags;
+        for (u32 i = 0; i < sizeof(boot_info_t) / sizeof(u32) - 1; i++) {
+            dst[i] = src[i];
+        }
+        boot_info.magic = loader_magic;
+    }
+    
+    if (!(boot_info.flags & BOOT_FLAG_MEM_INFO)) {
+        // 没有引导信息时假设有 64MB 内存
+        boot_info.mem_lower = 640;     // 640KB 低内存
+        boot_info.mem_upper = 63488;   // 62MB 高内存
+        boot_info.flags |= BOOT_FLAG_MEM_INFO;
+    }
     
     boot_print("低内存: ");
     boot_print_dec(boot_info.mem_lower);
@@ -141,6 +178,36 @@ static void detect_memory(void) {
     boot_print("高内存: ");
     boot_print_dec(boot_info.mem_upper);
     boot_print(" KB\n");
+    
+    if (!(boot_info.flags & BOOT_FLAG_MMAP)) {
+        boot_print("无内存映射表\n");
+        return;
+    }
+    
+    // 打印内存映射表
+    u32 available_kb = 0;
+    u32 addr = boot_info.mmap_addr;
+    while (addr < boot_info.mmap_addr + boot_info.mmap_length) {
+        const mmap_entry_t* entry = (const mmap_entry_t*)addr;
+        boot_print_hex((u32)entry->base_addr);
+        boot_print(" ");
+        boot_print_dec((u32)(entry->length >> 10));
+        boot_print(" KB 类型 ");
+        boot_print_dec(entry->type);
+        boot_print("\n");
+        if (entry->type == MMAP_TYPE_AVAILABLE) {
+            available_kb += (u32)(entry->length >> 10);
+        }
+        addr += entry->size + sizeof(entry->size);
+    }
+    
+    boot_print("可用内存: ");
+    boot_print_dec(available_kb);
+    boot_print(" KB\n");
+}
+
+const boot_info_t* boot_get_info(void) {
+    return &boot_info;
 }
 
 // CPU 检测函数
@@ -326,26 +393,33 @@ void boot_init(void) {
     boot_print("QiYuanOS 引导加载程序 v1.0\n");
     boot_print("================================\n");
     
+    // 设置引导信息默认值 (detect_memory 会用引导加载程序的信息覆盖)
+    boot_info.magic = BOOT_MAGIC;
+    boot_info.flags = 0;
+    boot_info.boot_device = 0x80; // 第一个硬盘
+    boot_info.cmdline = 0;
+    boot_info.mods_count = 0;
+    boot_info.mods_addr = 0;
+    
+    // 先校准时钟: 之后的延迟和各阶段的时间戳都以它为准
+    clock_init();
+    boottime_mark("clock");
+    
     // 检测硬件
     detect_memory();
+    boottime_mark("detect_memory");
     detect_cpu();
+    boottime_mark("detect_cpu");
     
     // 启用 A20 地址线
     enable_a20();
+    boottime_mark("a20");
     
     // 设置 GDT
     setup_gdt();
-    
-    // 设置引导信息
-    boot_info.magic = BOOT_MAGIC;
-    boot_info.flags = 0;
-    boot_info.boot_device = 0x80; // 第一个硬盘
-    boot_info.cmdline = 0;
-    boot_info.mods_count = 0;
-    boot_info.mods_addr = 0;
+    boottime_mark("gdt");
     
     boot_print("\n引导初始化完成\n");
-    boot_delay(1000);
 }
 
 // 系统重启
@@ -399,7 +473,6 @@ void boot_main(void) {
     boot_init();
     
     boot_print("\n准备加载内核...\n");
-    boot_delay(1000);
     
     // 调用内核初始化函数
     boot_print("调用内核初始化...\n");
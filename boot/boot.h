@@ -35,7 +35,15 @@ typedef struct {
     uint64_t base_addr;      // 基地址
     uint64_t length;         // 长度
     uint32_t type;           // 类型
-} mmap_entry_t;
+} __attribute__((packed)) mmap_entry_t;
+
+// 模块条目
+typedef struct {
+    uint32_t mod_start;      // 模块起始地址
+    uint32_t mod_end;        // 模块结束地址
+    uint32_t string;         // 模块命令行
+    uint32_t reserved;
+} module_entry_t;
 
 // 内存类型
 #define MMAP_TYPE_AVAILABLE   1
@@ -47,6 +55,10 @@ typedef struct {
 // 引导魔术字
 #define BOOT_MAGIC            0x2BADB002
 
+// Multiboot 头
+#define MULTIBOOT_HEADER_MAGIC 0x1BADB002
+#define MULTIBOOT_HEADER_FLAGS 0x00000003  // 页对齐模块 + 内存信息
+
 // 引导标志
 #define BOOT_FLAG_MEM_INFO    0x00000001
 #define BOOT_FLAG_BOOT_DEV    0x00000002
@@ -69,6 +81,7 @@ void boot_print_dec(uint32_t value);
 void boot_delay(uint32_t ms);
 void boot_reboot(void);
 void boot_shutdown(void);
+const boot_info_t* boot_get_info(void);
 
 // 内核入口点声明
 void kernel_main(void);
@@ -0,0 +1,86 @@
+#include "blkdev.h"
+#include "../kernel/mm.h"
+#include "../kernel/spinlock.h"
+#include "../boot/boot.h"
+#include <string.h>
+#include <stdio.h>
+
+// 块设备注册表 (设备只增不减)
+static block_device_t* devices = NULL;
+static spinlock_t devices_lock = SPINLOCK_INIT;
+
+int blkdev_register(block_device_t* dev) {
+    u32 flags = spin_lock_irqsave(&devices_lock);
+    for (block_device_t* other = devices; other; other = other->next) {
+        if (strcmp(other->name, dev->name) == 0) {
+            spin_unlock_irqrestore(&devices_lock, flags);
+            return -1;
+        }
+    }
+    dev->next = devices;
+    devices = dev;
+    spin_unlock_irqrestore(&devices_lock, flags);
+    printf("块设备 %s: %u 块 (%u KB)\n", dev->name, dev->nr_blocks, dev->nr_blocks * (BLKDEV_BLOCK_SIZE / 1024));
+    return 0;
+}
+
+block_device_t* blkdev_find(const char* name) {
+    name = blkdev_basename(name);
+    u32 flags = spin_lock_irqsave(&devices_lock);
+    block_device_t* dev = devices;
+    while (dev && strcmp(dev->name, name) != 0) {
+        dev = dev->next;
+    }
+    spin_unlock_irqrestore(&devices_lock, flags);
+    return dev;
+}
+
+// 内存盘
+static block_device_t ram0;
+
+static int ramdisk_read(block_device_t* dev, u32 block, u32 count, void* buffer) {
+    if (block > dev->nr_blocks || count > dev->nr_blocks - block) {
+        return -1;
+    }
+    memcpy(buffer, (u8*)dev->data + (block << BLKDEV_BLOCK_SHIFT), count << BLKDEV_BLOCK_SHIFT);
+    return 0;
+}
+
+static int ramdisk_write(block_device_t* dev, u32 block, u32 count, const void* buffer) {
+    if (block > dev->nr_blocks || count > dev->nr_blocks - block) {
+        return -1;
+    }
+    memcpy((u8*)dev->data + (block << BLKDEV_BLOCK_SHIFT), buffer, count << BLKDEV_BLOCK_SHIFT);
+    return 0;
+}
+
+int ramdisk_init(u32 blocks) {
+    const boot_info_t* info = boot_get_info();
+    int blank = 0;
+
+    strcpy(ram0.name, "ram0");
+    ram0.read = ramdisk_read;
+    ram0.write = ramdisk_write;
+
+    // multiboot 模块已由页分配器保留，且在直接映射范围内
+    if ((info->flags & BOOT_FLAG_MODS) && info->mods_count > 0) {
+        const module_entry_t* mod = (const module_entry_t*)info->mods_addr;
+        ram0.data = (void*)mod->mod_start;
+        ram0.nr_blocks = (mod->mod_end - mod->mod_start) >> BLKDEV_BLOCK_SHIFT;
+        printf("内存盘: 使用引导模块 %p - %p\n", (void*)mod->mod_start, (void*)mod->mod_end);
+    } else {
+        ram0.data = page_alloc(size_to_order(blocks << BLKDEV_BLOCK_SHIFT));
+        if (!ram0.data) {
+            printf("内存盘: 无法分配 %u 块\n", blocks);
+            return -1;
+        }
+        ram0.nr_blocks = blocks;
+        memset(ram0.data, 0, blocks << BLKDEV_BLOCK_SHIFT);
+        blank = 1;
+    }
+
+    if (ram0.nr_blocks == 0 || blkdev_register(&ram0) < 0) {
+        return -1;
+    }
+    return blank;
+}
@@ -0,0 +1,37 @@
+#ifndef BLKDEV_H
+#define BLKDEV_H
+
+#include "../kernel/kernel.h"
+
+// 块设备: 以 4KB 块为单位读写，按名字查找 (例如 "ram0")
+#define BLKDEV_BLOCK_SHIFT  12
+#define BLKDEV_BLOCK_SIZE   (1u << BLKDEV_BLOCK_SHIFT)
+#define BLKDEV_NAME_LEN     16
+
+typedef struct block_device {
+    char name[BLKDEV_NAME_LEN];
+    u32 nr_blocks;
+    // 读写 count 个连续块，成功返回 0
+    int (*read)(struct block_device* dev, u32 block, u32 count, void* buffer);
+    int (*write)(struct block_device* dev, u32 block, u32 count, const void* buffer);
+    void* data;
+    struct block_device* next;
+} block_device_t;
+
+int blkdev_register(block_device_t* dev);
+block_device_t* blkdev_find(const char* name);
+
+// 接受 "/dev/ram0" 或 "ram0" 形式的名字
+static inline const char* blkdev_basename(const char* name) {
+    if (name[0] == '/' && name[1] == 'd' && name[2] == 'e' && name[3] == 'v' && name[4] == '/') {
+        return name + 5;
+    }
+    return name;
+}
+
+// 内存盘: 以 multiboot 模块 (或新分配的内存) 为存储。
+// 第一个模块成为 ram0；没有模块时分配 blocks 个块的空盘，返回 1 表示需要格式化。
+// 失败返回 -1
+int ramdisk_init(u32 blocks);
+
+#endif // BLKDEV_H
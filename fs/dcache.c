@@ -0,0 +1,369 @@
+#include "dcache.h"
+#include "mount.h"
+#include "../kernel/mm.h"
+#include "../kernel/spinlock.h"
+#include "../kernel/serial.h"
+#include <string.h>
+#include <stdio.h>
+
+// 全部状态由 dcache_lock 保护
+static dentry_t root_dentry;
+static dentry_t* hash_table[DCACHE_HASH_SIZE];
+static dentry_t* lru_head = NULL;
+static dentry_t* lru_tail = NULL;
+static dcache_stats_t stats;
+static spinlock_t dcache_lock = SPINLOCK_INIT;
+
+// 标记为需要重新 stat (调用者持有 dcache_lock)
+static void d_invalidate(dentry_t* dentry) {
+    dentry->flags &= ~DENTRY_VALID;
+    dentry->generation++;
+}
+
+static u32 name_hash(const dentry_t* parent, const char* name, u32 len) {
+    u32 hash = 2166136261u ^ ((u32)parent >> 4); // FNV-1a，以父 dentry 为种子
+    for (u32 i = 0; i < len; i++) {
+        hash = (hash ^ (u8)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static dentry_t** hash_bucket(u32 hash) {
+    return &hash_table[(hash ^ (hash >> 16)) & (DCACHE_HASH_SIZE - 1)];
+}
+
+static void lru_remove(dentry_t* dentry) {
+    if (dentry->lru_prev) {
+        dentry->lru_prev->lru_next = dentry->lru_next;
+    } else {
+        lru_head = dentry->lru_next;
+    }
+    if (dentry->lru_next) {
+        dentry->lru_next->lru_prev = dentry->lru_prev;
+    } else {
+        lru_tail = dentry->lru_prev;
+    }
+}
+
+static void lru_push(dentry_t* dentry) {
+    dentry->lru_prev = NULL;
+    dentry->lru_next = lru_head;
+    if (lru_head) {
+        lru_head->lru_prev = dentry;
+    } else {
+        lru_tail = dentry;
+    }
+    lru_head = dentry;
+}
+
+void dcache_init(void) {
+    u32 flags = spin_lock_irqsave(&dcache_lock);
+    memset(&root_dentry, 0, sizeof(dentry_t));
+    root_dentry.name = "/";
+    root_dentry.name_len = 1;
+    root_dentry.refcount = 1; // 根目录常驻，不进入 LRU
+    spin_unlock_irqrestore(&dcache_lock, flags);
+}
+
+static dentry_t* d_lookup(dentry_t* parent, const char* name, u32 len) {
+    u32 hash = name_hash(parent, name, len);
+    for (dentry_t* dentry = *hash_bucket(hash); dentry; dentry = dentry->hash_next) {
+        if (dentry->hash == hash && dentry->parent == parent && dentry->name_len == len &&
+            memcmp(dentry->name, name, len) == 0) {
+            return dentry;
+        }
+    }
+    return NULL;
+}
+
+static void d_free(dentry_t* dentry) {
+    dentry_t** link = hash_bucket(dentry->hash);
+    while (*link != dentry) {
+        link = &(*link)->hash_next;
+    }
+    *link = dentry->hash_next;
+    lru_remove(dentry);
+    if ((dentry->flags & DENTRY_NEGATIVE)) {
+        stats.nr_negative--;
+    }
+    dentry->parent->refcount--;
+    stats.nr_entries--;
+    kfree(dentry->name);
+    kfree(dentry);
+}
+
+// 从 LRU 表尾回收没有引用的 dentry (叶子)，直到数量回到上限以下
+static void d_reclaim(void) {
+    dentry_t* dentry = lru_tail;
+    while (dentry && stats.nr_entries >= DCACHE_MAX_ENTRIES) {
+        dentry_t* prev = dentry->lru_prev;
+        if (dentry->refcount == 0) {
+            d_free(dentry);
+            stats.reclaimed++;
+        }
+        dentry = prev;
+    }
+}
+
+static dentry_t* d_alloc(dentry_t* parent, const char* name, u32 len) {
+    parent->refcount++; // 先算上新的子项，回收时不会释放父目录
+    if (stats.nr_entries >= DCACHE_MAX_ENTRIES) {
+        d_reclaim(); // 都在使用中时允许暂时超过上限
+    }
+    dentry_t* dentry = kmalloc_tagged(sizeof(dentry_t), KMEM_FS);
+    char* copy = kmalloc_tagged(len + 1, KMEM_FS);
+    if (!dentry || !copy) {
+        kfree(dentry);
+        kfree(copy);
+        parent->refcount--;
+        return NULL;
+    }
+    memset(dentry, 0, sizeof(dentry_t));
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+    dentry->parent = parent;
+    dentry->name = copy;
+    dentry->name_len = len;
+    dentry->hash = name_hash(parent, name, len);
+    dentry_t** bucket = hash_bucket(dentry->hash);
+    dentry->hash_next = *bucket;
+    *bucket = dentry;
+    lru_push(dentry);
+    stats.nr_entries++;
+    return dentry;
+}
+
+static void set_negative(dentry_t* dentry, int negative) {
+    if (negative && !(dentry->flags & DENTRY_NEGATIVE)) {
+        stats.nr_negative++;
+    } else if (!negative && (dentry->flags & DENTRY_NEGATIVE)) {
+        stats.nr_negative--;
+    }
+    dentry->flags = DENTRY_VALID | (negative ? DENTRY_NEGATIVE : 0);
+}
+
+// 确定 dentry 所在的挂载，向文件系统查询 path 并更新 dentry。
+// 调用者持有 dcache_lock (*flags 是加锁时保存的中断状态) 和 dentry 的引用；
+// 查询文件系统期间释放锁，其他路径解析不必等待，返回时已重新加锁
+static void d_revalidate(dentry_t* dentry, const char* path, dcache_stat_t stat, u32* flags) {
+    dir_entry_t st;
+    mount_t* mount = mount_find(path);
+    if (!mount && dentry->parent) {
+        mount = dentry->parent->mount;
+    }
+    if (mount && !mount_get(mount)) {
+        mount = NULL; // 正在卸载
+    }
+    u32 generation = dentry->generation;
+    stats.misses++;
+
+    spin_unlock_irqrestore(&dcache_lock, *flags);
+    int found = mount && stat(mount, path, &st) >= 0;
+    *flags = spin_lock_irqsave(&dcache_lock);
+
+    // 期间另一次解析已经更新过 (它的结果不比这次旧)
+    if (dentry->flags & DENTRY_VALID) {
+        if (mount) {
+            mount_put(mount);
+        }
+        return;
+    }
+    dentry->mount = mount;
+    if (mount) {
+        mount_put(mount); // dentry 不持有挂载的引用，卸载时会使全部 dentry 失效
+    }
+    set_negative(dentry, !found);
+    if (found) {
+        dentry->inode = st.inode;
+        dentry->type = st.type;
+        dentry->permissions = st.permissions;
+        dentry->size = st.size;
+        dentry->create_time = st.create_time;
+        dentry->modify_time = st.modify_time;
+        dentry->access_time = st.access_time;
+    }
+    // 查询期间又失效了: 本次解析使用这个结果，下次仍要重新查询
+    if (dentry->generation != generation) {
+        dentry->flags &= ~DENTRY_VALID;
+    }
+}
+
+dentry_t* dcache_walk(char* path, dcache_stat_t stat, struct mount** mount) {
+    u32 flags = spin_lock_irqsave(&dcache_lock);
+    dentry_t* dentry = &root_dentry;
+    if (!(dentry->flags & DENTRY_VALID)) {
+        d_revalidate(dentry, "/", stat, &flags); // 根目录常驻，不需要另加引用
+    }
+
+    char* p = path + 1;
+    while (*p) {
+        if ((dentry->flags & DENTRY_NEGATIVE) || dentry->type != FS_TYPE_DIR) {
+            dentry = NULL; // 中间的分量不存在或不是目录
+            break;
+        }
+        char* end = p;
+        while (*end && *end != '/') {
+            end++;
+        }
+        u32 len = end - p;
+
+        stats.lookups++;
+        dentry_t* child = d_lookup(dentry, p, len);
+        if (!child) {
+            child = d_alloc(dentry, p, len);
+            if (!child) {
+                dentry = NULL;
+                break;
+            }
+        }
+        if (child->flags & DENTRY_VALID) {
+            stats.hits++;
+            if (child->flags & DENTRY_NEGATIVE) {
+                stats.negative_hits++;
+            }
+        } else {
+            // 释放锁期间靠这个引用保住 child (以及它的父目录) 不被回收
+            child->refcount++;
+            char saved = *end;
+            *end = '\0';
+            d_revalidate(child, path, stat, &flags);
+            *end = saved;
+            child->refcount--;
+        }
+        if (child != lru_head) {
+            lru_remove(child);
+            lru_push(child);
+        }
+        dentry = child;
+        p = *end ? end + 1 : end;
+    }
+    if (mount) {
+        // 挂载正在卸载时取不到引用 (卸载随后会使全部 dentry 失效)
+        *mount = dentry && dentry->mount && mount_get(dentry->mount) ? dentry->mount : NULL;
+    }
+    if (dentry) {
+        dentry->refcount++;
+    }
+    spin_unlock_irqrestore(&dcache_lock, flags);
+    return dentry;
+}
+
+void dcache_put(dentry_t* dentry) {
+    u32 flags = spin_lock_irqsave(&dcache_lock);
+    dentry->refcount--;
+    spin_unlock_irqrestore(&dcache_lock, flags);
+}
+
+int dcache_fill_stat(dentry_t* dentry, dir_entry_t* stat) {
+    u32 flags = spin_lock_irqsave(&dcache_lock);
+    if (dentry->flags & DENTRY_NEGATIVE) {
+        spin_unlock_irqrestore(&dcache_lock, flags);
+        return -1;
+    }
+    strcpy(stat->name, dentry->name);
+    stat->inode = dentry->inode;
+    stat->type = dentry->type;
+    stat->permissions = dentry->permissions;
+    stat->size = dentry->size;
+    stat->create_time = dentry->create_time;
+    stat->modify_time = dentry->modify_time;
+    stat->access_time = dentry->access_time;
+    spin_unlock_irqrestore(&dcache_lock, flags);
+    return 0;
+}
+
+void dcache_invalidate(dentry_t* dentry) {
+    u32 flags = spin_lock_irqsave(&dcache_lock);
+    d_invalidate(dentry);
+    spin_unlock_irqrestore(&dcache_lock, flags);
+}
+
+static int is_ancestor(dentry_t* ancestor, dentry_t* dentry) {
+    for (; dentry; dentry = dentry->parent) {
+        if (dentry == ancestor) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void dcache_invalidate_path(const char* path) {
+    u32 flags = spin_lock_irqsave(&dcache_lock);
+    // 只在缓存中查找，不调用文件系统
+    dentry_t* dentry = &root_dentry;
+    const char* p = path + 1;
+    while (*p && dentry) {
+        const char* end = p;
+        while (*end && *end != '/') {
+            end++;
+        }
+        dentry_t* child = d_lookup(dentry, p, end - p);
+        if (!child) {
+            d_invalidate(dentry); // 父目录的大小等属性也变了
+            dentry = NULL;
+            break;
+        }
+        if (!*end) {
+            d_invalidate(dentry);
+        }
+        dentry = child;
+        p = *end ? end + 1 : end;
+    }
+
+    // 改名和删除不频繁，直接扫描全部 dentry 找后代
+    if (dentry) {
+        d_invalidate(dentry);
+        for (dentry_t* other = lru_head; other; other = other->lru_next) {
+            if (is_ancestor(dentry, other)) {
+                d_invalidate(other);
+            }
+        }
+    }
+    spin_unlock_irqrestore(&dcache_lock, flags);
+}
+
+void dcache_invalidate_all(void) {
+    u32 flags = spin_lock_irqsave(&dcache_lock);
+    d_invalidate(&root_dentry);
+    for (dentry_t* dentry = lru_head; dentry; dentry = dentry->lru_next) {
+        d_invalidate(dentry);
+    }
+    spin_unlock_irqrestore(&dcache_lock, flags);
+}
+
+void dcache_get_stats(dcache_stats_t* out) {
+    u32 flags = spin_lock_irqsave(&dcache_lock);
+    *out = stats;
+    spin_unlock_irqrestore(&dcache_lock, flags);
+}
+
+void dcache_dump(void) {
+    char line[128];
+    dcache_stats_t st;
+    dcache_get_stats(&st);
+
+    // 命中率 (千分比)，避免 u32 乘法溢出
+    u32 hits = st.hits;
+    u32 total = st.lookups;
+    while (total > 0x3FFFFF) {
+        hits >>= 1;
+        total >>= 1;
+    }
+    u32 ratio = total ? hits * 1000 / total : 0;
+
+    snprintf(line, sizeof(line), "dcache: %u/%u 个 dentry (负 %u), 回收 %u\n",
+             st.nr_entries, DCACHE_MAX_ENTRIES, st.nr_negative, st.reclaimed);
+    serial_puts(line);
+    snprintf(line, sizeof(line), "dcache: 解析 %u 个分量, 命中 %u (负 %u), stat %u 次, 命中率 %u.%u%%\n",
+             st.lookups, st.hits, st.negative_hits, st.misses, ratio / 10, ratio % 10);
+    serial_puts(line);
+}
+
+static void dcache_command(char key) {
+    (void)key;
+    dcache_dump();
+}
+
+void dcache_debug_init(void) {
+    serial_register_command('n', dcache_command);
+}
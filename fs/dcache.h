@@ -0,0 +1,83 @@
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include "fs.h"
+
+struct mount;
+
+// 目录项缓存: 每个解析过的路径分量一个 dentry，按 (父 dentry, 名字) 散列。
+// 不存在的名字也缓存 (负 dentry)，重复解析同一路径只查散列表，不调用文件系统。
+// 数量超过 DCACHE_MAX_ENTRIES 时从 LRU 表尾回收没有引用的 dentry。
+// 每个 dentry 还缓存它所在的挂载: 挂载点上的 dentry 属于挂在那里的文件系统，
+// 其他 dentry 与父目录相同，所以解析一条路径就确定了它的挂载 (最长前缀)。
+// 文件系统回调在 dcache 锁之外调用，缓存未命中不会阻塞其他 CPU 上的路径解析。
+
+#define DCACHE_HASH_SIZE    256         // 必须是 2 的幂
+#define DCACHE_MAX_ENTRIES  512
+
+// dentry 标志
+#define DENTRY_VALID        0x01        // 存在与否和属性与文件系统一致 (否则下次解析时重新 stat)
+#define DENTRY_NEGATIVE     0x02        // 文件不存在
+
+typedef struct dentry {
+    struct dentry* parent;
+    struct dentry* hash_next;
+    struct dentry* lru_prev;            // 全部 dentry 按最近使用排列 (表头最新)
+    struct dentry* lru_next;
+    char* name;
+    u32 name_len;
+    u32 hash;
+    u32 refcount;                       // 子 dentry 数 + 使用者 (打开的文件等)
+    u32 flags;                          // DENTRY_*
+    struct mount* mount;                // 所在的挂载 (DENTRY_VALID 时有效，可能为 NULL)
+    u32 generation;                     // 每次失效加一: 持有引用者据此发现内容或属性改变过
+    // 属性 (DENTRY_VALID 且不是负 dentry 时有效)
+    u32 inode;
+    u8 type;
+    u32 permissions;
+    u64 size;
+    u64 create_time;
+    u64 modify_time;
+    u64 access_time;
+} dentry_t;
+
+// 在 mount 中查询 path (完整路径) 的属性，不存在时返回 -1
+typedef int (*dcache_stat_t)(struct mount* mount, const char* path, dir_entry_t* stat);
+
+typedef struct {
+    u32 nr_entries;
+    u32 nr_negative;
+    u32 lookups;                        // 解析的路径分量数
+    u32 hits;                           // 不需要调用文件系统的分量 (包括负 dentry)
+    u32 negative_hits;
+    u32 misses;                         // 调用 stat 的次数
+    u32 reclaimed;
+} dcache_stats_t;
+
+void dcache_init(void);
+
+// 解析已标准化的绝对路径 (见 fs_normalize_path)，返回最后一个分量的 dentry 并加一次引用，
+// 它可能是负 dentry。中间的分量不存在或不是目录时返回 NULL。
+// mount 不为 NULL 时还返回它所在的挂载并加一次引用 (没有挂载时为 NULL，用 mount_put 释放)。
+// 解析过程中 path 被临时截断以向文件系统查询前缀，返回时恢复原样
+dentry_t* dcache_walk(char* path, dcache_stat_t stat, struct mount** mount);
+void dcache_put(dentry_t* dentry);
+
+// 用缓存的属性填写 stat，负 dentry 返回 -1
+int dcache_fill_stat(dentry_t* dentry, dir_entry_t* stat);
+
+// 文件内容或属性改变: 下次解析时重新 stat
+void dcache_invalidate(dentry_t* dentry);
+
+// 路径被创建、删除或改名: 它 (如果缓存了)、它的全部后代和父目录下次解析时重新 stat
+void dcache_invalidate_path(const char* path);
+
+// 全部重新 stat
+void dcache_invalidate_all(void);
+
+// 统计
+void dcache_get_stats(dcache_stats_t* stats);
+void dcache_dump(void);                 // 输出到串口
+void dcache_debug_init(void);           // 注册串口命令 n
+
+#endif // DCACHE_H
@@ -0,0 +1,139 @@
+#include "file.h"
+#include "mount.h"
+#include "dcache.h"
+#include "../kernel/mm.h"
+#include <string.h>
+
+file_t* file_alloc(mount_t* mount, void* inode, dentry_t* dentry, u32 flags) {
+    file_t* file = kmalloc_tagged(sizeof(file_t), KMEM_FS);
+    if (!file) {
+        return NULL;
+    }
+    memset(file, 0, sizeof(file_t));
+    file->mount = mount;
+    file->inode = inode;
+    file->dentry = dentry;
+    file->flags = flags;
+    file->refcount = 1;
+    file->lock = (spinlock_t)SPINLOCK_INIT;
+    return file;
+}
+
+void file_get(file_t* file) {
+    __sync_fetch_and_add(&file->refcount, 1);
+}
+
+void file_put(file_t* file) {
+    if (__sync_sub_and_fetch(&file->refcount, 1) > 0) {
+        return;
+    }
+    mount_t* mount = file->mount;
+    if (mount->fs->ops->close) {
+        mount->fs->ops->close(mount->data, file->inode);
+    }
+    dcache_put(file->dentry);
+    mount_put(mount);
+    kfree(file);
+}
+
+// 分配 size 个描述符的数组和位图 (保留的描述符标记为已占用)
+static int table_alloc(fd_table_t* table, u32 size) {
+    table->files = kmalloc_tagged(size * sizeof(file_t*), KMEM_FS);
+    table->open_map = kmalloc_tagged(size / 8, KMEM_FS);
+    if (!table->files || !table->open_map) {
+        kfree(table->files);
+        kfree(table->open_map);
+        return -1;
+    }
+    memset(table->files, 0, size * sizeof(file_t*));
+    memset(table->open_map, 0, size / 8);
+    table->open_map[0] = (1u << FD_RESERVED) - 1;
+    table->size = size;
+    table->first_free = 0;
+    return 0;
+}
+
+fd_table_t* fd_table_create(void) {
+    fd_table_t* table = kmalloc_tagged(sizeof(fd_table_t), KMEM_FS);
+    if (table && table_alloc(table, FD_TABLE_MIN) < 0) {
+        kfree(table);
+        return NULL;
+    }
+    return table;
+}
+
+void fd_table_destroy(fd_table_t* table) {
+    for (u32 fd = 0; fd < table->size; fd++) {
+        if (table->files[fd]) {
+            file_put(table->files[fd]);
+        }
+    }
+    kfree(table->files);
+    kfree(table->open_map);
+    kfree(table);
+}
+
+fd_table_t* fd_table_fork(fd_table_t* table) {
+    fd_table_t* copy = kmalloc_tagged(sizeof(fd_table_t), KMEM_FS);
+    if (!copy || table_alloc(copy, table->size) < 0) {
+        kfree(copy);
+        return NULL;
+    }
+    memcpy(copy->files, table->files, table->size * sizeof(file_t*));
+    memcpy(copy->open_map, table->open_map, table->size / 8);
+    copy->first_free = table->first_free;
+    for (u32 fd = 0; fd < table->size; fd++) {
+        if (copy->files[fd]) {
+            file_get(copy->files[fd]);
+        }
+    }
+    return copy;
+}
+
+// 容量加倍，已有的描述符不变
+static int table_grow(fd_table_t* table) {
+    if (table->size >= FD_TABLE_MAX) {
+        return -1;
+    }
+    fd_table_t bigger;
+    if (table_alloc(&bigger, table->size * 2) < 0) {
+        return -1;
+    }
+    memcpy(bigger.files, table->files, table->size * sizeof(file_t*));
+    memcpy(bigger.open_map, table->open_map, table->size / 8);
+    bigger.first_free = table->first_free;
+    kfree(table->files);
+    kfree(table->open_map);
+    *table = bigger;
+    return 0;
+}
+
+int fd_install(fd_table_t* table, file_t* file) {
+    // first_free 之前的字都已占满，从它开始找第一个有空位的字
+    u32 word = table->first_free;
+    while (word < table->size / 32 && table->open_map[word] == 0xFFFFFFFF) {
+        word++;
+    }
+    table->first_free = word;
+    if (word == table->size / 32 && table_grow(table) < 0) {
+        return -1;
+    }
+
+    int fd = word * 32 + __builtin_ctz(~table->open_map[word]);
+    table->open_map[word] |= 1u << (fd & 31);
+    table->files[fd] = file;
+    return fd;
+}
+
+file_t* fd_remove(fd_table_t* table, int fd) {
+    file_t* file = fd_lookup(table, fd);
+    if (!file) {
+        return NULL;
+    }
+    table->files[fd] = NULL;
+    table->open_map[fd / 32] &= ~(1u << (fd & 31));
+    if ((u32)fd / 32 < table->first_free) {
+        table->first_free = fd / 32;
+    }
+    return file;
+}
@@ -0,0 +1,58 @@
+#ifndef FILE_H
+#define FILE_H
+
+#include "fs.h"
+#include "../kernel/spinlock.h"
+
+struct mount;
+struct dentry;
+
+// 打开的文件: 由 fs_open 创建，可以被多个描述符共享 (fork 之后父子任务共用读写位置)
+typedef struct file {
+    struct mount* mount;
+    void* inode;                // 文件系统的 inode (ops->open 返回)
+    struct dentry* dentry;      // 写入后使缓存的属性失效
+    u32 flags;                  // 打开方式 (FS_PERM_* | FS_OPEN_*)
+    u64 position;
+    u32 refcount;               // 描述符和内核中的使用者
+    spinlock_t lock;            // 保护 position，读写期间持有，使定位和读写连续执行
+} file_t;
+
+// 取得 inode 的引用之后建立文件，它接管 mount、inode 和 dentry 的引用
+file_t* file_alloc(struct mount* mount, void* inode, struct dentry* dentry, u32 flags);
+void file_get(file_t* file);
+void file_put(file_t* file);            // 最后一个引用消失时关闭 inode 并释放引用
+
+// 每个任务的文件描述符表
+// 描述符是 files 的下标，查找只需一次数组访问；open_map 记录已占用的描述符，
+// 按位图找最小的空闲描述符。表满时容量加倍 (最多 FD_TABLE_MAX)。
+// 描述符表只由所属任务自己访问 (fork 时由父任务复制)，不需要锁。
+
+#define FD_TABLE_MIN    32              // 初始容量 (32 的倍数)
+#define FD_TABLE_MAX    65536
+#define FD_RESERVED     3               // 0-2 留给标准输入输出
+
+typedef struct fd_table {
+    file_t** files;
+    u32* open_map;              // 每位对应一个描述符
+    u32 size;                   // 容量
+    u32 first_free;             // open_map 中此前的字都已占满
+} fd_table_t;
+
+fd_table_t* fd_table_create(void);
+void fd_table_destroy(fd_table_t* table);       // 关闭全部描述符
+
+// 复制描述符表，两边的描述符指向相同的文件
+fd_table_t* fd_table_fork(fd_table_t* table);
+
+// 安装到最小的空闲描述符，返回描述符 (表已到上限或内存不足时返回 -1)
+int fd_install(fd_table_t* table, file_t* file);
+
+// 摘下描述符，返回原来的文件 (引用交给调用者)
+file_t* fd_remove(fd_table_t* table, int fd);
+
+static inline file_t* fd_lookup(fd_table_t* table, int fd) {
+    return (u32)fd < table->size ? table->files[fd] : NULL;
+}
+
+#endif // FILE_H
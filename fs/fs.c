@@ -1,4 +1,13 @@
 #include "fs.h"
+#include "qyfs.h"
+#include "blkdev.h"
+#include "pagecache.h"
+#include "dcache.h"
+#include "mount.h"
+#include "file.h"
+#include "../kernel/mm.h"
+#include "../kernel/spinlock.h"
+#include "../kernel/sched.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -7,121 +16,12 @@ static filesystem_t* registered_fs[16];
 static int fs_count = 0;
 static int fs_initialized = 0;
 
-// QiYuanOS 文件系统实现
-static int qyfs_mount(const char* device, const char* mount_point) {
-    printf("挂载 QYFS 文件系统: %s -> %s\n", device, mount_point);
-    return 0;
-}
-
-static int qyfs_umount(const char* mount_point) {
-    printf("卸载 QYFS 文件系统: %s\n", mount_point);
-    return 0;
-}
-
-static int qyfs_open(const char* path, int flags) {
-    printf("打开文件: %s (flags: %d)\n", path, flags);
-    return 1; // 返回文件描述符
-}
-
-static int qyfs_close(int fd) {
-    printf("关闭文件描述符: %d\n", fd);
-    return 0;
-}
+// 没有引导模块时的空内存盘: 1MB, 64 个 inode
+#define ROOT_RAMDISK_BLOCKS  256
+#define ROOT_RAMDISK_INODES  64
 
-static ssize_t qyfs_read(int fd, void* buffer, size_t size) {
-    printf("读取文件: fd=%d, size=%zu\n", fd, size);
-    // 模拟读取一些数据
-    memset(buffer, 0, size);
-    strcpy(buffer, "Hello from QiYuanOS File System!");
-    return strlen(buffer);
-}
-
-static ssize_t qyfs_write(int fd, const void* buffer, size_t size) {
-    printf("写入文件: fd=%d, size=%zu\n", fd, size);
-    return size;
-}
-
-static int qyfs_seek(int fd, off_t offset, int whence) {
-    printf("文件定位: fd=%d, offset=%ld, whence=%d\n", fd, offset, whence);
-    return 0;
-}
-
-static int qyfs_mkdir(const char* path, u32 permissions) {
-    printf("创建目录: %s (权限: %o)\n", path, permissions);
-    return 0;
-}
-
-static int qyfs_rmdir(const char* path) {
-    printf("删除目录: %s\n", path);
-    return 0;
-}
-
-static int qyfs_unlink(const char* path) {
-    printf("删除文件: %s\n", path);
-    return 0;
-}
-
-static int qyfs_rename(const char* old_path, const char* new_path) {
-    printf("重命名: %s -> %s\n", old_path, new_path);
-    return 0;
-}
-
-static int qyfs_readdir(int fd, dir_entry_t* entry) {
-    printf("读取目录: fd=%d\n", fd);
-    // 模拟返回一些目录项
-    static int entry_count = 0;
-    if (entry_count == 0) {
-        strcpy(entry->name, ".");
-        entry->type = FS_TYPE_DIR;
-        entry_count++;
-        return 1;
-    } else if (entry_count == 1) {
-        strcpy(entry->name, "..");
-        entry->type = FS_TYPE_DIR;
-        entry_count++;
-        return 1;
-    } else if (entry_count == 2) {
-        strcpy(entry->name, "test.txt");
-        entry->type = FS_TYPE_FILE;
-        entry->size = 1024;
-        entry_count++;
-        return 1;
-    }
-    return 0; // 没有更多目录项
-}
-
-static int qyfs_stat(const char* path, dir_entry_t* stat) {
-    printf("获取文件状态: %s\n", path);
-    strcpy(stat->name, "test.txt");
-    stat->type = FS_TYPE_FILE;
-    stat->size = 1024;
-    stat->permissions = FS_PERM_READ | FS_PERM_WRITE;
-    return 0;
-}
-
-// QYFS 操作接口
-static fs_operations_t qyfs_ops = {
-    .mount = qyfs_mount,
-    .umount = qyfs_umount,
-    .open = qyfs_open,
-    .close = qyfs_close,
-    .read = qyfs_read,
-    .write = qyfs_write,
-    .seek = qyfs_seek,
-    .mkdir = qyfs_mkdir,
-    .rmdir = qyfs_rmdir,
-    .unlink = qyfs_unlink,
-    .rename = qyfs_rename,
-    .readdir = qyfs_readdir,
-    .stat = qyfs_stat
-};
-
-// QYFS 文件系统定义
-static filesystem_t qyfs = {
-    .name = "qyfs",
-    .type = FS_TYPE_QYFS,
-    .ops = &qyfs_ops
-};
+// 页缓存最多占物理内存的 1/16
+#define PAGECACHE_MEM_SHIFT  4
 
 // 文件系统初始化
 int fs_init(void) {
@@ -131,11 +31,25 @@ int fs_init(void) {
     
     printf("初始化文件系统...\n");
     
+    // 页缓存不可用时文件系统直接读设备
+    pagecache_init(page_total_count() >> PAGECACHE_MEM_SHIFT);
+    dcache_init();
+    
+    // 根文件系统在内存盘上: 引导时加载的 mkqyfs 镜像，没有时格式化一个空盘
+    int blank = ramdisk_init(ROOT_RAMDISK_BLOCKS);
+    if (blank < 0 || (blank && qyfs_format(blkdev_find("ram0"), ROOT_RAMDISK_INODES) < 0)) {
+        printf("无法建立根文件系统的内存盘\n");
+        return -1;
+    }
+    
     // 注册 QYFS 文件系统
-    fs_register(&qyfs);
+    qyfs_register();
     
     // 挂载根文件系统
-    fs_mount("/dev/sda1", "qyfs", "/");
+    if (fs_mount("/dev/ram0", "qyfs", "/") < 0) {
+        printf("无法挂载根文件系统\n");
+        return -1;
+    }
     
     fs_initialized = 1;
     printf("文件系统初始化完成\n");
@@ -183,133 +97,395 @@ int fs_unregister(const char* name) {
     return -1; // 未找到
 }
 
+// 标准化后的路径，放在新分配的缓冲区中 (用 kfree 释放)
+static char* path_normalize_dup(const char* path) {
+    char* normalized = kmalloc_tagged(strlen(path) + 2, KMEM_FS);
+    if (normalized && fs_normalize_path(path, normalized) < 0) {
+        kfree(normalized);
+        return NULL;
+    }
+    return normalized;
+}
+
 // 挂载/卸载
 int fs_mount(const char* device, const char* type, const char* mount_point) {
+    filesystem_t* fs = NULL;
     for (int i = 0; i < fs_count; i++) {
         if (strcmp(registered_fs[i]->name, type) == 0) {
-            return registered_fs[i]->ops->mount(device, mount_point);
+            fs = registered_fs[i];
+            break;
         }
     }
-    printf("未找到文件系统类型: %s\n", type);
-    return -1;
+    if (!fs) {
+        printf("未找到文件系统类型: %s\n", type);
+        return -1;
+    }
+    char* normalized = path_normalize_dup(mount_point);
+    if (!normalized) {
+        return -1;
+    }
+
+    // 挂载点必须是没有被占用的、已存在的目录 (根目录除外，挂载根文件系统之前它还不存在)
+    int ok = mount_find(normalized) == NULL;
+    if (ok && strcmp(normalized, "/") != 0) {
+        dir_entry_t st;
+        ok = fs_stat(normalized, &st) == 0 && st.type == FS_TYPE_DIR;
+    }
+    void* data = NULL;
+    mount_t* mount = NULL;
+    if (ok && fs->ops->mount(device, &data) == 0) {
+        mount = mount_add(normalized, fs, data);
+        if (!mount) {
+            fs->ops->umount(data); // 同时有另一次挂载到这里
+        }
+    }
+    if (mount) {
+        // 挂载点和下面缓存的 dentry 属于原来的文件系统
+        dcache_invalidate_path(normalized);
+        printf("挂载 %s (%s) 到 %s\n", device, type, normalized);
+    }
+    kfree(normalized);
+    return mount ? 0 : -1;
 }
 
 int fs_umount(const char* mount_point) {
-    // 简化实现，假设只有一个挂载点
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->umount) {
-            return registered_fs[i]->ops->umount(mount_point);
+    char* normalized = path_normalize_dup(mount_point);
+    if (!normalized) {
+        return -1;
+    }
+    // 还有打开的文件、正在进行的操作或下面还有挂载时失败
+    mount_t* mount = mount_detach(normalized);
+    if (mount) {
+        dcache_invalidate_path(normalized);
+        if (mount->fs->ops->umount) {
+            mount->fs->ops->umount(mount->data);
         }
+        mount_free(mount);
+    }
+    kfree(normalized);
+    return mount ? 0 : -1;
+}
+
+// 直接交给文件系统的 stat (dcache 未命中时调用)
+static int fs_stat_uncached(mount_t* mount, const char* path, dir_entry_t* stat) {
+    if (!mount->fs->ops->stat) {
+        return -1;
+    }
+    return mount->fs->ops->stat(mount->data, mount_relative(mount, path), stat);
+}
+
+// 释放 dcache_walk 取得的 dentry 和挂载
+static void path_release(dentry_t* dentry, mount_t* mount) {
+    if (mount) {
+        mount_put(mount);
+    }
+    if (dentry) {
+        dcache_put(dentry);
     }
-    return -1;
+}
+
+// 当前任务的描述符表，create 时没有就建立
+static fd_table_t* current_files(int create) {
+    task_t* task = current_task();
+    if (!task) {
+        return NULL;
+    }
+    if (!task->files && create) {
+        task->files = fd_table_create();
+    }
+    return task->files;
+}
+
+// 当前任务的描述符对应的文件
+static file_t* fd_file(int fd) {
+    fd_table_t* files = current_files(0);
+    return files ? fd_lookup(files, fd) : NULL;
+}
+
+// 打开的文件
+file_t* fs_file_open(const char* path, int flags) {
+    char* normalized = path_normalize_dup(path);
+    if (!normalized) {
+        return NULL;
+    }
+
+    // 已知不存在且不创建时不必调用文件系统
+    mount_t* mount;
+    void* inode = NULL;
+    dentry_t* dentry = dcache_walk(normalized, fs_stat_uncached, &mount);
+    if (mount && mount->fs->ops->open && (!(dentry->flags & DENTRY_NEGATIVE) || (flags & FS_OPEN_CREATE))) {
+        inode = mount->fs->ops->open(mount->data, mount_relative(mount, normalized), flags);
+    }
+    if (inode && (flags & (FS_OPEN_CREATE | FS_OPEN_TRUNC))) {
+        dcache_invalidate_path(normalized);
+    }
+    kfree(normalized);
+
+    // 文件关闭前一直持有 dentry 和挂载的引用
+    file_t* file = inode ? file_alloc(mount, inode, dentry, flags) : NULL;
+    if (!file) {
+        if (inode && mount->fs->ops->close) {
+            mount->fs->ops->close(mount->data, inode);
+        }
+        path_release(dentry, mount);
+    }
+    return file;
+}
+
+void fs_file_close(file_t* file) {
+    file_put(file);
+}
+
+ssize_t fs_file_read(file_t* file, void* buffer, size_t size) {
+    fs_operations_t* ops = file->mount->fs->ops;
+    if (!ops->read) {
+        return -1;
+    }
+    u32 flags = spin_lock_irqsave(&file->lock);
+    ssize_t n = ops->read(file->mount->data, file->inode, file->position, buffer, size);
+    if (n > 0) {
+        file->position += n;
+    }
+    spin_unlock_irqrestore(&file->lock, flags);
+    return n;
+}
+
+ssize_t fs_file_write(file_t* file, const void* buffer, size_t size) {
+    fs_operations_t* ops = file->mount->fs->ops;
+    if (!ops->write || !(file->flags & FS_PERM_WRITE)) {
+        return -1;
+    }
+    u32 flags = spin_lock_irqsave(&file->lock);
+    ssize_t n = ops->write(file->mount->data, file->inode, file->position, buffer, size);
+    if (n > 0) {
+        file->position += n;
+    }
+    spin_unlock_irqrestore(&file->lock, flags);
+    if (n > 0) {
+        dcache_invalidate(file->dentry); // 大小和修改时间变了
+    }
+    return n;
+}
+
+int fs_file_getattr(file_t* file, dir_entry_t* stat) {
+    fs_operations_t* ops = file->mount->fs->ops;
+    if (!ops->getattr) {
+        return -1;
+    }
+    return ops->getattr(file->mount->data, file->inode, stat);
+}
+
+int fs_file_seek(file_t* file, off_t offset, int whence) {
+    s64 base = 0;
+    if (whence == SEEK_END) {
+        dir_entry_t stat;
+        if (fs_file_getattr(file, &stat) < 0) {
+            return -1;
+        }
+        base = (s64)stat.size;
+    } else if (whence != SEEK_SET && whence != SEEK_CUR) {
+        return -1;
+    }
+
+    u32 flags = spin_lock_irqsave(&file->lock);
+    if (whence == SEEK_CUR) {
+        base = (s64)file->position;
+    }
+    s64 position = base + offset;
+    if (position < 0 || position >= (s64)FS_MAX_FILE_SIZE) {
+        spin_unlock_irqrestore(&file->lock, flags);
+        return -1;
+    }
+    file->position = (u64)position;
+    spin_unlock_irqrestore(&file->lock, flags);
+    return (int)position;
 }
 
 // 文件操作
 int fs_open(const char* path, int flags) {
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->open) {
-            return registered_fs[i]->ops->open(path, flags);
-        }
+    fd_table_t* files = current_files(1);
+    file_t* file = files ? fs_file_open(path, flags) : NULL;
+    if (!file) {
+        return -1;
     }
-    return -1;
+    int fd = fd_install(files, file);
+    if (fd < 0) {
+        file_put(file);
+    }
+    return fd;
 }
 
 int fs_close(int fd) {
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->close) {
-            return registered_fs[i]->ops->close(fd);
-        }
+    fd_table_t* files = current_files(0);
+    file_t* file = files ? fd_remove(files, fd) : NULL;
+    if (!file) {
+        return -1;
     }
-    return -1;
+    file_put(file);
+    return 0;
 }
 
 ssize_t fs_read(int fd, void* buffer, size_t size) {
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->read) {
-            return registered_fs[i]->ops->read(fd, buffer, size);
-        }
-    }
-    return -1;
+    file_t* file = fd_file(fd);
+    return file ? fs_file_read(file, buffer, size) : -1;
 }
 
 ssize_t fs_write(int fd, const void* buffer, size_t size) {
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->write) {
-            return registered_fs[i]->ops->write(fd, buffer, size);
-        }
-    }
-    return -1;
+    file_t* file = fd_file(fd);
+    return file ? fs_file_write(file, buffer, size) : -1;
 }
 
 int fs_seek(int fd, off_t offset, int whence) {
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->seek) {
-            return registered_fs[i]->ops->seek(fd, offset, whence);
-        }
-    }
-    return -1;
+    file_t* file = fd_file(fd);
+    return file ? fs_file_seek(file, offset, whence) : -1;
 }
 
 // 目录操作
 int fs_mkdir(const char* path, u32 permissions) {
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->mkdir) {
-            return registered_fs[i]->ops->mkdir(path, permissions);
-        }
+    char* normalized = path_normalize_dup(path);
+    if (!normalized) {
+        return -1;
     }
-    return -1;
+    // 父目录不存在或目标已存在时不必调用文件系统
+    mount_t* mount;
+    int result = -1;
+    dentry_t* dentry = dcache_walk(normalized, fs_stat_uncached, &mount);
+    if (mount && (dentry->flags & DENTRY_NEGATIVE) && mount->fs->ops->mkdir) {
+        result = mount->fs->ops->mkdir(mount->data, mount_relative(mount, normalized), permissions);
+    }
+    path_release(dentry, mount);
+    if (result == 0) {
+        dcache_invalidate_path(normalized);
+    }
+    kfree(normalized);
+    return result;
 }
 
-int fs_rmdir(const char* path) {
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->rmdir) {
-            return registered_fs[i]->ops->rmdir(path);
+// rmdir 和 unlink: 路径必须存在，且不能是挂载点
+static int remove_path(const char* path, int dir) {
+    char* normalized = path_normalize_dup(path);
+    if (!normalized) {
+        return -1;
+    }
+    mount_t* mount;
+    int result = -1;
+    dentry_t* dentry = dcache_walk(normalized, fs_stat_uncached, &mount);
+    if (mount && !(dentry->flags & DENTRY_NEGATIVE) && !mount_covers(normalized)) {
+        const char* relative = mount_relative(mount, normalized);
+        if (dir && mount->fs->ops->rmdir) {
+            result = mount->fs->ops->rmdir(mount->data, relative);
+        } else if (!dir && mount->fs->ops->unlink) {
+            result = mount->fs->ops->unlink(mount->data, relative);
         }
     }
-    return -1;
+    path_release(dentry, mount);
+    if (result == 0) {
+        dcache_invalidate_path(normalized);
+    }
+    kfree(normalized);
+    return result;
+}
+
+int fs_rmdir(const char* path) {
+    return remove_path(path, 1);
 }
 
 int fs_unlink(const char* path) {
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->unlink) {
-            return registered_fs[i]->ops->unlink(path);
-        }
-    }
-    return -1;
+    return remove_path(path, 0);
 }
 
 int fs_rename(const char* old_path, const char* new_path) {
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->rename) {
-            return registered_fs[i]->ops->rename(old_path, new_path);
+    char* old_normalized = path_normalize_dup(old_path);
+    char* new_normalized = path_normalize_dup(new_path);
+    int result = -1;
+    if (old_normalized && new_normalized) {
+        // 不能跨挂载改名，也不能移动挂载点或下面有挂载的目录
+        mount_t* old_mount;
+        mount_t* new_mount;
+        dentry_t* old_dentry = dcache_walk(old_normalized, fs_stat_uncached, &old_mount);
+        dentry_t* new_dentry = dcache_walk(new_normalized, fs_stat_uncached, &new_mount);
+        if (old_mount && old_mount == new_mount && !mount_covers(old_normalized) &&
+            !(old_dentry->flags & DENTRY_NEGATIVE) && (new_dentry->flags & DENTRY_NEGATIVE) &&
+            old_mount->fs->ops->rename) {
+            result = old_mount->fs->ops->rename(old_mount->data, mount_relative(old_mount, old_normalized),
+                                                mount_relative(old_mount, new_normalized));
         }
+        path_release(old_dentry, old_mount);
+        path_release(new_dentry, new_mount);
+    }
+    if (result == 0) {
+        dcache_invalidate_path(old_normalized);
+        dcache_invalidate_path(new_normalized);
     }
-    return -1;
+    kfree(old_normalized);
+    kfree(new_normalized);
+    return result;
 }
 
 int fs_readdir(int fd, dir_entry_t* entry) {
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->readdir) {
-            return registered_fs[i]->ops->readdir(fd, entry);
-        }
+    file_t* file = fd_file(fd);
+    if (!file || !file->mount->fs->ops->readdir) {
+        return -1;
     }
-    return -1;
+    u32 flags = spin_lock_irqsave(&file->lock);
+    int result = file->mount->fs->ops->readdir(file->mount->data, file->inode, &file->position, entry);
+    spin_unlock_irqrestore(&file->lock, flags);
+    return result;
 }
 
 int fs_stat(const char* path, dir_entry_t* stat) {
-    for (int i = 0; i < fs_count; i++) {
-        if (registered_fs[i]->ops->stat) {
-            return registered_fs[i]->ops->stat(path, stat);
-        }
+    char* normalized = path_normalize_dup(path);
+    if (!normalized) {
+        return -1;
+    }
+    int result = -1;
+    dentry_t* dentry = dcache_walk(normalized, fs_stat_uncached, NULL);
+    if (dentry) {
+        result = dcache_fill_stat(dentry, stat);
+        dcache_put(dentry);
     }
-    return -1;
+    kfree(normalized);
+    return result;
 }
 
 // 路径处理
+// 去掉重复的 '/' 和 "."，".." 回到上一级 (根目录的上一级仍是根目录)，结果总是以 '/' 开头、
+// 除根目录外不以 '/' 结尾。相对路径视为从根目录开始。normalized 至少要有 strlen(path) + 2 字节
 int fs_normalize_path(const char* path, char* normalized) {
-    // 简单的路径标准化实现
-    strcpy(normalized, path);
-    return 0;
+    u32 len = 1;
+    normalized[0] = '/';
+    while (*path) {
+        while (*path == '/') {
+            path++;
+        }
+        const char* start = path;
+        while (*path && *path != '/') {
+            path++;
+        }
+        u32 n = path - start;
+        if (n == 0 || (n == 1 && start[0] == '.')) {
+            continue;
+        }
+        if (n == 2 && start[0] == '.' && start[1] == '.') {
+            while (len > 1 && normalized[len - 1] != '/') {
+                len--;
+            }
+            if (len > 1) {
+                len--;
+            }
+            continue;
+        }
+        if (n > FS_MAX_NAME_LEN) {
+            return -1;
+        }
+        if (len > 1) {
+            normalized[len++] = '/';
+        }
+        memcpy(normalized + len, start, n);
+        len += n;
+    }
+    normalized[len] = '\0';
+    return len < FS_MAX_PATH_LEN ? 0 : -1;
 }
 
 int fs_get_parent(const char* path, char* parent) {
@@ -14,28 +14,26 @@
 #define FS_PERM_WRITE   0x02
 #define FS_PERM_EXECUTE 0x04
 
+// 打开方式 (与 FS_PERM_READ / FS_PERM_WRITE 组合)
+#define FS_OPEN_CREATE  0x10    // 不存在时创建
+#define FS_OPEN_TRUNC   0x20    // 以写方式打开时清空
+
 // 文件类型
 #define FS_TYPE_FILE     1
 #define FS_TYPE_DIR      2
 #define FS_TYPE_LINK     3
 #define FS_TYPE_DEVICE   4
 
+// 文件定位起点
+#define SEEK_SET         0
+#define SEEK_CUR         1
+#define SEEK_END         2
+
 // 文件系统最大值
 #define FS_MAX_NAME_LEN    255
 #define FS_MAX_PATH_LEN    4096
 #define FS_MAX_FILE_SIZE   (4ULL * 1024 * 1024 * 1024) // 4GB
 
-// 文件描述符结构
-typedef struct {
-    int fd;
-    char name[FS_MAX_NAME_LEN + 1];
-    u32 flags;
-    u32 permissions;
-    u64 size;
-    u64 position;
-    void* private_data;
-} file_descriptor_t;
-
 // 目录项结构
 typedef struct {
     char name[FS_MAX_NAME_LEN + 1];
@@ -49,20 +47,24 @@ typedef struct {
 } dir_entry_t;
 
 // 文件系统操作接口
+// mount 成功时在 data 中返回文件系统实例，其他操作都以它为第一个参数。
+// 路径是挂载内的标准化路径 (挂载点本身为 "/")。
+// open 返回文件系统自己的 inode 并加一次引用，close 释放；读写位置由 VFS 的打开文件记录，
+// readdir 的 pos 是文件系统自己解释的目录位置 (从 0 开始)
 typedef struct {
-    int (*mount)(const char* device, const char* mount_point);
-    int (*umount)(const char* mount_point);
-    int (*open)(const char* path, int flags);
-    int (*close)(int fd);
-    ssize_t (*read)(int fd, void* buffer, size_t size);
-    ssize_t (*write)(int fd, const void* buffer, size_t size);
-    int (*seek)(int fd, off_t offset, int whence);
-    int (*mkdir)(const char* path, u32 permissions);
-    int (*rmdir)(const char* path);
-    int (*unlink)(const char* path);
-    int (*rename)(const char* old_path, const char* new_path);
-    int (*readdir)(int fd, dir_entry_t* entry);
-    int (*stat)(const char* path, dir_entry_t* stat);
+    int (*mount)(const char* device, void** data);
+    int (*umount)(void* data);
+    void* (*open)(void* data, const char* path, int flags);
+    void (*close)(void* data, void* inode);
+    ssize_t (*read)(void* data, void* inode, u64 pos, void* buffer, size_t size);
+    ssize_t (*write)(void* data, void* inode, u64 pos, const void* buffer, size_t size);
+    int (*getattr)(void* data, void* inode, dir_entry_t* stat);
+    int (*mkdir)(void* data, const char* path, u32 permissions);
+    int (*rmdir)(void* data, const char* path);
+    int (*unlink)(void* data, const char* path);
+    int (*rename)(void* data, const char* old_path, const char* new_path);
+    int (*readdir)(void* data, void* inode, u64* pos, dir_entry_t* entry);
+    int (*stat)(void* data, const char* path, dir_entry_t* stat);
 } fs_operations_t;
 
 // 文件系统注册结构
@@ -85,13 +87,23 @@ int fs_unregister(const char* name);
 int fs_mount(const char* device, const char* type, const char* mount_point);
 int fs_umount(const char* mount_point);
 
-// 文件操作
+// 文件操作 (描述符属于当前任务)
+// 文件系统在自旋锁内复制数据，缓冲区必须是内核内存；用户缓冲区经 user_fs_read/user_fs_write 中转
 int fs_open(const char* path, int flags);
 int fs_close(int fd);
 ssize_t fs_read(int fd, void* buffer, size_t size);
 ssize_t fs_write(int fd, const void* buffer, size_t size);
 int fs_seek(int fd, off_t offset, int whence);
 
+// 内核内部使用的打开文件 (不占用任务的描述符，可以在任务之间共享)
+struct file;
+struct file* fs_file_open(const char* path, int flags);
+void fs_file_close(struct file* file);
+ssize_t fs_file_read(struct file* file, void* buffer, size_t size);
+ssize_t fs_file_write(struct file* file, const void* buffer, size_t size);
+int fs_file_seek(struct file* file, off_t offset, int whence);
+int fs_file_getattr(struct file* file, dir_entry_t* stat);     // 打开的 inode 的当前属性
+
 // 目录操作
 int fs_mkdir(const char* path, u32 permissions);
 int fs_rmdir(const char* path);
@@ -0,0 +1,116 @@
+#include "mount.h"
+#include "../kernel/mm.h"
+#include "../kernel/spinlock.h"
+#include <string.h>
+
+// 挂载点很少，用链表即可 (只在挂载、卸载和 dentry 重新验证时查找)
+static mount_t* mounts = NULL;
+static spinlock_t mount_lock = SPINLOCK_INIT;
+
+// 调用者持有 mount_lock
+static mount_t* find_locked(const char* path) {
+    for (mount_t* mount = mounts; mount; mount = mount->next) {
+        if (strcmp(mount->path, path) == 0) {
+            return mount;
+        }
+    }
+    return NULL;
+}
+
+mount_t* mount_add(const char* path, filesystem_t* fs, void* data) {
+    mount_t* mount = kmalloc_tagged(sizeof(mount_t), KMEM_FS);
+    char* copy = kmalloc_tagged(strlen(path) + 1, KMEM_FS);
+    if (!mount || !copy) {
+        kfree(mount);
+        kfree(copy);
+        return NULL;
+    }
+    memset(mount, 0, sizeof(mount_t));
+    strcpy(copy, path);
+    mount->path = copy;
+    mount->path_len = strcmp(path, "/") == 0 ? 0 : strlen(path);
+    mount->fs = fs;
+    mount->data = data;
+
+    u32 flags = spin_lock_irqsave(&mount_lock);
+    if (find_locked(path)) {
+        spin_unlock_irqrestore(&mount_lock, flags);
+        kfree(copy);
+        kfree(mount);
+        return NULL;
+    }
+    mount->next = mounts;
+    mounts = mount;
+    spin_unlock_irqrestore(&mount_lock, flags);
+    return mount;
+}
+
+// other 是否挂在 mount 下面
+static int is_nested(const mount_t* mount, const mount_t* other) {
+    return other != mount && other->path_len > mount->path_len &&
+           strncmp(other->path, mount->path, mount->path_len) == 0 &&
+           other->path[mount->path_len] == '/';
+}
+
+mount_t* mount_detach(const char* path) {
+    u32 flags = spin_lock_irqsave(&mount_lock);
+    mount_t* mount = find_locked(path);
+    if (!mount || mount->refcount > 0) {
+        spin_unlock_irqrestore(&mount_lock, flags);
+        return NULL;
+    }
+    for (mount_t* other = mounts; other; other = other->next) {
+        if (is_nested(mount, other)) {
+            spin_unlock_irqrestore(&mount_lock, flags);
+            return NULL;
+        }
+    }
+    mount_t** link = &mounts;
+    while (*link != mount) {
+        link = &(*link)->next;
+    }
+    *link = mount->next;
+    mount->detached = 1;
+    spin_unlock_irqrestore(&mount_lock, flags);
+    return mount;
+}
+
+void mount_free(mount_t* mount) {
+    kfree(mount->path);
+    kfree(mount);
+}
+
+mount_t* mount_find(const char* path) {
+    u32 flags = spin_lock_irqsave(&mount_lock);
+    mount_t* mount = find_locked(path);
+    spin_unlock_irqrestore(&mount_lock, flags);
+    return mount;
+}
+
+int mount_covers(const char* path) {
+    u32 len = strlen(path);
+    u32 flags = spin_lock_irqsave(&mount_lock);
+    mount_t* mount = mounts;
+    while (mount && !(strncmp(mount->path, path, len) == 0 &&
+                      (mount->path[len] == '\0' || mount->path[len] == '/'))) {
+        mount = mount->next;
+    }
+    spin_unlock_irqrestore(&mount_lock, flags);
+    return mount != NULL;
+}
+
+int mount_get(mount_t* mount) {
+    u32 flags = spin_lock_irqsave(&mount_lock);
+    int ok = !mount->detached;
+    if (ok) {
+        mount->refcount++;
+    }
+    spin_unlock_irqrestore(&mount_lock, flags);
+    return ok;
+}
+
+void mount_put(mount_t* mount) {
+    u32 flags = spin_lock_irqsave(&mount_lock);
+    mount->refcount--;
+    spin_unlock_irqrestore(&mount_lock, flags);
+}
@@ -0,0 +1,43 @@
+#ifndef MOUNT_H
+#define MOUNT_H
+
+#include "fs.h"
+
+// 挂载表: 每个挂载点一项，挂载点是标准化的绝对路径。
+// 路径属于哪个挂载由 dcache 在解析时逐级确定并缓存在 dentry 中 (等价于最长前缀匹配)，
+// 这里只需要按挂载点精确查找。
+
+typedef struct mount {
+    char* path;                 // 挂载点
+    u32 path_len;               // 根目录为 0，path + path_len 即文件系统内的路径
+    filesystem_t* fs;
+    void* data;                 // 文件系统实例 (ops->mount 返回)
+    u32 refcount;               // 打开的文件和正在进行的操作
+    int detached;               // 已从挂载表中摘下，不能再取得引用
+    struct mount* next;
+} mount_t;
+
+// 加入挂载表，挂载点已被占用时返回 NULL
+mount_t* mount_add(const char* path, filesystem_t* fs, void* data);
+
+// 从挂载表中摘下 (仍在使用或下面还有其他挂载时返回 NULL)，之后由调用者 mount_free
+mount_t* mount_detach(const char* path);
+void mount_free(mount_t* mount);
+
+// 挂载点恰好是 path 的挂载
+mount_t* mount_find(const char* path);
+
+// path 是挂载点或者下面有挂载 (不能删除或改名)
+int mount_covers(const char* path);
+
+// 引用计数: 已摘下的挂载取不到引用 (返回 0)
+int mount_get(mount_t* mount);
+void mount_put(mount_t* mount);
+
+// 挂载内的路径 (挂载点本身为 "/")
+static inline const char* mount_relative(const mount_t* mount, const char* path) {
+    path += mount->path_len;
+    return *path ? path : "/";
+}
+
+#endif // MOUNT_H
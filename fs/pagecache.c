@@ -0,0 +1,300 @@
+#include "pagecache.h"
+#include "../kernel/mm.h"
+#include "../kernel/spinlock.h"
+#include "../kernel/serial.h"
+#include <string.h>
+#include <stdio.h>
+
+// 2Q 的三个队列 (表头是最新的一端，从表尾淘汰)
+#define PC_A1IN     0       // 只被读入过一次的页 (FIFO)
+#define PC_AM       1       // 热页 (LRU)
+#define PC_A1OUT    2       // 最近从 A1in 淘汰的页号，没有数据 (FIFO)
+#define PC_NR_QUEUES 3
+
+typedef struct pc_entry {
+    const void* owner;
+    u32 ino;
+    u32 index;
+    u8* data;                   // A1out 中为 NULL
+    u32 queue;                  // PC_*
+    struct pc_entry* hash_next;
+    struct pc_entry* prev;
+    struct pc_entry* next;
+} pc_entry_t;
+
+typedef struct {
+    pc_entry_t* head;
+    pc_entry_t* tail;
+    u32 count;
+} pc_queue_t;
+
+// 全部状态由 pc_lock 保护
+static pc_entry_t* hash_table[PAGECACHE_HASH_SIZE];
+static pc_queue_t queues[PC_NR_QUEUES];
+static pc_entry_t* free_entries = NULL;    // 空闲描述符 (初始化时一次分配)
+static u32 max_in = 0;                      // A1in 的目标长度: 容量的 1/4
+static u32 max_out = 0;                     // A1out 的长度: 容量的 1/2
+static u32 nr_allocated = 0;                // 从页分配器取得的页
+static pagecache_stats_t stats;
+static spinlock_t pc_lock = SPINLOCK_INIT;
+
+int pagecache_init(u32 max_pages) {
+    if (max_pages < 4) {
+        return -1;
+    }
+    u32 nr_entries = max_pages + max_pages / 2;
+    pc_entry_t* entries = kmalloc_tagged(nr_entries * sizeof(pc_entry_t), KMEM_FS);
+    if (!entries) {
+        printf("页缓存: 无法分配 %u 个描述符\n", nr_entries);
+        return -1;
+    }
+    memset(entries, 0, nr_entries * sizeof(pc_entry_t));
+
+    u32 flags = spin_lock_irqsave(&pc_lock);
+    for (u32 i = 0; i < nr_entries; i++) {
+        entries[i].hash_next = free_entries;
+        free_entries = &entries[i];
+    }
+    max_in = max_pages / 4;
+    max_out = max_pages / 2;
+    stats.max_pages = max_pages;
+    spin_unlock_irqrestore(&pc_lock, flags);
+
+    printf("页缓存: 最多 %u 页 (%u KB)\n", max_pages, max_pages * (PAGE_SIZE / 1024));
+    return 0;
+}
+
+static pc_entry_t** hash_bucket(const void* owner, u32 ino, u32 index) {
+    u32 hash = ino * 0x9E3779B1u ^ index ^ ((u32)owner >> 6);
+    hash ^= hash >> 16;
+    return &hash_table[hash & (PAGECACHE_HASH_SIZE - 1)];
+}
+
+static pc_entry_t* hash_find(const void* owner, u32 ino, u32 index) {
+    for (pc_entry_t* entry = *hash_bucket(owner, ino, index); entry; entry = entry->hash_next) {
+        if (entry->index == index && entry->ino == ino && entry->owner == owner) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void queue_remove(pc_entry_t* entry) {
+    pc_queue_t* queue = &queues[entry->queue];
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        queue->head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        queue->tail = entry->prev;
+    }
+    queue->count--;
+}
+
+static void queue_push(pc_entry_t* entry, u32 id) {
+    pc_queue_t* queue = &queues[id];
+    entry->queue = id;
+    entry->prev = NULL;
+    entry->next = queue->head;
+    if (queue->head) {
+        queue->head->prev = entry;
+    } else {
+        queue->tail = entry;
+    }
+    queue->head = entry;
+    queue->count++;
+}
+
+// 从哈希表和队列中摘下并回收描述符 (数据页由调用者处理)
+static void entry_free(pc_entry_t* entry) {
+    pc_entry_t** link = hash_bucket(entry->owner, entry->ino, entry->index);
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+    queue_remove(entry);
+    entry->hash_next = free_entries;
+    free_entries = entry;
+}
+
+// 淘汰一页并返回它的数据页。A1in 超过目标长度 (或 Am 为空) 时从 A1in 淘汰，
+// 页号转入 A1out；否则淘汰 Am 中最久没有访问的页
+static u8* evict(void) {
+    pc_queue_t* in = &queues[PC_A1IN];
+    pc_queue_t* hot = &queues[PC_AM];
+    pc_entry_t* victim;
+    u8* data;
+
+    if (in->count > max_in || (in->count && !hot->count)) {
+        victim = in->tail;
+        data = victim->data;
+        victim->data = NULL;
+        queue_remove(victim);
+        queue_push(victim, PC_A1OUT);
+        if (queues[PC_A1OUT].count > max_out) {
+            entry_free(queues[PC_A1OUT].tail);
+        }
+    } else if (hot->count) {
+        victim = hot->tail;
+        data = victim->data;
+        entry_free(victim);
+    } else {
+        return NULL;
+    }
+    stats.evictions++;
+    return data;
+}
+
+// 取得一页空闲数据页: 没到容量时从页分配器分配，否则淘汰
+static u8* page_get_free(void) {
+    if (nr_allocated < stats.max_pages) {
+        u8* data = page_alloc(0);
+        if (data) {
+            nr_allocated++;
+            return data;
+        }
+    }
+    return evict();
+}
+
+static void page_release(u8* data) {
+    page_free(data, 0);
+    nr_allocated--;
+}
+
+int pagecache_read(const void* owner, u32 ino, u32 index, u32 offset, void* buffer, u32 size,
+                   pagecache_fill_t fill, void* ctx) {
+    u32 flags = spin_lock_irqsave(&pc_lock);
+    pc_entry_t* entry = hash_find(owner, ino, index);
+    if (entry && entry->data) {
+        // A1in 中的页再次命中不提升: 刚读入不久的重复访问 (比如小块顺序读) 不代表是热页
+        if (entry->queue == PC_AM) {
+            queue_remove(entry);
+            queue_push(entry, PC_AM);
+        }
+        stats.hits++;
+        memcpy(buffer, entry->data + offset, size);
+        spin_unlock_irqrestore(&pc_lock, flags);
+        return 0;
+    }
+
+    // 页号还在 A1out 中说明不久前用过: 作为热页重新读入
+    u32 queue = PC_A1IN;
+    stats.misses++;
+    if (entry) {
+        stats.ghost_hits++;
+        queue = PC_AM;
+        entry_free(entry);
+    }
+
+    u8* data = page_get_free();
+    if (!data || fill(ctx, index, data) < 0) {
+        if (data) {
+            page_release(data);
+        }
+        spin_unlock_irqrestore(&pc_lock, flags);
+        return -1;
+    }
+
+    if (!free_entries) {
+        entry_free(queues[PC_A1OUT].tail); // 描述符按容量的 1.5 倍分配，只可能被幽灵占满
+    }
+    entry = free_entries;
+    free_entries = entry->hash_next;
+    entry->owner = owner;
+    entry->ino = ino;
+    entry->index = index;
+    pc_entry_t** bucket = hash_bucket(owner, ino, index);
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    queue_push(entry, queue);
+    entry->data = data;
+    memcpy(buffer, data + offset, size);
+    spin_unlock_irqrestore(&pc_lock, flags);
+    return 0;
+}
+
+void pagecache_write(const void* owner, u32 ino, u64 pos, const void* buffer, u32 size) {
+    const u8* src = buffer;
+    u32 flags = spin_lock_irqsave(&pc_lock);
+    while (size) {
+        u32 index = (u32)(pos >> PAGE_SHIFT);
+        u32 offset = (u32)pos & (PAGE_SIZE - 1);
+        u32 chunk = PAGE_SIZE - offset < size ? PAGE_SIZE - offset : size;
+        pc_entry_t* entry = hash_find(owner, ino, index);
+        if (entry && entry->data) {
+            memcpy(entry->data + offset, src, chunk);
+        }
+        pos += chunk;
+        src += chunk;
+        size -= chunk;
+    }
+    spin_unlock_irqrestore(&pc_lock, flags);
+}
+
+void pagecache_invalidate(const void* owner, u32 ino, u32 from_index) {
+    u32 flags = spin_lock_irqsave(&pc_lock);
+    // 截断和删除不频繁，直接扫描全部队列
+    for (u32 q = 0; q < PC_NR_QUEUES; q++) {
+        pc_entry_t* entry = queues[q].head;
+        while (entry) {
+            pc_entry_t* next = entry->next;
+            if (entry->owner == owner && (ino == PAGECACHE_ALL_INODES || entry->ino == ino) &&
+                entry->index >= from_index) {
+                if (entry->data) {
+                    page_release(entry->data);
+                    stats.invalidations++;
+                }
+                entry_free(entry);
+            }
+            entry = next;
+        }
+    }
+    spin_unlock_irqrestore(&pc_lock, flags);
+}
+
+void pagecache_get_stats(pagecache_stats_t* out) {
+    u32 flags = spin_lock_irqsave(&pc_lock);
+    *out = stats;
+    out->nr_in = queues[PC_A1IN].count;
+    out->nr_hot = queues[PC_AM].count;
+    out->nr_ghost = queues[PC_A1OUT].count;
+    out->nr_pages = out->nr_in + out->nr_hot;
+    spin_unlock_irqrestore(&pc_lock, flags);
+}
+
+void pagecache_dump(void) {
+    char line[128];
+    pagecache_stats_t st;
+    pagecache_get_stats(&st);
+
+    // 命中率 (千分比)，避免 u32 乘法溢出
+    u32 hits = st.hits;
+    u32 total = st.hits + st.misses;
+    while (total > 0x3FFFFF) {
+        hits >>= 1;
+        total >>= 1;
+    }
+    u32 ratio = total ? hits * 1000 / total : 0;
+
+    snprintf(line, sizeof(line), "pagecache: %u/%u 页 (A1in %u, Am %u), 幽灵 %u\n",
+             st.nr_pages, st.max_pages, st.nr_in, st.nr_hot, st.nr_ghost);
+    serial_puts(line);
+    snprintf(line, sizeof(line), "pagecache: 命中 %u, 未命中 %u (幽灵 %u), 命中率 %u.%u%%\n",
+             st.hits, st.misses, st.ghost_hits, ratio / 10, ratio % 10);
+    serial_puts(line);
+    snprintf(line, sizeof(line), "pagecache: 淘汰 %u, 丢弃 %u\n", st.evictions, st.invalidations);
+    serial_puts(line);
+}
+
+static void pagecache_command(char key) {
+    (void)key;
+    pagecache_dump();
+}
+
+void pagecache_debug_init(void) {
+    serial_register_command('c', pagecache_command);
+}
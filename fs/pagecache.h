@@ -0,0 +1,51 @@
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include "../kernel/kernel.h"
+
+// 页缓存: 缓存文件内容，键为 (文件系统实例, inode 号, 页号)，页大小与 PAGE_SIZE 相同。
+// 淘汰策略是 2Q: 第一次读入的页进入 FIFO 队列 A1in，从 A1in 淘汰时只留下页号
+// (幽灵队列 A1out)；页号还在 A1out 中时再次读入，才算热页进入 LRU 队列 Am。
+// 一次大的顺序扫描只会冲刷 A1in，不会挤掉 Am 中的工作集。
+// 文件系统写穿: 先写设备再用 pagecache_write 更新已缓存的页。
+// 数据在页缓存的锁内复制，buffer 必须是内核内存 (不能缺页)。
+
+#define PAGECACHE_HASH_SIZE     256     // 必须是 2 的幂
+#define PAGECACHE_ALL_INODES    0xFFFFFFFF
+
+// 从存储读入第 index 页 (不能睡眠)，失败返回 -1
+typedef int (*pagecache_fill_t)(void* ctx, u32 index, void* page);
+
+typedef struct {
+    u32 max_pages;              // 容量 (页)
+    u32 nr_pages;               // 缓存中的页 (A1in + Am)
+    u32 nr_in;                  // A1in 中的页
+    u32 nr_hot;                 // Am 中的页
+    u32 nr_ghost;               // A1out 中的页号
+    u32 hits;
+    u32 misses;
+    u32 ghost_hits;             // 未命中但页号在 A1out 中 (作为热页重新读入)
+    u32 evictions;              // 为腾出空间淘汰的页
+    u32 invalidations;          // 因截断、删除或卸载丢弃的页
+} pagecache_stats_t;
+
+// 初始化，最多缓存 max_pages 页 (页在使用时才分配)
+int pagecache_init(u32 max_pages);
+
+// 读第 index 页中 offset 开始的 size 字节 (不跨页)。未命中时分配一页并调用 fill 读入。
+// 页缓存不可用或 fill 失败时返回 -1，调用者应直接读存储
+int pagecache_read(const void* owner, u32 ino, u32 index, u32 offset, void* buffer, u32 size,
+                   pagecache_fill_t fill, void* ctx);
+
+// 文件 pos 开始的 size 字节已写入存储: 更新已缓存的页 (没有缓存的页不读入)
+void pagecache_write(const void* owner, u32 ino, u64 pos, const void* buffer, u32 size);
+
+// 丢弃 inode 从 from_index 开始的页 (ino 为 PAGECACHE_ALL_INODES 时丢弃 owner 的全部页)
+void pagecache_invalidate(const void* owner, u32 ino, u32 from_index);
+
+// 统计
+void pagecache_get_stats(pagecache_stats_t* stats);
+void pagecache_dump(void);          // 输出到串口
+void pagecache_debug_init(void);    // 注册串口命令 c
+
+#endif // PAGECACHE_H
@@ -0,0 +1,1189 @@
+#include "qyfs.h"
+#include "fs.h"
+#include "blkdev.h"
+#include "pagecache.h"
+#include "../kernel/mm.h"
+#include "../kernel/spinlock.h"
+#include "../kernel/klog.h"
+#include <string.h>
+#include <stdio.h>
+
+// QYFS 文件系统
+// 超级块和两张位图在挂载时读入内存，修改后立即写回对应的块；inode 在使用期间
+// 常驻内存 (连同全部 extent)。文件内容经过页缓存按页读取，写入时按 extent 整段
+// 写设备 (写穿)，再更新已缓存的页。
+// 块分配是 next-fit: 从上次分配结束的位置继续找，文件增长时优先紧接在最后一个
+// extent 之后分配，使 extent 尽量长。
+// 每次挂载是一个独立的实例 (qyfs_fs_t)，各自有锁，可以同时挂载多个设备。打开的文件就是
+// inode 的一次引用，读写位置由 VFS 记录。
+
+// 内存中的 inode
+typedef struct qyfs_node {
+    u32 ino;
+    u32 refcount;
+    qyfs_inode_t disk;
+    qyfs_extent_t* extents;         // 全部 extent (内联的和间接块中的)
+    u32 extent_cap;
+    u32 nr_blocks;                  // 已分配的块数
+    struct qyfs_node* next;
+} qyfs_node_t;
+
+// 一个挂载的实例，全部状态由 lock 保护 (内存盘读写不会睡眠)
+typedef struct {
+    spinlock_t lock;
+    block_device_t* dev;
+    qyfs_super_t sb;
+    u8* inode_bitmap;
+    u8* block_bitmap;
+    u8* scratch;                    // 部分块读写的临时缓冲
+    u8* dirbuf;                     // 目录扫描缓冲
+    qyfs_node_t* nodes;             // 使用中的 inode
+    qyfs_node_t* root;
+} qyfs_fs_t;
+
+// 位图
+static inline int bit_test(const u8* map, u32 bit) {
+    return (map[bit >> 3] >> (bit & 7)) & 1;
+}
+
+static inline void bit_set(u8* map, u32 bit) {
+    map[bit >> 3] |= 1 << (bit & 7);
+}
+
+static inline void bit_clear(u8* map, u32 bit) {
+    map[bit >> 3] &= ~(1 << (bit & 7));
+}
+
+static int super_sync(qyfs_fs_t* fs) {
+    memset(fs->scratch, 0, QYFS_BLOCK_SIZE);
+    memcpy(fs->scratch, &fs->sb, sizeof(qyfs_super_t));
+    return fs->dev->write(fs->dev, 0, 1, fs->scratch);
+}
+
+// 写回位图中 [first, last] 位所在的块
+static void bitmap_sync(qyfs_fs_t* fs, u8* map, u32 start, u32 first, u32 last) {
+    u32 from = first / QYFS_BITS_PER_BLOCK;
+    u32 to = last / QYFS_BITS_PER_BLOCK;
+    fs->dev->write(fs->dev, start + from, to - from + 1, map + from * QYFS_BLOCK_SIZE);
+}
+
+// 分配最多 want 个连续块，goal 空闲时从 goal 开始 (可以与前一个 extent 合并)。
+// 返回起始块，*got 为实际分配的块数；没有空闲块返回 0
+static u32 alloc_run(qyfs_fs_t* fs, u32 goal, u32 want, u32* got) {
+    qyfs_super_t* sb = &fs->sb;
+    u8* map = fs->block_bitmap;
+    if (sb->free_blocks == 0 || want == 0) {
+        return 0;
+    }
+
+    u32 start = 0;
+    if (goal >= sb->data_start && goal < sb->total_blocks && !bit_test(map, goal)) {
+        start = goal;
+    } else {
+        u32 block = sb->alloc_hint;
+        if (block < sb->data_start || block >= sb->total_blocks) {
+            block = sb->data_start;
+        }
+        for (u32 i = sb->data_start; i < sb->total_blocks; i++) {
+            // 整字节已满时一次跳过 8 块
+            if (!(block & 7) && map[block >> 3] == 0xFF && block + 8 <= sb->total_blocks) {
+                block += 8;
+                i += 7;
+            } else if (!bit_test(map, block)) {
+                start = block;
+                break;
+            } else {
+                block++;
+            }
+            if (block >= sb->total_blocks) {
+                block = sb->data_start; // 回绕
+            }
+        }
+        if (!start) {
+            return 0;
+        }
+    }
+
+    u32 count = 0;
+    while (count < want && start + count < sb->total_blocks && !bit_test(map, start + count)) {
+        bit_set(map, start + count);
+        count++;
+    }
+    sb->free_blocks -= count;
+    sb->alloc_hint = start + count;
+    bitmap_sync(fs, map, sb->block_bitmap, start, start + count - 1);
+    super_sync(fs);
+    *got = count;
+    return start;
+}
+
+static void free_run(qyfs_fs_t* fs, u32 start, u32 count) {
+    if (count == 0) {
+        return;
+    }
+    for (u32 i = 0; i < count; i++) {
+        bit_clear(fs->block_bitmap, start + i);
+    }
+    fs->sb.free_blocks += count;
+    bitmap_sync(fs, fs->block_bitmap, fs->sb.block_bitmap, start, start + count - 1);
+    super_sync(fs);
+}
+
+static u32 inode_alloc(qyfs_fs_t* fs) {
+    if (fs->sb.free_inodes == 0) {
+        return 0;
+    }
+    for (u32 ino = 1; ino < fs->sb.inode_count; ino++) {
+        if (!bit_test(fs->inode_bitmap, ino)) {
+            bit_set(fs->inode_bitmap, ino);
+            fs->sb.free_inodes--;
+            bitmap_sync(fs, fs->inode_bitmap, fs->sb.inode_bitmap, ino, ino);
+            super_sync(fs);
+            return ino;
+        }
+    }
+    return 0;
+}
+
+static void inode_free(qyfs_fs_t* fs, u32 ino) {
+    bit_clear(fs->inode_bitmap, ino);
+    fs->sb.free_inodes++;
+    bitmap_sync(fs, fs->inode_bitmap, fs->sb.inode_bitmap, ino, ino);
+    super_sync(fs);
+}
+
+// inode 表的块也经过页缓存: 键为保留的 inode 0，页号为设备块号
+#define QYFS_META_INO   0
+
+static int meta_fill_block(void* ctx, u32 block, void* page) {
+    qyfs_fs_t* fs = ctx;
+    return fs->dev->read(fs->dev, block, 1, page);
+}
+
+// inode 表读写 (写时读-改-写所在的块)
+static int inode_read(qyfs_fs_t* fs, u32 ino, qyfs_inode_t* inode) {
+    u32 block = fs->sb.inode_table + ino / QYFS_INODES_PER_BLOCK;
+    u32 offset = (ino % QYFS_INODES_PER_BLOCK) * QYFS_INODE_SIZE;
+    if (pagecache_read(fs, QYFS_META_INO, block, offset, inode, sizeof(qyfs_inode_t),
+                       meta_fill_block, fs) == 0) {
+        return 0;
+    }
+    if (fs->dev->read(fs->dev, block, 1, fs->scratch) < 0) {
+        return -1;
+    }
+    memcpy(inode, fs->scratch + offset, sizeof(qyfs_inode_t));
+    return 0;
+}
+
+static int inode_write(qyfs_fs_t* fs, u32 ino, const qyfs_inode_t* inode) {
+    u32 block = fs->sb.inode_table + ino / QYFS_INODES_PER_BLOCK;
+    u32 offset = (ino % QYFS_INODES_PER_BLOCK) * QYFS_INODE_SIZE;
+    if (fs->dev->read(fs->dev, block, 1, fs->scratch) < 0) {
+        return -1;
+    }
+    memcpy(fs->scratch + offset, inode, sizeof(qyfs_inode_t));
+    if (fs->dev->write(fs->dev, block, 1, fs->scratch) < 0) {
+        return -1;
+    }
+    pagecache_write(fs, QYFS_META_INO, ((u64)block << QYFS_BLOCK_SHIFT) + offset, inode, sizeof(qyfs_inode_t));
+    return 0;
+}
+
+// 设备上从 block 的 offset 字节处开始的 len 字节 (跨越的块在磁盘上连续)。
+// 中间的整块一次读写，只有首尾不足一块的部分经过临时缓冲
+static int dev_read_bytes(qyfs_fs_t* fs, u32 block, u32 offset, u8* buffer, u32 len) {
+    block_device_t* dev = fs->dev;
+    if (offset) {
+        u32 n = QYFS_BLOCK_SIZE - offset < len ? QYFS_BLOCK_SIZE - offset : len;
+        if (dev->read(dev, block, 1, fs->scratch) < 0) {
+            return -1;
+        }
+        memcpy(buffer, fs->scratch + offset, n);
+        block++;
+        buffer += n;
+        len -= n;
+    }
+    u32 full = len >> QYFS_BLOCK_SHIFT;
+    if (full) {
+        if (dev->read(dev, block, full, buffer) < 0) {
+            return -1;
+        }
+        block += full;
+        buffer += full << QYFS_BLOCK_SHIFT;
+        len -= full << QYFS_BLOCK_SHIFT;
+    }
+    if (len) {
+        if (dev->read(dev, block, 1, fs->scratch) < 0) {
+            return -1;
+        }
+        memcpy(buffer, fs->scratch, len);
+    }
+    return 0;
+}
+
+static int dev_write_bytes(qyfs_fs_t* fs, u32 block, u32 offset, const u8* buffer, u32 len) {
+    block_device_t* dev = fs->dev;
+    if (offset) {
+        u32 n = QYFS_BLOCK_SIZE - offset < len ? QYFS_BLOCK_SIZE - offset : len;
+        if (dev->read(dev, block, 1, fs->scratch) < 0) {
+            return -1;
+        }
+        memcpy(fs->scratch + offset, buffer, n);
+        if (dev->write(dev, block, 1, fs->scratch) < 0) {
+            return -1;
+        }
+        block++;
+        buffer += n;
+        len -= n;
+    }
+    u32 full = len >> QYFS_BLOCK_SHIFT;
+    if (full) {
+        if (dev->write(dev, block, full, buffer) < 0) {
+            return -1;
+        }
+        block += full;
+        buffer += full << QYFS_BLOCK_SHIFT;
+        len -= full << QYFS_BLOCK_SHIFT;
+    }
+    if (len) {
+        if (dev->read(dev, block, 1, fs->scratch) < 0) {
+            return -1;
+        }
+        memcpy(fs->scratch, buffer, len);
+        if (dev->write(dev, block, 1, fs->scratch) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// extent 数组
+static int extents_reserve(qyfs_node_t* node, u32 count) {
+    if (count <= node->extent_cap) {
+        return 0;
+    }
+    if (count > QYFS_MAX_EXTENTS) {
+        return -1;
+    }
+    u32 cap = node->extent_cap ? node->extent_cap * 2 : QYFS_INLINE_EXTENTS;
+    if (cap < count) {
+        cap = count;
+    }
+    if (cap > QYFS_MAX_EXTENTS) {
+        cap = QYFS_MAX_EXTENTS;
+    }
+    qyfs_extent_t* extents = kmalloc_tagged(cap * sizeof(qyfs_extent_t), KMEM_FS);
+    if (!extents) {
+        return -1;
+    }
+    if (node->extents) {
+        memcpy(extents, node->extents, node->disk.nr_extents * sizeof(qyfs_extent_t));
+        kfree(node->extents);
+    }
+    node->extents = extents;
+    node->extent_cap = cap;
+    return 0;
+}
+
+static int extents_load(qyfs_fs_t* fs, qyfs_node_t* node) {
+    u32 count = node->disk.nr_extents;
+    node->disk.nr_extents = 0;
+    if (extents_reserve(node, count ? count : 1) < 0) {
+        return -1;
+    }
+    u32 inline_count = count < QYFS_INLINE_EXTENTS ? count : QYFS_INLINE_EXTENTS;
+    memcpy(node->extents, node->disk.extents, inline_count * sizeof(qyfs_extent_t));
+    if (count > QYFS_INLINE_EXTENTS) {
+        if (fs->dev->read(fs->dev, node->disk.extent_block, 1, fs->scratch) < 0) {
+            return -1;
+        }
+        memcpy(node->extents + QYFS_INLINE_EXTENTS, fs->scratch,
+               (count - QYFS_INLINE_EXTENTS) * sizeof(qyfs_extent_t));
+    }
+    node->disk.nr_extents = count;
+
+    node->nr_blocks = 0;
+    for (u32 i = 0; i < count; i++) {
+        node->nr_blocks += node->extents[i].count;
+    }
+    return 0;
+}
+
+// 找到包含文件块 fblock 的 extent (二分查找)
+static qyfs_extent_t* extent_find(qyfs_node_t* node, u32 fblock) {
+    u32 lo = 0;
+    u32 hi = node->disk.nr_extents;
+    while (lo < hi) {
+        u32 mid = (lo + hi) / 2;
+        qyfs_extent_t* extent = &node->extents[mid];
+        if (fblock < extent->file_block) {
+            hi = mid;
+        } else if (fblock >= extent->file_block + extent->count) {
+            lo = mid + 1;
+        } else {
+            return extent;
+        }
+    }
+    return NULL;
+}
+
+// 把内存中的 inode (包括 extent) 写回设备
+static int node_sync(qyfs_fs_t* fs, qyfs_node_t* node) {
+    qyfs_inode_t* disk = &node->disk;
+    u32 count = disk->nr_extents;
+    u32 inline_count = count < QYFS_INLINE_EXTENTS ? count : QYFS_INLINE_EXTENTS;
+    memset(disk->extents, 0, sizeof(disk->extents));
+    memcpy(disk->extents, node->extents, inline_count * sizeof(qyfs_extent_t));
+
+    if (count > QYFS_INLINE_EXTENTS) {
+        if (!disk->extent_block) {
+            u32 got;
+            disk->extent_block = alloc_run(fs, 0, 1, &got);
+            if (!disk->extent_block) {
+                return -1;
+            }
+        }
+        memset(fs->scratch, 0, QYFS_BLOCK_SIZE);
+        memcpy(fs->scratch, node->extents + QYFS_INLINE_EXTENTS,
+               (count - QYFS_INLINE_EXTENTS) * sizeof(qyfs_extent_t));
+        if (fs->dev->write(fs->dev, disk->extent_block, 1, fs->scratch) < 0) {
+            return -1;
+        }
+    } else if (disk->extent_block) {
+        free_run(fs, disk->extent_block, 1);
+        disk->extent_block = 0;
+    }
+    return inode_write(fs, node->ino, disk);
+}
+
+static qyfs_node_t* node_get(qyfs_fs_t* fs, u32 ino) {
+    for (qyfs_node_t* node = fs->nodes; node; node = node->next) {
+        if (node->ino == ino) {
+            node->refcount++;
+            return node;
+        }
+    }
+    if (ino == 0 || ino >= fs->sb.inode_count) {
+        return NULL;
+    }
+
+    qyfs_node_t* node = kmalloc_tagged(sizeof(qyfs_node_t), KMEM_FS);
+    if (!node) {
+        return NULL;
+    }
+    memset(node, 0, sizeof(qyfs_node_t));
+    node->ino = ino;
+    node->refcount = 1;
+    if (inode_read(fs, ino, &node->disk) < 0 || node->disk.type == QYFS_FT_FREE ||
+        extents_load(fs, node) < 0) {
+        kfree(node->extents);
+        kfree(node);
+        return NULL;
+    }
+    node->next = fs->nodes;
+    fs->nodes = node;
+    return node;
+}
+
+// 释放文件的全部数据块
+static void node_truncate(qyfs_fs_t* fs, qyfs_node_t* node) {
+    for (u32 i = 0; i < node->disk.nr_extents; i++) {
+        free_run(fs, node->extents[i].start, node->extents[i].count);
+    }
+    node->disk.nr_extents = 0;
+    node->disk.size = 0;
+    node->nr_blocks = 0;
+    node_sync(fs, node);
+    pagecache_invalidate(fs, node->ino, 0);
+}
+
+static void node_put(qyfs_fs_t* fs, qyfs_node_t* node) {
+    if (--node->refcount > 0) {
+        return;
+    }
+
+    // 已经没有目录项指向它: 释放数据块和 inode
+    if (node->disk.links == 0) {
+        node_truncate(fs, node);
+        memset(&node->disk, 0, sizeof(qyfs_inode_t));
+        inode_write(fs, node->ino, &node->disk);
+        inode_free(fs, node->ino);
+    }
+
+    qyfs_node_t** link = &fs->nodes;
+    while (*link != node) {
+        link = &(*link)->next;
+    }
+    *link = node->next;
+    kfree(node->extents);
+    kfree(node);
+}
+
+// 保证文件至少有 blocks 个数据块，新块清零
+static int node_reserve_blocks(qyfs_fs_t* fs, qyfs_node_t* node, u32 blocks) {
+    while (node->nr_blocks < blocks) {
+        u32 count = node->disk.nr_extents;
+        u32 goal = count ? node->extents[count - 1].start + node->extents[count - 1].count : 0;
+        u32 got;
+        u32 start = alloc_run(fs, goal, blocks - node->nr_blocks, &got);
+        if (!start) {
+            return -1; // 空间不足
+        }
+
+        memset(fs->scratch, 0, QYFS_BLOCK_SIZE);
+        for (u32 i = 0; i < got; i++) {
+            fs->dev->write(fs->dev, start + i, 1, fs->scratch);
+        }
+
+        if (count && start == goal) {
+            node->extents[count - 1].count += got; // 紧接在最后一个 extent 之后
+        } else {
+            if (extents_reserve(node, count + 1) < 0) {
+                free_run(fs, start, got);
+                return -1; // extent 太多
+            }
+            node->extents[count].file_block = node->nr_blocks;
+            node->extents[count].start = start;
+            node->extents[count].count = got;
+            node->disk.nr_extents++;
+        }
+        node->nr_blocks += got;
+    }
+    return 0;
+}
+
+typedef struct {
+    qyfs_fs_t* fs;
+    qyfs_node_t* node;
+} qyfs_fill_t;
+
+// 页缓存未命中时读入文件的第 index 块
+static int node_fill_page(void* ctx, u32 index, void* page) {
+    qyfs_fill_t* fill = ctx;
+    qyfs_extent_t* extent = extent_find(fill->node, index);
+    if (!extent) {
+        return -1;
+    }
+    return fill->fs->dev->read(fill->fs->dev, extent->start + (index - extent->file_block), 1, page);
+}
+
+// 读文件内容，返回实际字节数 (失败返回 -1)。逐页经过页缓存，页缓存不可用时直接读设备
+static int node_read(qyfs_fs_t* fs, qyfs_node_t* node, u64 pos, void* buffer, u32 len) {
+    if (pos >= node->disk.size) {
+        return 0;
+    }
+    if (len > node->disk.size - pos) {
+        len = (u32)(node->disk.size - pos);
+    }
+
+    qyfs_fill_t fill = { fs, node };
+    u32 done = 0;
+    while (done < len) {
+        u64 offset = pos + done;
+        u32 fblock = (u32)(offset >> QYFS_BLOCK_SHIFT);
+        u32 block_offset = (u32)offset & (QYFS_BLOCK_SIZE - 1);
+        u32 chunk = QYFS_BLOCK_SIZE - block_offset < len - done ? QYFS_BLOCK_SIZE - block_offset : len - done;
+        if (pagecache_read(fs, node->ino, fblock, block_offset, (u8*)buffer + done, chunk,
+                           node_fill_page, &fill) < 0) {
+            qyfs_extent_t* extent = extent_find(node, fblock);
+            if (!extent) {
+                break; // 大小与 extent 不一致，视为文件结束
+            }
+            if (dev_read_bytes(fs, extent->start + (fblock - extent->file_block), block_offset,
+                               (u8*)buffer + done, chunk) < 0) {
+                return done ? (int)done : -1;
+            }
+        }
+        done += chunk;
+    }
+    return (int)done;
+}
+
+// 写文件内容，每次循环写一个 extent 中的连续部分
+static int node_write(qyfs_fs_t* fs, qyfs_node_t* node, u64 pos, const void* buffer, u32 len) {
+    if (len == 0) {
+        return 0;
+    }
+    if (pos + len > FS_MAX_FILE_SIZE - 1) {
+        return -1;
+    }
+
+    // 文件没有空洞: 写在文件末尾之后时，中间的块也要分配 (新块已清零)
+    u32 blocks = (u32)((pos + len + QYFS_BLOCK_SIZE - 1) >> QYFS_BLOCK_SHIFT);
+    if (node_reserve_blocks(fs, node, blocks) < 0) {
+        u64 capacity = (u64)node->nr_blocks << QYFS_BLOCK_SHIFT;
+        if (pos >= capacity) {
+            return -1;
+        }
+        len = (u32)(capacity - pos); // 写入能放下的部分
+    }
+
+    u32 done = 0;
+    while (done < len) {
+        u64 offset = pos + done;
+        u32 fblock = (u32)(offset >> QYFS_BLOCK_SHIFT);
+        u32 block_offset = (u32)offset & (QYFS_BLOCK_SIZE - 1);
+        qyfs_extent_t* extent = extent_find(node, fblock);
+        if (!extent) {
+            break;
+        }
+        u64 avail = ((u64)(extent->file_block + extent->count - fblock) << QYFS_BLOCK_SHIFT) - block_offset;
+        u32 chunk = len - done < avail ? len - done : (u32)avail;
+        if (dev_write_bytes(fs, extent->start + (fblock - extent->file_block), block_offset,
+                            (const u8*)buffer + done, chunk) < 0) {
+            break;
+        }
+        pagecache_write(fs, node->ino, offset, (const u8*)buffer + done, chunk);
+        done += chunk;
+    }
+
+    if (pos + done > node->disk.size) {
+        node->disk.size = pos + done;
+    }
+    node_sync(fs, node);
+    return done ? (int)done : -1;
+}
+
+// 目录
+
+// 在目录中查找 name，返回 inode 号 (0 表示没有)，*slot 为目录项序号
+static u32 dir_lookup(qyfs_fs_t* fs, qyfs_node_t* dir, const char* name, u32* slot) {
+    u32 nr_blocks = (u32)((dir->disk.size + QYFS_BLOCK_SIZE - 1) >> QYFS_BLOCK_SHIFT);
+    for (u32 b = 0; b < nr_blocks; b++) {
+        int n = node_read(fs, dir, (u64)b << QYFS_BLOCK_SHIFT, fs->dirbuf, QYFS_BLOCK_SIZE);
+        if (n <= 0) {
+            break;
+        }
+        qyfs_dirent_t* entries = (qyfs_dirent_t*)fs->dirbuf;
+        for (u32 i = 0; i < (u32)n / QYFS_DIRENT_SIZE; i++) {
+            if (entries[i].inode && strcmp(entries[i].name, name) == 0) {
+                if (slot) {
+                    *slot = b * QYFS_DIRENTS_PER_BLOCK + i;
+                }
+                return entries[i].inode;
+            }
+        }
+    }
+    return 0;
+}
+
+static int dir_write_slot(qyfs_fs_t* fs, qyfs_node_t* dir, u32 slot, const qyfs_dirent_t* entry) {
+    u64 pos = (u64)slot * QYFS_DIRENT_SIZE;
+    return node_write(fs, dir, pos, entry, QYFS_DIRENT_SIZE) == QYFS_DIRENT_SIZE ? 0 : -1;
+}
+
+// 添加目录项: 优先复用空槽，否则追加在末尾
+static int dir_add(qyfs_fs_t* fs, qyfs_node_t* dir, const char* name, u32 ino, u8 type) {
+    u32 len = strlen(name);
+    if (len == 0 || len > QYFS_NAME_LEN) {
+        return -1;
+    }
+
+    u32 slot = (u32)dir->disk.size / QYFS_DIRENT_SIZE;
+    u32 nr_blocks = (u32)((dir->disk.size + QYFS_BLOCK_SIZE - 1) >> QYFS_BLOCK_SHIFT);
+    for (u32 b = 0; b < nr_blocks; b++) {
+        int n = node_read(fs, dir, (u64)b << QYFS_BLOCK_SHIFT, fs->dirbuf, QYFS_BLOCK_SIZE);
+        qyfs_dirent_t* entries = (qyfs_dirent_t*)fs->dirbuf;
+        u32 i;
+        for (i = 0; n > 0 && i < (u32)n / QYFS_DIRENT_SIZE; i++) {
+            if (!entries[i].inode) {
+                break;
+            }
+        }
+        if (n > 0 && i < (u32)n / QYFS_DIRENT_SIZE) {
+            slot = b * QYFS_DIRENTS_PER_BLOCK + i;
+            break;
+        }
+    }
+
+    qyfs_dirent_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.inode = ino;
+    entry.type = type;
+    entry.name_len = len;
+    memcpy(entry.name, name, len);
+    return dir_write_slot(fs, dir, slot, &entry);
+}
+
+static int dir_remove(qyfs_fs_t* fs, qyfs_node_t* dir, u32 slot) {
+    qyfs_dirent_t entry;
+    memset(&entry, 0, sizeof(entry));
+    return dir_write_slot(fs, dir, slot, &entry);
+}
+
+// 目录中除 "." 和 ".." 外没有别的项
+static int dir_is_empty(qyfs_fs_t* fs, qyfs_node_t* dir) {
+    qyfs_dirent_t entry;
+    for (u64 pos = 0; pos < dir->disk.size; pos += QYFS_DIRENT_SIZE) {
+        if (node_read(fs, dir, pos, &entry, QYFS_DIRENT_SIZE) != QYFS_DIRENT_SIZE) {
+            return 0;
+        }
+        if (entry.inode && strcmp(entry.name, ".") != 0 && strcmp(entry.name, "..") != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 路径解析
+
+// 取出下一个路径分量，返回长度 (0 表示结束，-1 表示太长)
+static int next_component(const char** path, char* name) {
+    const char* p = *path;
+    while (*p == '/') {
+        p++;
+    }
+    int len = 0;
+    while (p[len] && p[len] != '/') {
+        if (len >= QYFS_NAME_LEN) {
+            return -1;
+        }
+        name[len] = p[len];
+        len++;
+    }
+    name[len] = '\0';
+    *path = p + len;
+    return len;
+}
+
+// 在目录 dir 中进入 name (消耗调用者对 dir 的引用)
+static qyfs_node_t* walk(qyfs_fs_t* fs, qyfs_node_t* dir, const char* name) {
+    u32 ino = 0;
+    if (dir->disk.type == QYFS_FT_DIR) {
+        ino = strcmp(name, ".") == 0 ? dir->ino : dir_lookup(fs, dir, name, NULL);
+    }
+    qyfs_node_t* child = ino ? node_get(fs, ino) : NULL;
+    node_put(fs, dir);
+    return child;
+}
+
+// 解析路径，返回加了一次引用的 inode
+static qyfs_node_t* path_lookup(qyfs_fs_t* fs, const char* path) {
+    char name[QYFS_NAME_LEN + 1];
+    qyfs_node_t* node = fs->root;
+    node->refcount++;
+    int len;
+    while ((len = next_component(&path, name)) != 0) {
+        if (len < 0) {
+            node_put(fs, node);
+            return NULL;
+        }
+        node = walk(fs, node, name);
+        if (!node) {
+            return NULL;
+        }
+    }
+    return node;
+}
+
+// 解析到最后一个分量所在的目录，name 中是最后一个分量
+static qyfs_node_t* path_parent(qyfs_fs_t* fs, const char* path, char* name) {
+    char next[QYFS_NAME_LEN + 1];
+    if (next_component(&path, name) <= 0) {
+        return NULL; // 根目录没有父目录
+    }
+    qyfs_node_t* dir = fs->root;
+    dir->refcount++;
+    for (;;) {
+        int len = next_component(&path, next);
+        if (len == 0) {
+            break;
+        }
+        if (len < 0) {
+            node_put(fs, dir);
+            return NULL;
+        }
+        dir = walk(fs, dir, name);
+        if (!dir) {
+            return NULL;
+        }
+        strcpy(name, next);
+    }
+    if (dir->disk.type != QYFS_FT_DIR || strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+        node_put(fs, dir);
+        return NULL;
+    }
+    return dir;
+}
+
+// 创建文件或目录，返回加了一次引用的 inode
+static qyfs_node_t* node_create(qyfs_fs_t* fs, const char* path, u16 type, u16 permissions) {
+    char name[QYFS_NAME_LEN + 1];
+    qyfs_node_t* parent = path_parent(fs, path, name);
+    if (!parent) {
+        return NULL;
+    }
+    if (dir_lookup(fs, parent, name, NULL)) {
+        node_put(fs, parent);
+        return NULL; // 已存在
+    }
+
+    u32 ino = inode_alloc(fs);
+    if (!ino) {
+        node_put(fs, parent);
+        return NULL;
+    }
+    qyfs_inode_t inode;
+    memset(&inode, 0, sizeof(inode));
+    inode.type = type;
+    inode.permissions = permissions;
+    inode.links = type == QYFS_FT_DIR ? 2 : 1; // 目录还有自己的 "."
+    qyfs_node_t* node = NULL;
+    if (inode_write(fs, ino, &inode) < 0 || !(node = node_get(fs, ino))) {
+        inode_free(fs, ino);
+        node_put(fs, parent);
+        return NULL;
+    }
+
+    int ok = 1;
+    if (type == QYFS_FT_DIR) {
+        ok = dir_add(fs, node, ".", ino, QYFS_FT_DIR) == 0 &&
+             dir_add(fs, node, "..", parent->ino, QYFS_FT_DIR) == 0;
+    }
+    if (ok && dir_add(fs, parent, name, ino, type) == 0) {
+        if (type == QYFS_FT_DIR) {
+            parent->disk.links++; // 子目录的 ".."
+            node_sync(fs, parent);
+        }
+    } else {
+        node->disk.links = 0; // 最后一次 node_put 时回收
+        node_put(fs, node);
+        node = NULL;
+    }
+    node_put(fs, parent);
+    return node;
+}
+
+static void node_stat(qyfs_node_t* node, const char* name, dir_entry_t* stat) {
+    memset(stat, 0, sizeof(dir_entry_t));
+    strncpy(stat->name, name, FS_MAX_NAME_LEN);
+    stat->inode = node->ino;
+    stat->type = node->disk.type;
+    stat->permissions = node->disk.permissions;
+    stat->size = node->disk.size;
+    stat->create_time = node->disk.create_time;
+    stat->modify_time = node->disk.modify_time;
+    stat->access_time = node->disk.access_time;
+}
+
+// QiYuanOS 文件系统实现
+static int qyfs_mount(const char* device, void** data) {
+    block_device_t* dev = blkdev_find(device);
+    if (!dev) {
+        printf("QYFS: 找不到设备 %s\n", device);
+        return -1;
+    }
+
+    qyfs_fs_t* fs = kmalloc_tagged(sizeof(qyfs_fs_t), KMEM_FS);
+    u8* scratch = kmalloc_tagged(QYFS_BLOCK_SIZE, KMEM_FS);
+    u8* dirbuf = kmalloc_tagged(QYFS_BLOCK_SIZE, KMEM_FS);
+    if (!fs || !scratch || !dirbuf || dev->read(dev, 0, 1, scratch) < 0) {
+        kfree(fs);
+        kfree(scratch);
+        kfree(dirbuf);
+        return -1;
+    }
+    memset(fs, 0, sizeof(qyfs_fs_t));
+    memcpy(&fs->sb, scratch, sizeof(qyfs_super_t));
+    fs->dev = dev;
+    fs->scratch = scratch;
+    fs->dirbuf = dirbuf;
+
+    qyfs_super_t* sb = &fs->sb;
+    if (sb->magic != QYFS_MAGIC || sb->version != QYFS_VERSION || sb->block_size != QYFS_BLOCK_SIZE ||
+        sb->total_blocks > dev->nr_blocks || sb->data_start >= sb->total_blocks) {
+        printf("QYFS: %s 不是有效的 QYFS 文件系统\n", device);
+        goto fail;
+    }
+
+    fs->inode_bitmap = kmalloc_tagged(sb->inode_bitmap_blocks * QYFS_BLOCK_SIZE, KMEM_FS);
+    fs->block_bitmap = kmalloc_tagged(sb->block_bitmap_blocks * QYFS_BLOCK_SIZE, KMEM_FS);
+    if (!fs->inode_bitmap || !fs->block_bitmap ||
+        dev->read(dev, sb->inode_bitmap, sb->inode_bitmap_blocks, fs->inode_bitmap) < 0 ||
+        dev->read(dev, sb->block_bitmap, sb->block_bitmap_blocks, fs->block_bitmap) < 0) {
+        goto fail;
+    }
+
+    // 实例还没有公开，不需要加锁
+    fs->root = node_get(fs, sb->root_inode);
+    if (!fs->root || fs->root->disk.type != QYFS_FT_DIR) {
+        goto fail;
+    }
+
+    printf("QYFS: %s, %u/%u 块空闲, %u/%u 个 inode 空闲\n", device,
+           sb->free_blocks, sb->total_blocks, sb->free_inodes, sb->inode_count);
+    *data = fs;
+    return 0;
+
+fail:
+    while (fs->nodes) {
+        qyfs_node_t* node = fs->nodes;
+        fs->nodes = node->next;
+        kfree(node->extents);
+        kfree(node);
+    }
+    kfree(fs->inode_bitmap);
+    kfree(fs->block_bitmap);
+    kfree(scratch);
+    kfree(dirbuf);
+    kfree(fs);
+    return -1;
+}
+
+// VFS 保证卸载时没有打开的文件
+static int qyfs_umount(void* data) {
+    qyfs_fs_t* fs = data;
+    u32 flags = spin_lock_irqsave(&fs->lock);
+    node_put(fs, fs->root);
+    super_sync(fs);
+    spin_unlock_irqrestore(&fs->lock, flags);
+
+    // 下次挂载可能分配到相同的地址
+    pagecache_invalidate(fs, PAGECACHE_ALL_INODES, 0);
+
+    klog(KLOG_FS, KLOG_DEBUG, "卸载 QYFS 文件系统: %s\n", fs->dev->name);
+    kfree(fs->inode_bitmap);
+    kfree(fs->block_bitmap);
+    kfree(fs->scratch);
+    kfree(fs->dirbuf);
+    kfree(fs);
+    return 0;
+}
+
+static void* qyfs_open(void* data, const char* path, int flags) {
+    qyfs_fs_t* fs = data;
+    u32 irq = spin_lock_irqsave(&fs->lock);
+    qyfs_node_t* node = path_lookup(fs, path);
+    if (!node && (flags & FS_OPEN_CREATE)) {
+        node = node_create(fs, path, QYFS_FT_FILE, QYFS_PERM_READ | QYFS_PERM_WRITE);
+    }
+    if (!node) {
+        spin_unlock_irqrestore(&fs->lock, irq);
+        return NULL;
+    }
+
+    int writable = flags & FS_PERM_WRITE;
+    if (writable && (node->disk.type != QYFS_FT_FILE || !(node->disk.permissions & QYFS_PERM_WRITE))) {
+        node_put(fs, node);
+        spin_unlock_irqrestore(&fs->lock, irq);
+        return NULL;
+    }
+    if (writable && (flags & FS_OPEN_TRUNC)) {
+        node_truncate(fs, node);
+    }
+    spin_unlock_irqrestore(&fs->lock, irq);
+    return node;
+}
+
+static void qyfs_close(void* data, void* inode) {
+    qyfs_fs_t* fs = data;
+    u32 flags = spin_lock_irqsave(&fs->lock);
+    node_put(fs, inode); // 已删除的文件在最后一次关闭时回收
+    spin_unlock_irqrestore(&fs->lock, flags);
+}
+
+static ssize_t qyfs_read(void* data, void* inode, u64 pos, void* buffer, size_t size) {
+    qyfs_fs_t* fs = data;
+    qyfs_node_t* node = inode;
+    u32 flags = spin_lock_irqsave(&fs->lock);
+    int n = -1;
+    if (node->disk.type == QYFS_FT_FILE) {
+        n = node_read(fs, node, pos, buffer, size);
+    }
+    spin_unlock_irqrestore(&fs->lock, flags);
+    return n;
+}
+
+static ssize_t qyfs_write(void* data, void* inode, u64 pos, const void* buffer, size_t size) {
+    qyfs_fs_t* fs = data;
+    u32 flags = spin_lock_irqsave(&fs->lock);
+    int n = node_write(fs, inode, pos, buffer, size);
+    spin_unlock_irqrestore(&fs->lock, flags);
+    return n;
+}
+
+static int qyfs_getattr(void* data, void* inode, dir_entry_t* stat) {
+    qyfs_fs_t* fs = data;
+    u32 flags = spin_lock_irqsave(&fs->lock);
+    node_stat(inode, "", stat);
+    spin_unlock_irqrestore(&fs->lock, flags);
+    return 0;
+}
+
+static int qyfs_mkdir(void* data, const char* path, u32 permissions) {
+    qyfs_fs_t* fs = data;
+    u32 flags = spin_lock_irqsave(&fs->lock);
+    qyfs_node_t* node = node_create(fs, path, QYFS_FT_DIR, permissions & 0x7);
+    if (node) {
+        node_put(fs, node);
+    }
+    spin_unlock_irqrestore(&fs->lock, flags);
+    return node ? 0 : -1;
+}
+
+// 删除目录项 (rmdir 和 unlink 共用)
+static int remove_entry(qyfs_fs_t* fs, const char* path, u16 type) {
+    char name[QYFS_NAME_LEN + 1];
+    u32 flags = spin_lock_irqsave(&fs->lock);
+    qyfs_node_t* parent = path_parent(fs, path, name);
+    if (!parent) {
+        spin_unlock_irqrestore(&fs->lock, flags);
+        return -1;
+    }
+
+    int result = -1;
+    u32 slot;
+    u32 ino = dir_lookup(fs, parent, name, &slot);
+    qyfs_node_t* node = ino ? node_get(fs, ino) : NULL;
+    if (node && node->disk.type == type && (type != QYFS_FT_DIR || dir_is_empty(fs, node)) &&
+        dir_remove(fs, parent, slot) == 0) {
+        if (type == QYFS_FT_DIR) {
+            node->disk.links = 0;
+            parent->disk.links--;
+            node_sync(fs, parent);
+        } else {
+            node->disk.links--;
+        }
+        node_sync(fs, node);
+        result = 0;
+    }
+    if (node) {
+        node_put(fs, node); // 没有链接且没有打开时回收
+    }
+    node_put(fs, parent);
+    spin_unlock_irqrestore(&fs->lock, flags);
+    return result;
+}
+
+static int qyfs_rmdir(void* data, const char* path) {
+    return remove_entry(data, path, QYFS_FT_DIR);
+}
+
+static int qyfs_unlink(void* data, const char* path) {
+    return remove_entry(data, path, QYFS_FT_FILE);
+}
+
+// dir 是否等于 ancestor 或在它之下 (沿 ".." 向上找)
+static int is_descendant(qyfs_fs_t* fs, qyfs_node_t* dir, u32 ancestor) {
+    qyfs_node_t* node = dir;
+    node->refcount++;
+    for (;;) {
+        if (node->ino == ancestor) {
+            node_put(fs, node);
+            return 1;
+        }
+        if (node == fs->root) {
+            node_put(fs, node);
+            return 0;
+        }
+        node = walk(fs, node, "..");
+        if (!node) {
+            return 1; // 目录结构损坏时拒绝
+        }
+    }
+}
+
+static int qyfs_rename(void* data, const char* old_path, const char* new_path) {
+    qyfs_fs_t* fs = data;
+    char old_name[QYFS_NAME_LEN + 1];
+    char new_name[QYFS_NAME_LEN + 1];
+    u32 flags = spin_lock_irqsave(&fs->lock);
+    qyfs_node_t* old_parent = path_parent(fs, old_path, old_name);
+    qyfs_node_t* new_parent = old_parent ? path_parent(fs, new_path, new_name) : NULL;
+    int result = -1;
+    u32 slot;
+    u32 ino = new_parent ? dir_lookup(fs, old_parent, old_name, &slot) : 0;
+    qyfs_node_t* node = ino ? node_get(fs, ino) : NULL;
+
+    // 目标已存在，或把目录移到它自己下面时拒绝
+    if (node && !dir_lookup(fs, new_parent, new_name, NULL) &&
+        !(node->disk.type == QYFS_FT_DIR && is_descendant(fs, new_parent, ino)) &&
+        dir_add(fs, new_parent, new_name, ino, node->disk.type) == 0) {
+        dir_remove(fs, old_parent, slot);
+        if (node->disk.type == QYFS_FT_DIR && old_parent != new_parent) {
+            u32 dotdot;
+            if (dir_lookup(fs, node, "..", &dotdot)) {
+                qyfs_dirent_t entry;
+                memset(&entry, 0, sizeof(entry));
+                entry.inode = new_parent->ino;
+                entry.type = QYFS_FT_DIR;
+                entry.name_len = 2;
+                strcpy(entry.name, "..");
+                dir_write_slot(fs, node, dotdot, &entry);
+            }
+            old_parent->disk.links--;
+            new_parent->disk.links++;
+            node_sync(fs, old_parent);
+            node_sync(fs, new_parent);
+        }
+        result = 0;
+    }
+
+    if (node) {
+        node_put(fs, node);
+    }
+    if (new_parent) {
+        node_put(fs, new_parent);
+    }
+    if (old_parent) {
+        node_put(fs, old_parent);
+    }
+    spin_unlock_irqrestore(&fs->lock, flags);
+    return result;
+}
+
+// pos 是目录项的字节偏移
+static int qyfs_readdir(void* data, void* inode, u64* pos, dir_entry_t* entry) {
+    qyfs_fs_t* fs = data;
+    qyfs_node_t* dir = inode;
+    u32 flags = spin_lock_irqsave(&fs->lock);
+    if (dir->disk.type != QYFS_FT_DIR) {
+        spin_unlock_irqrestore(&fs->lock, flags);
+        return -1;
+    }
+
+    int result = 0;
+    qyfs_dirent_t dirent;
+    while (*pos < dir->disk.size) {
+        int n = node_read(fs, dir, *pos, &dirent, QYFS_DIRENT_SIZE);
+        if (n != QYFS_DIRENT_SIZE) {
+            result = -1;
+            break;
+        }
+        *pos += QYFS_DIRENT_SIZE;
+        if (!dirent.inode) {
+            continue; // 空槽
+        }
+        qyfs_node_t* node = node_get(fs, dirent.inode);
+        if (!node) {
+            continue;
+        }
+        node_stat(node, dirent.name, entry);
+        node_put(fs, node);
+        result = 1;
+        break;
+    }
+    spin_unlock_irqrestore(&fs->lock, flags);
+    return result;
+}
+
+static int qyfs_stat(void* data, const char* path, dir_entry_t* stat) {
+    qyfs_fs_t* fs = data;
+    char name[QYFS_NAME_LEN + 1];
+    u32 flags = spin_lock_irqsave(&fs->lock);
+    qyfs_node_t* node = path_lookup(fs, path);
+    if (!node) {
+        spin_unlock_irqrestore(&fs->lock, flags);
+        return -1;
+    }
+
+    // 名字取最后一个分量 (根目录为 "/")
+    strcpy(name, "/");
+    char component[QYFS_NAME_LEN + 1];
+    while (next_component(&path, component) > 0) {
+        strcpy(name, component);
+    }
+    node_stat(node, name, stat);
+    node_put(fs, node);
+    spin_unlock_irqrestore(&fs->lock, flags);
+    return 0;
+}
+
+// QYFS 操作接口
+static fs_operations_t qyfs_ops = {
+    .mount = qyfs_mount,
+    .umount = qyfs_umount,
+    .open = qyfs_open,
+    .close = qyfs_close,
+    .read = qyfs_read,
+    .write = qyfs_write,
+    .getattr = qyfs_getattr,
+    .mkdir = qyfs_mkdir,
+    .rmdir = qyfs_rmdir,
+    .unlink = qyfs_unlink,
+    .rename = qyfs_rename,
+    .readdir = qyfs_readdir,
+    .stat = qyfs_stat
+};
+
+// QYFS 文件系统定义
+static filesystem_t qyfs = {
+    .name = "qyfs",
+    .type = FS_TYPE_QYFS,
+    .ops = &qyfs_ops
+};
+
+int qyfs_register(void) {
+    return fs_register(&qyfs);
+}
+
+// 格式化: 只有根目录 ("." 和 "..") 的空文件系统
+int qyfs_format(block_device_t* dev, u32 inode_count) {
+    qyfs_super_t sb;
+    qyfs_layout(&sb, dev->nr_blocks, inode_count);
+    if (sb.data_start >= dev->nr_blocks) {
+        return -1; // 设备太小
+    }
+
+    u32 bitmap_size = sb.block_bitmap_blocks * QYFS_BLOCK_SIZE;
+    u8* block = kmalloc_tagged(QYFS_BLOCK_SIZE, KMEM_FS);
+    u8* bitmap = kmalloc_tagged(bitmap_size, KMEM_FS);
+    if (!block || !bitmap) {
+        kfree(block);
+        kfree(bitmap);
+        return -1;
+    }
+
+    // 清空全部元数据
+    memset(block, 0, QYFS_BLOCK_SIZE);
+    for (u32 b = 1; b < sb.data_start; b++) {
+        dev->write(dev, b, 1, block);
+    }
+
+    // inode 0 保留，inode 1 为根目录
+    block[0] = 0x3;
+    dev->write(dev, sb.inode_bitmap, 1, block);
+
+    // 元数据和根目录的数据块 (data_start) 已用
+    memset(bitmap, 0, bitmap_size);
+    for (u32 b = 0; b <= sb.data_start; b++) {
+        bit_set(bitmap, b);
+    }
+    dev->write(dev, sb.block_bitmap, sb.block_bitmap_blocks, bitmap);
+
+    // 根目录 inode
+    memset(block, 0, QYFS_BLOCK_SIZE);
+    qyfs_inode_t* root = (qyfs_inode_t*)(block + QYFS_ROOT_INO * QYFS_INODE_SIZE);
+    root->type = QYFS_FT_DIR;
+    root->permissions = QYFS_PERM_READ | QYFS_PERM_WRITE | QYFS_PERM_EXECUTE;
+    root->links = 2;
+    root->nr_extents = 1;
+    root->size = 2 * QYFS_DIRENT_SIZE;
+    root->extents[0].file_block = 0;
+    root->extents[0].start = sb.data_start;
+    root->extents[0].count = 1;
+    dev->write(dev, sb.inode_table, 1, block);
+
+    // 根目录内容: 根目录的 ".." 指向自己
+    memset(block, 0, QYFS_BLOCK_SIZE);
+    qyfs_dirent_t* entries = (qyfs_dirent_t*)block;
+    for (int i = 0; i < 2; i++) {
+        entries[i].inode = QYFS_ROOT_INO;
+        entries[i].type = QYFS_FT_DIR;
+        entries[i].name_len = i + 1;
+        strcpy(entries[i].name, i == 0 ? "." : "..");
+    }
+    dev->write(dev, sb.data_start, 1, block);
+
+    sb.free_blocks--;
+    sb.free_inodes--;
+    sb.alloc_hint = sb.data_start + 1;
+    memset(block, 0, QYFS_BLOCK_SIZE);
+    memcpy(block, &sb, sizeof(sb));
+    int result = dev->write(dev, 0, 1, block);
+
+    kfree(block);
+    kfree(bitmap);
+    printf("QYFS: 格式化 %s, %u 块, %u 个 inode\n", dev->name, sb.total_blocks, sb.inode_count);
+    return result;
+}
@@ -0,0 +1,124 @@
+#ifndef QYFS_H
+#define QYFS_H
+
+#include <stdint.h>
+
+// QYFS 磁盘格式 (内核和宿主机上的 tools/mkqyfs 共用，只依赖 stdint.h)
+//
+//   块 0                超级块
+//   inode_bitmap        inode 位图
+//   block_bitmap        块位图 (覆盖整个设备，元数据所占的块也标记为已用)
+//   inode_table         inode 表，每块 32 个 inode
+//   data_start ...      数据块
+//
+// 文件内容用 extent (文件块号, 磁盘起始块, 块数) 描述，前 6 个放在 inode 内，
+// 更多的放在一个间接 extent 块中。文件没有空洞: extent 按文件块号排列且首尾相接。
+// 目录内容是定长 64 字节目录项的数组，包含 "." 和 ".."。所有整数为小端序。
+
+#define QYFS_MAGIC              0x53465951      // "QYFS"
+#define QYFS_VERSION            1
+#define QYFS_BLOCK_SHIFT        12
+#define QYFS_BLOCK_SIZE         (1u << QYFS_BLOCK_SHIFT)
+#define QYFS_BITS_PER_BLOCK     (QYFS_BLOCK_SIZE * 8)
+
+#define QYFS_INODE_SIZE         128
+#define QYFS_INODES_PER_BLOCK   (QYFS_BLOCK_SIZE / QYFS_INODE_SIZE)
+#define QYFS_ROOT_INO           1               // inode 0 保留，表示 "无"
+
+#define QYFS_INLINE_EXTENTS     6
+#define QYFS_EXTENTS_PER_BLOCK  (QYFS_BLOCK_SIZE / 12)
+#define QYFS_MAX_EXTENTS        (QYFS_INLINE_EXTENTS + QYFS_EXTENTS_PER_BLOCK)
+
+#define QYFS_DIRENT_SIZE        64
+#define QYFS_NAME_LEN           55
+#define QYFS_DIRENTS_PER_BLOCK  (QYFS_BLOCK_SIZE / QYFS_DIRENT_SIZE)
+
+// inode 类型 (与 fs.h 的 FS_TYPE_FILE / FS_TYPE_DIR 相同)
+#define QYFS_FT_FREE            0
+#define QYFS_FT_FILE            1
+#define QYFS_FT_DIR             2
+
+// 权限位 (与 fs.h 的 FS_PERM_* 相同)
+#define QYFS_PERM_READ          0x01
+#define QYFS_PERM_WRITE         0x02
+#define QYFS_PERM_EXECUTE       0x04
+
+typedef struct {
+    uint32_t file_block;        // 文件内起始块号
+    uint32_t start;             // 磁盘起始块号
+    uint32_t count;             // 连续块数
+} qyfs_extent_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_size;
+    uint32_t total_blocks;
+    uint32_t inode_count;
+    uint32_t inode_bitmap;          // 各区域的起始块和块数
+    uint32_t inode_bitmap_blocks;
+    uint32_t block_bitmap;
+    uint32_t block_bitmap_blocks;
+    uint32_t inode_table;
+    uint32_t inode_table_blocks;
+    uint32_t data_start;
+    uint32_t free_blocks;
+    uint32_t free_inodes;
+    uint32_t alloc_hint;            // 下次分配从这里开始找 (next-fit)
+    uint32_t root_inode;
+} qyfs_super_t;
+
+typedef struct {
+    uint16_t type;                  // QYFS_FT_*
+    uint16_t permissions;           // QYFS_PERM_*
+    uint16_t links;                 // 指向它的目录项数 (目录还包括自己的 "." 和子目录的 "..")
+    uint16_t nr_extents;            // 内联和间接 extent 的总数
+    uint64_t size;                  // 字节数
+    uint64_t create_time;           // 秒 (mkqyfs 写入宿主机时间，内核没有实时时钟时为 0)
+    uint64_t modify_time;
+    uint64_t access_time;
+    qyfs_extent_t extents[QYFS_INLINE_EXTENTS];
+    uint32_t extent_block;          // 间接 extent 块，0 表示没有
+    uint32_t reserved[3];
+} qyfs_inode_t;
+
+typedef struct {
+    uint32_t inode;                 // 0 表示空槽
+    uint8_t type;                   // QYFS_FT_*
+    uint8_t name_len;
+    uint16_t reserved;
+    char name[QYFS_NAME_LEN + 1];   // 以 0 结尾
+} qyfs_dirent_t;
+
+// 按设备块数和 inode 数计算各区域的位置 (mkfs 使用)
+static inline void qyfs_layout(qyfs_super_t* sb, uint32_t total_blocks, uint32_t inode_count) {
+    inode_count = (inode_count + QYFS_INODES_PER_BLOCK - 1) / QYFS_INODES_PER_BLOCK * QYFS_INODES_PER_BLOCK;
+    sb->magic = QYFS_MAGIC;
+    sb->version = QYFS_VERSION;
+    sb->block_size = QYFS_BLOCK_SIZE;
+    sb->total_blocks = total_blocks;
+    sb->inode_count = inode_count;
+    sb->inode_bitmap = 1;
+    sb->inode_bitmap_blocks = (inode_count + QYFS_BITS_PER_BLOCK - 1) / QYFS_BITS_PER_BLOCK;
+    sb->block_bitmap = sb->inode_bitmap + sb->inode_bitmap_blocks;
+    sb->block_bitmap_blocks = (total_blocks + QYFS_BITS_PER_BLOCK - 1) / QYFS_BITS_PER_BLOCK;
+    sb->inode_table = sb->block_bitmap + sb->block_bitmap_blocks;
+    sb->inode_table_blocks = inode_count / QYFS_INODES_PER_BLOCK;
+    sb->data_start = sb->inode_table + sb->inode_table_blocks;
+    sb->free_blocks = total_blocks > sb->data_start ? total_blocks - sb->data_start : 0;
+    sb->free_inodes = inode_count - 1;  // inode 0 保留
+    sb->alloc_hint = sb->data_start;
+    sb->root_inode = QYFS_ROOT_INO;
+}
+
+#ifdef __KERNEL__
+struct block_device;
+
+// 注册 QYFS 文件系统类型
+int qyfs_register(void);
+
+// 在设备上建立只有根目录的空文件系统 (没有 mkqyfs 镜像时使用)
+int qyfs_format(struct block_device* dev, uint32_t inode_count);
+#endif
+
+#endif // QYFS_H
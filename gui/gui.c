@@ -1,4 +1,10 @@
 #include "gui.h"
+#include "../kernel/clock.h"
+#include "../kernel/klog.h"
+#include "../kernel/wait.h"
+#include "../kernel/mm.h"
+#include "../kernel/vmm.h"
+#include "../kernel/spinlock.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -9,6 +15,24 @@ static int screen_width = 1024;
 static int screen_height = 768;
 static u32* framebuffer = NULL;
 
+// 图标缓存: 同一路径的图标只加载一次，按引用计数共享
+#define ICON_PATH_MAX 64
+
+typedef struct icon_entry {
+    char path[ICON_PATH_MAX];
+    u8* data;
+    int width;
+    int height;
+    int refcount;
+    struct icon_entry* next;
+} icon_entry_t;
+
+static icon_entry_t* icon_cache = NULL;
+static spinlock_t icon_lock = SPINLOCK_INIT;
+
+static window_t* window_alloc(const char* title, int x, int y, int width, int height, u32 style,
+                              u32 tag);
+
 // 简单的字体数据 (8x8 像素)
 static const u8 font_8x8[95][8] = {
     {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // 空格
@@ -32,7 +56,7 @@ int gui_init(void) {
     printf("初始化图形界面系统...\n");
     
     // 分配帧缓冲区
-    framebuffer = kmalloc(screen_width * screen_height * 4);
+    framebuffer = kmalloc_tagged(screen_width * screen_height * 4, KMEM_GUI);
     if (!framebuffer) {
         printf("无法分配帧缓冲区\n");
         return -1;
@@ -49,7 +73,7 @@ int gui_init(void) {
     desktop.show_icons = 1;
     
     // 创建桌面窗口
-    desktop.desktop_window = window_create("Desktop", 0, 0, screen_width, screen_height, 0);
+    desktop.desktop_window = window_alloc("Desktop", 0, 0, screen_width, screen_height, 0, KMEM_GUI);
     desktop.desktop_window->background_color = desktop.desktop_color;
     
     // 清屏
@@ -105,13 +129,16 @@ void gui_update(void) {
 }
 
 // 窗口管理
-window_t* window_create(const char* title, int x, int y, int width, int height, u32 style) {
-    window_t* win = kmalloc(sizeof(window_t));
+// 桌面自己的窗口计入 KMEM_GUI，应用创建的窗口计入 KMEM_APPS
+static window_t* window_alloc(const char* title, int x, int y, int width, int height, u32 style,
+                              u32 tag) {
+    window_t* win = kmalloc_tagged(sizeof(window_t), tag);
     if (!win) {
         return NULL;
     }
     
     memset(win, 0, sizeof(window_t));
+    win->mem_tag = tag;
     strncpy(win->title, title, sizeof(win->title) - 1);
     win->rect.x = x;
     win->rect.y = y;
@@ -133,16 +160,20 @@ window_t* window_create(const char* title, int x, int y, int width, int height,
     win->next = desktop.windows;
     desktop.windows = win;
     
-    printf("创建窗口: %s (%d, %d, %d, %d)\n", title, x, y, width, height);
+    klog(KLOG_GUI, KLOG_DEBUG, "创建窗口: %s (%d, %d, %d, %d)\n", title, x, y, width, height);
     return win;
 }
 
+window_t* window_create(const char* title, int x, int y, int width, int height, u32 style) {
+    return window_alloc(title, x, y, width, height, style, KMEM_APPS);
+}
+
 void window_destroy(window_t* win) {
     if (!win) {
         return;
     }
     
-    printf("销毁窗口: %s\n", win->title);
+    klog(KLOG_GUI, KLOG_DEBUG, "销毁窗口: %s\n", win->title);
     
     // 从窗口列表中移除
     if (desktop.windows == win) {
@@ -165,6 +196,7 @@ void window_destroy(window_t* win) {
         ctrl = next;
     }
     
+    gui_free_icon((u8*)win->icon_data);
     kfree(win);
 }
 
@@ -301,7 +333,7 @@ control_t* control_create(window_t* parent, u32 type, int x, int y, int width, i
         return NULL;
     }
     
-    control_t* ctrl = kmalloc(sizeof(control_t));
+    control_t* ctrl = kmalloc_tagged(sizeof(control_t), parent->mem_tag);
     if (!ctrl) {
         return NULL;
     }
@@ -404,21 +436,24 @@ void control_set_colors(control_t* ctrl, color_t fg, color_t bg) {
 }
 
 // 绘图函数
-void gui_clear_rect(rect_t* rect, color_t color) {
-    if (!framebuffer || !rect) {
-        return;
-    }
-    
+static void fill_rect(u32* buffer, rect_t* rect, color_t color) {
     u32 color_value = color_to_u32(color);
     for (int y = rect->y; y < rect->y + rect->height && y < screen_height; y++) {
         for (int x = rect->x; x < rect->x + rect->width && x < screen_width; x++) {
             if (x >= 0 && y >= 0) {
-                framebuffer[y * screen_width + x] = color_value;
+                buffer[y * screen_width + x] = color_value;
             }
         }
     }
 }
 
+void gui_clear_rect(rect_t* rect, color_t color) {
+    if (!framebuffer || !rect) {
+        return;
+    }
+    fill_rect(framebuffer, rect, color);
+}
+
 void gui_draw_rect(rect_t* rect, color_t color) {
     if (!rect) {
         return;
@@ -514,16 +549,57 @@ void gui_draw_image(int x, int y, int width, int height, const u8* data) {
 }
 
 // 事件处理
+// 事件队列 (环形缓冲，满时丢弃最新事件)
+// 生产者是输入 tasklet，消费者是任意 CPU 上等待事件的任务，head/tail 由 event_lock 保护
+#define EVENT_QUEUE_SIZE 64
+static event_t event_queue[EVENT_QUEUE_SIZE];
+static u32 event_head = 0;
+static u32 event_tail = 0;
+static spinlock_t event_lock = SPINLOCK_INIT;
+static wait_queue_t event_wait = WAIT_QUEUE_INIT;   // 等待事件的任务
+
 int gui_poll_event(event_t* event) {
-    // 简化实现，返回无事件
-    if (event) {
+    if (!event) {
+        return 0;
+    }
+    u32 flags = spin_lock_irqsave(&event_lock);
+    if (event_head == event_tail) {
+        spin_unlock_irqrestore(&event_lock, flags);
         event->type = EVENT_NONE;
+        return 0;
     }
-    return 0;
+    event_t next = event_queue[event_head % EVENT_QUEUE_SIZE];
+    event_head++;
+    spin_unlock_irqrestore(&event_lock, flags);
+    *event = next;
+    return 1;
 }
 
 void gui_push_event(event_t* event) {
-    // 简化实现，不做处理
+    if (!event) {
+        return;
+    }
+    // 未指定时间戳的事件以入队时刻为准 (启动以来的毫秒数)
+    if (event->timestamp == 0) {
+        event->timestamp = clock_now_ms();
+    }
+    u32 flags = spin_lock_irqsave(&event_lock);
+    if (event_tail - event_head >= EVENT_QUEUE_SIZE) {
+        spin_unlock_irqrestore(&event_lock, flags);
+        return;
+    }
+    event_queue[event_tail % EVENT_QUEUE_SIZE] = *event;
+    event_tail++;
+    spin_unlock_irqrestore(&event_lock, flags);
+    wake_up(&event_wait);
+}
+
+// 阻塞直到取到一个事件
+void gui_wait_event(event_t* event) {
+    if (!event) {
+        return;
+    }
+    wait_event(&event_wait, gui_poll_event(event));
 }
 
 void gui_set_event_handler(void (*handler)(event_t* event)) {
@@ -555,29 +631,81 @@ void desktop_set_icons_visible(int visible) {
 
 // 图标加载函数
 int gui_load_icon(const char* path, u8** out_data, int* out_width, int* out_height) {
+    u32 flags = spin_lock_irqsave(&icon_lock);
+    for (icon_entry_t* entry = icon_cache; entry; entry = entry->next) {
+        if (strncmp(entry->path, path, ICON_PATH_MAX) == 0) {
+            entry->refcount++;
+            *out_data = entry->data;
+            *out_width = entry->width;
+            *out_height = entry->height;
+            spin_unlock_irqrestore(&icon_lock, flags);
+            return 0;
+        }
+    }
+    spin_unlock_irqrestore(&icon_lock, flags);
+
     // 简化实现: 这里应该加载实际的图像文件
     // 对于示例，我们创建一个简单的16x16图标
-    *out_width = 16;
-    *out_height = 16;
-    *out_data = kmalloc(*out_width * *out_height * 4);
-    if (!*out_data) {
+    icon_entry_t* entry = kmalloc_tagged(sizeof(icon_entry_t), KMEM_GUI);
+    if (!entry) {
+        return -1;
+    }
+    entry->width = 16;
+    entry->height = 16;
+    entry->data = kmalloc_tagged(entry->width * entry->height * 4, KMEM_GUI);
+    if (!entry->data) {
+        kfree(entry);
         return -1;
     }
+    strncpy(entry->path, path, ICON_PATH_MAX - 1);
+    entry->path[ICON_PATH_MAX - 1] = '\0';
+    entry->refcount = 1;
     
     // 填充一些示例颜色 (可以替换为实际图像数据)
-    for (int i = 0; i < *out_width * *out_height; i++) {
-        (*out_data)[i*4 + 0] = 0;   // R
-        (*out_data)[i*4 + 1] = 0;   // G
-        (*out_data)[i*4 + 2] = 255; // B
-        (*out_data)[i*4 + 3] = 255; // A
+    for (int i = 0; i < entry->width * entry->height; i++) {
+        entry->data[i*4 + 0] = 0;   // R
+        entry->data[i*4 + 1] = 0;   // G
+        entry->data[i*4 + 2] = 255; // B
+        entry->data[i*4 + 3] = 255; // A
     }
-    
+
+    flags = spin_lock_irqsave(&icon_lock);
+    entry->next = icon_cache;
+    icon_cache = entry;
+    spin_unlock_irqrestore(&icon_lock, flags);
+
+    *out_data = entry->data;
+    *out_width = entry->width;
+    *out_height = entry->height;
     return 0;
 }
 
 void gui_free_icon(u8* data) {
-    if (data) {
-        kfree(data);
+    if (!data) {
+        return;
+    }
+
+    u32 flags = spin_lock_irqsave(&icon_lock);
+    icon_entry_t** link = &icon_cache;
+    while (*link && (*link)->data != data) {
+        link = &(*link)->next;
+    }
+    icon_entry_t* entry = *link;
+    if (!entry) {
+        spin_unlock_irqrestore(&icon_lock, flags);
+        kfree(data); // 不在缓存中的图标
+        return;
+    }
+    if (--entry->refcount > 0) {
+        entry = NULL;
+    } else {
+        *link = entry->next;
+    }
+    spin_unlock_irqrestore(&icon_lock, flags);
+
+    if (entry) {
+        kfree(entry->data);
+        kfree(entry);
     }
 }
 
@@ -601,4 +729,59 @@ int gui_get_mouse_button_state(int button) {
 
 int gui_get_key_state(int key) {
     return 0;
-}
\ No newline at end of file
+}
+
+// TLB 性能测试: 全屏清除帧缓冲区，比较直接映射 (4MB 大页) 与 4KB 页映射的耗时。
+// 4KB 映射建在一个临时地址空间的用户区，指向同一块物理内存，只在本 CPU 上关中断使用。
+#define TLB_BENCH_ROUNDS    16
+
+static u64 clear_screen_ns(u32* buffer) {
+    rect_t screen = {0, 0, screen_width, screen_height};
+    u64 start = clock_now();
+    for (u32 i = 0; i < TLB_BENCH_ROUNDS; i++) {
+        fill_rect(buffer, &screen, (color_t){(u8)i, (u8)i, (u8)i, 255});
+    }
+    return clock_now() - start;
+}
+
+void gui_tlb_benchmark(void) {
+    if (!framebuffer) {
+        printf("TLB 测试: 没有帧缓冲区\n");
+        return;
+    }
+
+    u32 pages = (screen_width * screen_height * 4 + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    int large = vmm_get_pte(vmm_kernel_space(), (u32)framebuffer, 0) == NULL;
+
+    vm_space_t* space = vmm_create_space();
+    if (!space) {
+        printf("TLB 测试: 内存不足\n");
+        return;
+    }
+    for (u32 i = 0; i < pages; i++) {
+        if (vmm_map_page(space, USER_BASE + i * PAGE_SIZE, (u32)framebuffer + i * PAGE_SIZE, PTE_WRITE) < 0) {
+            printf("TLB 测试: 内存不足\n");
+            vmm_destroy_space(space);
+            return;
+        }
+    }
+
+    u32 flags = local_irq_save();
+    u64 direct_ns = clear_screen_ns(framebuffer);
+    vm_space_t* old = vmm_current_space();
+    vmm_switch(space);
+    u64 small_ns = clear_screen_ns((u32*)USER_BASE);
+    vmm_switch(old);
+    local_irq_restore(flags);
+
+    // 映射的是帧缓冲区本身，不能让 vmm_destroy_space 释放这些物理页
+    for (u32 i = 0; i < pages; i++) {
+        vmm_unmap_page(space, USER_BASE + i * PAGE_SIZE);
+    }
+    vmm_destroy_space(space);
+
+    printf("全屏清除 x%d: 直接映射 (%s, %u 个 TLB 项) %u us, 4KB 页 (%u 个 TLB 项) %u us\n",
+           TLB_BENCH_ROUNDS, large ? "4MB 大页" : "4KB 页", large ? 1 : pages,
+           (u32)div_u64_rem(direct_ns, NSEC_PER_USEC, NULL), pages,
+           (u32)div_u64_rem(small_ns, NSEC_PER_USEC, NULL));
+}
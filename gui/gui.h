@@ -111,6 +111,7 @@ typedef struct window {
     void (*on_paint)(struct window* win);
     void (*on_event)(struct window* win, event_t* event);
     void* user_data;
+    u32 mem_tag;          // 窗口及其控件的内存计入的分配标签
     struct window* parent;
     struct window* next;
     struct window* children;
@@ -158,7 +159,7 @@ int gui_init(void);
 void gui_shutdown(void);
 void gui_update(void);
 
-// 窗口管理
+// 窗口管理 (window_create 供应用调用，窗口和控件的内存计入 KMEM_APPS)
 window_t* window_create(const char* title, int x, int y, int width, int height, u32 style);
 void window_destroy(window_t* win);
 void window_show(window_t* win);
@@ -191,6 +192,7 @@ void gui_draw_image(int x, int y, int width, int height, const u8* data);
 // 事件处理
 int gui_poll_event(event_t* event);
 void gui_push_event(event_t* event);
+void gui_wait_event(event_t* event);
 void gui_set_event_handler(void (*handler)(event_t* event));
 
 // 桌面管理
@@ -210,4 +212,7 @@ int gui_get_key_state(int key);
 int gui_load_icon(const char* path, u8** out_data, int* out_width, int* out_height);
 void gui_free_icon(u8* data);
 
+// TLB 性能测试 (4MB 大页与 4KB 页的全屏清除耗时)
+void gui_tlb_benchmark(void);
+
 #endif // GUI_H
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "apic.h"
+#include "vmm.h"
+#include "io.h"
+#include <stdio.h>
+
+// 本地 APIC 驱动
+
+static volatile u32* lapic = NULL;
+
+u32 lapic_read(u32 reg) {
+    return lapic[reg / 4];
+}
+
+void lapic_write(u32 reg, u32 value) {
+    lapic[reg / 4] = value;
+    (void)lapic[LAPIC_ID / 4]; // 读回以确保写入完成
+}
+
+int lapic_available(void) {
+    return lapic != NULL;
+}
+
+u32 lapic_id(void) {
+    if (!lapic) {
+        return 0;
+    }
+    return lapic[LAPIC_ID / 4] >> 24;
+}
+
+void lapic_eoi(void) {
+    if (lapic) {
+        lapic[LAPIC_EOI / 4] = 0;
+    }
+}
+
+void lapic_wait_icr(void) {
+    while (lapic_read(LAPIC_ICR_LOW) & ICR_DELIVERY_PENDING) {
+        __asm__ __volatile__ ("pause");
+    }
+}
+
+void lapic_send_ipi(u32 apic_id, u32 vector) {
+    if (!lapic) {
+        return;
+    }
+    lapic_wait_icr();
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, vector);
+}
+
+// 启用本 CPU 的 APIC: 设置伪中断向量并打开软件使能位
+void lapic_init_ap(void) {
+    if (!lapic) {
+        return;
+    }
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_LVT_ERROR, 0x10000);  // 屏蔽
+    lapic_write(LAPIC_SVR, 0x100 | LAPIC_SPURIOUS_VECTOR);
+    lapic_eoi();
+}
+
+int lapic_init(void) {
+    u32 eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & (1 << 9))) {
+        return -1; // 不支持 APIC
+    }
+
+    // 读取 IA32_APIC_BASE MSR 并映射寄存器页
+    u64 msr = rdmsr(MSR_APIC_BASE);
+    u32 base = (u32)msr & 0xFFFFF000;
+    if (!base) {
+        base = LAPIC_BASE_DEFAULT;
+    }
+    if (!(msr & APIC_BASE_ENABLE)) {
+        wrmsr(MSR_APIC_BASE, msr | APIC_BASE_ENABLE); // 全局使能
+    }
+    lapic = vmm_map_mmio(base, PAGE_SIZE);
+    if (!lapic) {
+        return -1;
+    }
+
+    lapic_init_ap();
+    printf("本地 APIC: 地址 0x%x, ID %u\n", base, lapic_id());
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include "kernel.h"
+
+// 本地 APIC 默认物理地址
+#define LAPIC_BASE_DEFAULT   0xFEE00000
+
+// IA32_APIC_BASE MSR 及其全局使能位
+#define MSR_APIC_BASE        0x1B
+#define APIC_BASE_ENABLE     0x800
+
+// 本地 APIC 寄存器偏移
+#define LAPIC_ID             0x020
+#define LAPIC_VERSION        0x030
+#define LAPIC_TPR            0x080
+#define LAPIC_EOI            0x0B0
+#define LAPIC_SVR            0x0F0
+#define LAPIC_ICR_LOW        0x300
+#define LAPIC_ICR_HIGH       0x310
+#define LAPIC_LVT_TIMER      0x320
+#define LAPIC_LVT_LINT0      0x350
+#define LAPIC_LVT_LINT1      0x360
+#define LAPIC_LVT_ERROR      0x370
+#define LAPIC_TIMER_INIT     0x380
+#define LAPIC_TIMER_CURRENT  0x390
+#define LAPIC_TIMER_DIV      0x3E0
+
+// ICR 字段
+#define ICR_INIT             0x00000500
+#define ICR_STARTUP          0x00000600
+#define ICR_LEVEL_ASSERT     0x00004000
+#define ICR_LEVEL_TRIGGER    0x00008000
+#define ICR_DELIVERY_PENDING 0x00001000
+#define ICR_ALL_EXCLUDING_SELF 0x000C0000
+
+// 伪中断向量
+#define LAPIC_SPURIOUS_VECTOR 0xFF
+
+// 本地 APIC
+int lapic_init(void);
+void lapic_init_ap(void);
+int lapic_available(void);
+u32 lapic_read(u32 reg);
+void lapic_write(u32 reg, u32 value);
+u32 lapic_id(void);
+void lapic_eoi(void);
+void lapic_send_ipi(u32 apic_id, u32 vector);
+void lapic_wait_icr(void);
+
+#endif // APIC_H
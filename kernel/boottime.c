@@ -0,0 +1,73 @@
+#include "boottime.h"
+#include "clock.h"
+#include "serial.h"
+#include <stdio.h>
+
+typedef struct {
+    const char* name;
+    u64 start_ns;
+    u64 end_ns;
+} boot_phase_t;
+
+static boot_phase_t phases[BOOTTIME_MAX_PHASES];
+static volatile u32 nr_phases = 0;
+static volatile u32 nr_dropped = 0;
+static u64 last_mark_ns = 0;
+
+void boottime_record(const char* name, u64 start_ns, u64 end_ns) {
+    u32 slot = __sync_fetch_and_add(&nr_phases, 1);
+    if (slot >= BOOTTIME_MAX_PHASES) {
+        __sync_fetch_and_sub(&nr_phases, 1);
+        __sync_fetch_and_add(&nr_dropped, 1);
+        return;
+    }
+    phases[slot].start_ns = start_ns;
+    phases[slot].end_ns = end_ns;
+    phases[slot].name = name; // 最后写名字，报告时跳过还没写完的槽位
+}
+
+void boottime_mark(const char* name) {
+    u64 now = clock_now();
+    boottime_record(name, last_mark_ns, now);
+    last_mark_ns = now;
+}
+
+// 纳秒转为 "毫秒.微秒"
+static void format_ms(char* buf, u32 size, u64 ns) {
+    u32 us = (u32)div_u64_rem(ns, NSEC_PER_USEC, NULL);
+    snprintf(buf, size, "%u.%03u", us / 1000, us % 1000);
+}
+
+void boottime_report(void) {
+    char line[96];
+    char start[16];
+    char end[16];
+    char len[16];
+    u32 count = nr_phases;
+
+    serial_puts("boot: 阶段                开始ms     结束ms     耗时ms\n");
+    for (u32 i = 0; i < count; i++) {
+        boot_phase_t* phase = &phases[i];
+        if (!phase->name) {
+            continue;
+        }
+        format_ms(start, sizeof(start), phase->start_ns);
+        format_ms(end, sizeof(end), phase->end_ns);
+        format_ms(len, sizeof(len), phase->end_ns - phase->start_ns);
+        snprintf(line, sizeof(line), "boot: %-18s %10s %10s %10s\n", phase->name, start, end, len);
+        serial_puts(line);
+    }
+    if (nr_dropped) {
+        snprintf(line, sizeof(line), "boot: 丢弃 %u 个阶段\n", nr_dropped);
+        serial_puts(line);
+    }
+}
+
+static void boottime_command(char key) {
+    (void)key;
+    boottime_report();
+}
+
+void boottime_debug_init(void) {
+    serial_register_command('b', boottime_command);
+}
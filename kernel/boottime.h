@@ -0,0 +1,23 @@
+#ifndef BOOTTIME_H
+#define BOOTTIME_H
+
+#include "kernel.h"
+
+// 启动阶段时间线: 记录每个阶段的起止时刻 (clock_now)，第一帧画出后从串口输出。
+// 串口命令 b 重新输出。只用静态存储，时钟校准之后即可调用。
+
+#define BOOTTIME_MAX_PHASES 32
+
+// 一个阶段结束: 从上一个 boottime_mark 到现在 (只在引导 CPU 上顺序调用)
+void boottime_mark(const char* name);
+
+// 记录起止时刻已知的阶段 (可以并发调用，不影响 boottime_mark 的起点)
+void boottime_record(const char* name, u64 start_ns, u64 end_ns);
+
+// 输出时间线到串口
+void boottime_report(void);
+
+// 注册串口命令 b
+void boottime_debug_init(void);
+
+#endif // BOOTTIME_H
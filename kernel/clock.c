@@ -0,0 +1,115 @@
+#include "clock.h"
+#include "timer.h"
+#include "io.h"
+#include "spinlock.h"
+#include <stdio.h>
+
+// TSC 时钟源
+// ns = (tsc - tsc_base) * mult >> shift，mult/shift 在校准时一次算好，
+// 读取时只有一次 rdtsc 和两次 32x32 乘法，不加锁。
+// 没有 TSC 的 CPU 退回到节拍计数 (精度 1/HZ 秒)。
+
+#define CLOCK_CALIBRATE_MS  50
+
+static int clock_ready = 0;
+static int has_tsc = 0;
+static u64 tsc_base = 0;
+static u32 tsc_khz = 0;
+static u32 tsc_mult = 0;
+static u32 tsc_shift = 0;
+
+// (value * mult) >> shift，避免 64x32 乘法溢出
+static inline u64 mul_u64_u32_shr(u64 value, u32 mult, u32 shift) {
+    u32 lo = (u32)value;
+    u32 hi = (u32)(value >> 32);
+    u64 result = ((u64)lo * mult) >> shift;
+    if (hi) {
+        result += ((u64)hi * mult) << (32 - shift);
+    }
+    return result;
+}
+
+// 选取最大的 shift (<= 32) 使 mult 能放进 32 位，精度最高
+static void clock_compute_mult(void) {
+    for (tsc_shift = 32; tsc_shift > 0; tsc_shift--) {
+        u64 mult = div_u64_rem((u64)NSEC_PER_MSEC << tsc_shift, tsc_khz, NULL);
+        if ((mult >> 32) == 0) {
+            tsc_mult = (u32)mult;
+            return;
+        }
+    }
+}
+
+void clock_init(void) {
+    if (clock_ready) {
+        return;
+    }
+
+    u32 eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    has_tsc = (edx >> 4) & 1;
+
+    if (has_tsc) {
+        // 在 PIT 的固定间隔内计 TSC
+        u64 start = rdtsc();
+        pit_wait_us(CLOCK_CALIBRATE_MS * 1000);
+        u64 cycles = rdtsc() - start;
+        tsc_khz = (u32)div_u64_rem(cycles, CLOCK_CALIBRATE_MS, NULL);
+        if (tsc_khz == 0) {
+            has_tsc = 0;
+        } else {
+            clock_compute_mult();
+            tsc_base = start;
+        }
+    }
+    clock_ready = 1;
+
+    if (!has_tsc) {
+        printf("时钟: 无 TSC，使用节拍计数\n");
+        return;
+    }
+
+    // 不变 TSC 在变频和 C 状态下仍以恒定速率计数
+    u32 invariant = 0;
+    cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    if (eax >= 0x80000007) {
+        cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        invariant = (edx >> 8) & 1;
+    }
+    printf("时钟: TSC %u MHz%s\n", tsc_khz / 1000, invariant ? " (不变 TSC)" : "");
+}
+
+u64 clock_now(void) {
+    if (has_tsc) {
+        return mul_u64_u32_shr(rdtsc() - tsc_base, tsc_mult, tsc_shift);
+    }
+    if (!clock_ready) {
+        return 0;
+    }
+    return get_jiffies() * (NSEC_PER_SEC / HZ);
+}
+
+u32 clock_now_ms(void) {
+    return (u32)div_u64_rem(clock_now(), NSEC_PER_MSEC, NULL);
+}
+
+u64 clock_tsc_hz(void) {
+    return (u64)tsc_khz * 1000;
+}
+
+void clock_delay_ns(u64 ns) {
+    if (!clock_ready) {
+        clock_init();
+    }
+
+    if (!has_tsc) {
+        u32 us = (u32)div_u64_rem(ns, NSEC_PER_USEC, NULL);
+        pit_wait_us(us);
+        return;
+    }
+
+    u64 end = clock_now() + ns;
+    while (clock_now() < end) {
+        cpu_relax();
+    }
+}
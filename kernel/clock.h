@@ -0,0 +1,46 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "kernel.h"
+
+// 单调时钟: 以 TSC 为时基，启动时用 PIT 校准一次
+#define NSEC_PER_USEC   1000ULL
+#define NSEC_PER_MSEC   1000000ULL
+#define NSEC_PER_SEC    1000000000ULL
+
+// 时钟初始化 (只需 PIT，可在引导阶段调用)
+void clock_init(void);
+
+// 启动以来的纳秒数
+u64 clock_now(void);
+
+// 启动以来的毫秒数 (事件时间戳等只需 32 位的场合)
+u32 clock_now_ms(void);
+
+// TSC 频率 (Hz)，未校准时返回 0
+u64 clock_tsc_hz(void);
+
+// 读取时间戳计数器
+static inline u64 rdtsc(void) {
+    u32 lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((u64)hi << 32) | lo;
+}
+
+// 64 位除以 32 位 (内核不链接 libgcc，不能直接写 u64 除法)
+static inline u64 div_u64_rem(u64 dividend, u32 divisor, u32* remainder) {
+    u32 high = (u32)(dividend >> 32);
+    u32 q_high = high / divisor;
+    u32 rem = high % divisor;
+    u32 q_low;
+    __asm__ ("divl %4" : "=a"(q_low), "=d"(rem) : "a"((u32)dividend), "d"(rem), "rm"(divisor));
+    if (remainder) {
+        *remainder = rem;
+    }
+    return ((u64)q_high << 32) | q_low;
+}
+
+// 忙等待 (不依赖时钟中断)
+void clock_delay_ns(u64 ns);
+
+#endif // CLOCK_H
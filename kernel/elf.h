@@ -0,0 +1,55 @@
+#ifndef ELF_H
+#define ELF_H
+
+#include "kernel.h"
+
+// ELF32 文件格式 (只包含加载可执行文件需要的部分)
+
+#define ELF_MAGIC       0x464C457F  // "\x7FELF" (小端)
+
+// e_ident 下标与取值
+#define EI_CLASS        4
+#define EI_DATA         5
+#define ELFCLASS32      1
+#define ELFDATA2LSB     1
+
+// e_type / e_machine
+#define ET_EXEC         2
+#define EM_386          3
+
+// 程序头类型与标志
+#define PT_NULL         0
+#define PT_LOAD         1
+#define PF_X            0x1
+#define PF_W            0x2
+#define PF_R            0x4
+
+typedef struct {
+    u8  e_ident[16];
+    u16 e_type;
+    u16 e_machine;
+    u32 e_version;
+    u32 e_entry;
+    u32 e_phoff;
+    u32 e_shoff;
+    u32 e_flags;
+    u16 e_ehsize;
+    u16 e_phentsize;
+    u16 e_phnum;
+    u16 e_shentsize;
+    u16 e_shnum;
+    u16 e_shstrndx;
+} Elf32_Ehdr;
+
+typedef struct {
+    u32 p_type;
+    u32 p_offset;
+    u32 p_vaddr;
+    u32 p_paddr;
+    u32 p_filesz;
+    u32 p_memsz;
+    u32 p_flags;
+    u32 p_align;
+} Elf32_Phdr;
+
+#endif // ELF_H
@@ -0,0 +1,354 @@
+#include "exec.h"
+#include "elf.h"
+#include "sched.h"
+#include "gdt.h"
+#include "irq.h"
+#include "klog.h"
+#include "spinlock.h"
+#include "../fs/fs.h"
+#include "../fs/file.h"
+#include "../fs/dcache.h"
+#include <string.h>
+#include <stdio.h>
+
+// 已打开的可执行文件，由引用它的 VMA 计数。
+// 按文件 (挂载和 inode) 与打开时的内容版本共享: 文件被改写、截断或替换之后再 exec
+// 得到新的映像，不会混用旧映像缓存的页
+typedef struct exec_image {
+    struct exec_image* next;
+    u32 refcount;
+    struct file* file;          // 不属于任何任务，各任务的缺页都从这里读
+    u32 generation;             // 打开时 dentry 的版本
+    u32 size;                   // 文件大小
+    u32 nr_pages;
+    u32* pages;                 // 按文件页号缓存的共享只读页，0 表示尚未读入
+    spinlock_t lock;            // 保护 pages 和文件读位置
+} exec_image_t;
+
+static exec_image_t* images = NULL;
+static spinlock_t images_lock = SPINLOCK_INIT;
+
+// 在 offset 处读取 len 字节 (定位和读取必须连续执行)
+static int image_read(exec_image_t* image, u32 offset, void* buffer, u32 len) {
+    u32 flags = spin_lock_irqsave(&image->lock);
+    ssize_t n = -1;
+    if (fs_file_seek(image->file, offset, SEEK_SET) >= 0) {
+        n = fs_file_read(image->file, buffer, len);
+    }
+    spin_unlock_irqrestore(&image->lock, flags);
+    return n == (ssize_t)len ? 0 : -1;
+}
+
+static void image_free(exec_image_t* image) {
+    if (image->pages) {
+        for (u32 i = 0; i < image->nr_pages; i++) {
+            if (image->pages[i]) {
+                page_put((void*)image->pages[i]);
+            }
+        }
+        kfree(image->pages);
+    }
+    if (image->file) {
+        fs_file_close(image->file);
+    }
+    kfree(image);
+}
+
+// 打开文件建立新映像 (会调用文件系统，不能持有 images_lock)
+static exec_image_t* image_open(const char* path) {
+    dir_entry_t* stat = kmalloc(sizeof(dir_entry_t));
+    exec_image_t* image = kmalloc(sizeof(exec_image_t));
+    if (!stat || !image) {
+        kfree(stat);
+        kfree(image);
+        return NULL;
+    }
+    memset(image, 0, sizeof(exec_image_t));
+    image->lock = (spinlock_t)SPINLOCK_INIT;
+    image->refcount = 1;
+
+    // 先记下版本再取属性 (期间的改写会让下次 exec 建立新映像)；属性取自打开的 inode
+    image->file = fs_file_open(path, FS_PERM_READ);
+    if (image->file) {
+        image->generation = image->file->dentry->generation;
+    }
+    if (!image->file || fs_file_getattr(image->file, stat) < 0 ||
+        stat->type != FS_TYPE_FILE || stat->size > USER_TOP - USER_BASE) {
+        kfree(stat);
+        image_free(image);
+        return NULL;
+    }
+    image->size = (u32)stat->size;
+    kfree(stat);
+
+    image->nr_pages = (image->size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    image->pages = kmalloc((image->nr_pages ? image->nr_pages : 1) * sizeof(u32));
+    if (!image->pages) {
+        image_free(image);
+        return NULL;
+    }
+    memset(image->pages, 0, (image->nr_pages ? image->nr_pages : 1) * sizeof(u32));
+    return image;
+}
+
+static int image_same(exec_image_t* a, exec_image_t* b) {
+    return a->file->mount == b->file->mount && a->file->inode == b->file->inode &&
+           a->generation == b->generation && a->size == b->size;
+}
+
+// 取得 path 的映像并加一次引用
+// 先在锁外打开文件，再查找同一文件、同一版本的已有映像，有则共享它并丢弃新打开的
+static exec_image_t* image_get(const char* path) {
+    exec_image_t* fresh = image_open(path);
+    if (!fresh) {
+        return NULL;
+    }
+
+    u32 flags = spin_lock_irqsave(&images_lock);
+    for (exec_image_t* image = images; image; image = image->next) {
+        if (image_same(image, fresh)) {
+            image->refcount++;
+            spin_unlock_irqrestore(&images_lock, flags);
+            image_free(fresh);
+            return image;
+        }
+    }
+    fresh->next = images;
+    images = fresh;
+    spin_unlock_irqrestore(&images_lock, flags);
+    return fresh;
+}
+
+static void image_hold(exec_image_t* image) {
+    u32 flags = spin_lock_irqsave(&images_lock);
+    image->refcount++;
+    spin_unlock_irqrestore(&images_lock, flags);
+}
+
+// 最后一个引用消失时关闭文件并释放缓存的页 (已映射的页由各自的引用保留)
+static void image_put(exec_image_t* image) {
+    u32 flags = spin_lock_irqsave(&images_lock);
+    if (--image->refcount > 0) {
+        spin_unlock_irqrestore(&images_lock, flags);
+        return;
+    }
+    exec_image_t** link = &images;
+    while (*link != image) {
+        link = &(*link)->next;
+    }
+    *link = image->next;
+    spin_unlock_irqrestore(&images_lock, flags);
+    image_free(image);
+}
+
+// 取得文件第 index 页的共享副本 (加一次引用)，没有时读入并缓存
+static u32 image_shared_page(exec_image_t* image, u32 index) {
+    if (index >= image->nr_pages) {
+        return 0;
+    }
+
+    u32 flags = spin_lock_irqsave(&image->lock);
+    u32 page = image->pages[index];
+    if (page) {
+        page_get((void*)page);
+    }
+    spin_unlock_irqrestore(&image->lock, flags);
+    if (page) {
+        return page;
+    }
+
+    void* fresh = page_alloc(0);
+    if (!fresh) {
+        return 0;
+    }
+    if (image_read(image, index << PAGE_SHIFT, fresh, PAGE_SIZE) < 0) {
+        page_free(fresh, 0);
+        return 0;
+    }
+
+    // 读文件期间可能已被另一个进程读入
+    flags = spin_lock_irqsave(&image->lock);
+    page = image->pages[index];
+    if (!page) {
+        page = (u32)fresh;
+        image->pages[index] = page;     // 缓存持有 page_alloc 的那次引用
+        fresh = NULL;
+    }
+    page_get((void*)page);
+    spin_unlock_irqrestore(&image->lock, flags);
+    if (fresh) {
+        page_free(fresh, 0);
+    }
+    return page;
+}
+
+// 文件映射 VMA 的操作
+static void exec_vma_open(vma_t* vma) {
+    image_hold(vma->private_data);
+}
+
+static void exec_vma_close(vma_t* vma) {
+    image_put(vma->private_data);
+}
+
+static u32 exec_vma_fault(vma_t* vma, u32 va) {
+    exec_image_t* image = vma->private_data;
+    u32 delta = va - vma->start;
+    u32 offset = vma->offset + delta;
+    u32 bytes = vma->filesz > delta ? vma->filesz - delta : 0;
+    if (bytes > PAGE_SIZE) {
+        bytes = PAGE_SIZE;
+    }
+
+    // 只读且整页来自文件: 与其他进程共享
+    if (!(vma->flags & VM_WRITE) && bytes == PAGE_SIZE) {
+        return image_shared_page(image, offset >> PAGE_SHIFT);
+    }
+
+    // 可写页、段尾和 .bss: 私有页，文件之外的部分补零
+    u8* page = page_alloc(0);
+    if (!page) {
+        return 0;
+    }
+    if (bytes && image_read(image, offset, page, bytes) < 0) {
+        page_free(page, 0);
+        return 0;
+    }
+    memset(page + bytes, 0, PAGE_SIZE - bytes);
+    return (u32)page;
+}
+
+static const vm_ops_t exec_vm_ops = {
+    .open = exec_vma_open,
+    .close = exec_vma_close,
+    .fault = exec_vma_fault,
+};
+
+static int elf_check_header(const Elf32_Ehdr* ehdr) {
+    return *(const u32*)ehdr->e_ident == ELF_MAGIC &&
+           ehdr->e_ident[EI_CLASS] == ELFCLASS32 &&
+           ehdr->e_ident[EI_DATA] == ELFDATA2LSB &&
+           ehdr->e_type == ET_EXEC &&
+           ehdr->e_machine == EM_386 &&
+           ehdr->e_phentsize == sizeof(Elf32_Phdr) &&
+           ehdr->e_phnum > 0 && ehdr->e_phnum <= EXEC_MAX_PHDRS;
+}
+
+// 为一个 PT_LOAD 段建立文件映射 VMA
+static int map_segment(vm_space_t* space, exec_image_t* image, const Elf32_Phdr* phdr) {
+    u32 vaddr = phdr->p_vaddr;
+    u32 limit = EXEC_STACK_TOP - EXEC_STACK_SIZE;
+    if (phdr->p_filesz > phdr->p_memsz ||
+        (phdr->p_offset & ~PAGE_MASK) != (vaddr & ~PAGE_MASK) ||
+        phdr->p_offset > image->size || phdr->p_filesz > image->size - phdr->p_offset ||
+        vaddr < USER_BASE || vaddr > limit || phdr->p_memsz > limit - vaddr) {
+        return -1;
+    }
+
+    vma_t* vma = kmalloc(sizeof(vma_t));
+    if (!vma) {
+        return -1;
+    }
+    memset(vma, 0, sizeof(vma_t));
+    u32 head = vaddr & ~PAGE_MASK;
+    vma->start = vaddr - head;
+    vma->end = (vaddr + phdr->p_memsz + PAGE_SIZE - 1) & PAGE_MASK;
+    if (phdr->p_flags & PF_R) vma->flags |= VM_READ;
+    if (phdr->p_flags & PF_W) vma->flags |= VM_WRITE;
+    if (phdr->p_flags & PF_X) vma->flags |= VM_EXEC;
+    vma->ops = &exec_vm_ops;
+    vma->private_data = image;
+    vma->offset = phdr->p_offset - head;
+    vma->filesz = phdr->p_filesz + head;
+
+    if (vma_insert(space, vma) < 0) {
+        kfree(vma);
+        return -1;
+    }
+    image_hold(image);
+    return 0;
+}
+
+static int map_stack(vm_space_t* space) {
+    vma_t* vma = kmalloc(sizeof(vma_t));
+    if (!vma) {
+        return -1;
+    }
+    memset(vma, 0, sizeof(vma_t));
+    vma->start = EXEC_STACK_TOP - EXEC_STACK_SIZE;
+    vma->end = EXEC_STACK_TOP;
+    vma->flags = VM_READ | VM_WRITE | VM_ANON;
+    if (vma_insert(space, vma) < 0) {
+        kfree(vma);
+        return -1;
+    }
+    return 0;
+}
+
+int exec_load(const char* path) {
+    task_t* task = current_task();
+    if (!task->stack) {
+        return -1; // 引导任务没有用户现场
+    }
+
+    exec_image_t* image = image_get(path);
+    if (!image) {
+        klog(KLOG_KERNEL, KLOG_WARN, "exec: 无法打开 %s\n", path);
+        return -1;
+    }
+
+    Elf32_Ehdr ehdr;
+    Elf32_Phdr phdrs[EXEC_MAX_PHDRS];
+    if (image_read(image, 0, &ehdr, sizeof(ehdr)) < 0 || !elf_check_header(&ehdr) ||
+        ehdr.e_phoff > image->size ||
+        image_read(image, ehdr.e_phoff, phdrs, ehdr.e_phnum * sizeof(Elf32_Phdr)) < 0) {
+        klog(KLOG_KERNEL, KLOG_WARN, "exec: %s 不是有效的 ELF32 可执行文件\n", path);
+        image_put(image);
+        return -1;
+    }
+
+    vm_space_t* space = vmm_create_space();
+    if (!space) {
+        image_put(image);
+        return -1;
+    }
+    for (u32 i = 0; i < ehdr.e_phnum; i++) {
+        if (phdrs[i].p_type != PT_LOAD || phdrs[i].p_memsz == 0) {
+            continue;
+        }
+        if (map_segment(space, image, &phdrs[i]) < 0) {
+            klog(KLOG_KERNEL, KLOG_WARN, "exec: %s 的第 %u 个段无法映射\n", path, i);
+            vmm_destroy_space(space);
+            image_put(image);
+            return -1;
+        }
+    }
+    if (map_stack(space) < 0) {
+        vmm_destroy_space(space);
+        image_put(image);
+        return -1;
+    }
+
+    // 换上新地址空间，旧的 (如果是自己的) 随即释放
+    vm_space_t* old = task->space;
+    task->space = space;
+    vmm_switch(space);
+    vmm_destroy_space(old);
+    image_put(image); // 之后由 VMA 持有
+
+    // 系统调用返回时直接进入新程序
+    irq_frame_t* frame = task_user_frame(task);
+    memset(frame, 0, sizeof(irq_frame_t));
+    frame->eip = ehdr.e_entry;
+    frame->cs = USER_CS;
+    frame->eflags = 0x202;
+    frame->useresp = EXEC_STACK_TOP;
+    frame->ss = USER_DS;
+
+    const char* name = strrchr(path, '/');
+    strncpy(task->name, name ? name + 1 : path, sizeof(task->name) - 1);
+    task->name[sizeof(task->name) - 1] = '\0';
+
+    klog(KLOG_KERNEL, KLOG_DEBUG, "exec: %s 入口 0x%x\n", path, ehdr.e_entry);
+    return 0;
+}
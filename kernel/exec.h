@@ -0,0 +1,19 @@
+#ifndef EXEC_H
+#define EXEC_H
+
+#include "kernel.h"
+#include "vmm.h"
+
+// ELF 可执行文件加载
+// PT_LOAD 段只建立文件映射 VMA，页在首次访问时从文件系统读入；
+// 只读段的整页在运行同一文件的进程之间共享。
+
+#define EXEC_MAX_PHDRS      16
+#define EXEC_STACK_TOP      USER_TOP
+#define EXEC_STACK_SIZE     (1024 * 1024)   // 按需分配，只占地址空间
+
+// 用 path 指向的 ELF 文件替换当前任务的用户地址空间，并把用户现场设为程序入口
+// 失败时返回 -1，原地址空间不受影响
+int exec_load(const char* path);
+
+#endif // EXEC_H
@@ -0,0 +1,112 @@
+#include "futex.h"
+#include "wait.h"
+#include "sched.h"
+#include "vmm.h"
+#include <string.h>
+
+// 每个正在被等待的用户地址一个 futex，没有等待者时释放
+typedef struct futex {
+    struct futex* next;
+    vm_space_t* space;
+    u32 uaddr;
+    u32 refs;                   // 正在等待 (或刚被唤醒还没离开) 的任务数
+    wait_queue_t wq;
+} futex_t;
+
+typedef struct {
+    spinlock_t lock;
+    futex_t* head;
+} futex_bucket_t;
+
+static futex_bucket_t buckets[FUTEX_HASH_SIZE];
+
+static futex_bucket_t* futex_bucket(vm_space_t* space, u32 uaddr) {
+    u32 hash = (uaddr >> 2) ^ ((u32)space >> 6);
+    hash ^= hash >> 16;
+    return &buckets[hash & (FUTEX_HASH_SIZE - 1)];
+}
+
+// 调用者持有桶锁
+static futex_t* futex_find(futex_bucket_t* bucket, vm_space_t* space, u32 uaddr) {
+    for (futex_t* futex = bucket->head; futex; futex = futex->next) {
+        if (futex->space == space && futex->uaddr == uaddr) {
+            return futex;
+        }
+    }
+    return NULL;
+}
+
+int futex_wait(u32 uaddr, u32 val) {
+    vm_space_t* space = vmm_current_space();
+    futex_bucket_t* bucket = futex_bucket(space, uaddr);
+
+    // 登记之前先读一次，让可能的缺页在这里发生: 缺页失败会终止任务，
+    // 那时还不能挂着栈上的等待项和 futex 的引用
+    if (*(volatile u32*)uaddr != val) {
+        return -1;
+    }
+
+    futex_t* fresh = kmalloc(sizeof(futex_t));
+    if (!fresh) {
+        return -1;
+    }
+
+    u32 flags = spin_lock_irqsave(&bucket->lock);
+    futex_t* futex = futex_find(bucket, space, uaddr);
+    if (futex) {
+        kfree(fresh);
+    } else {
+        futex = fresh;
+        memset(futex, 0, sizeof(futex_t));
+        futex->space = space;
+        futex->uaddr = uaddr;
+        wait_queue_init(&futex->wq);
+        futex->next = bucket->head;
+        bucket->head = futex;
+    }
+    futex->refs++;
+    spin_unlock_irqrestore(&bucket->lock, flags);
+
+    // 先登记再重读用户字: 读之后的 FUTEX_WAKE 一定能看到本任务
+    // (页已在上面调入，重读不会缺页；仍然不在桶锁内访问用户内存)
+    int result = 0;
+    wait_entry_t wait;
+    wait.queued = 0;
+    prepare_to_wait(&futex->wq, &wait);
+    if (*(volatile u32*)uaddr == val) {
+        schedule();
+    } else {
+        result = -1;
+    }
+    finish_wait(&futex->wq, &wait);
+
+    flags = spin_lock_irqsave(&bucket->lock);
+    if (--futex->refs == 0) {
+        futex_t** link = &bucket->head;
+        while (*link != futex) {
+            link = &(*link)->next;
+        }
+        *link = futex->next;
+        fresh = futex;
+    } else {
+        fresh = NULL;
+    }
+    spin_unlock_irqrestore(&bucket->lock, flags);
+    kfree(fresh);
+    return result;
+}
+
+int futex_wake(u32 uaddr, int nr) {
+    vm_space_t* space = vmm_current_space();
+    futex_bucket_t* bucket = futex_bucket(space, uaddr);
+    if (nr <= 0) {
+        return 0;
+    }
+
+    // 在桶锁内唤醒，futex 不会被释放
+    u32 flags = spin_lock_irqsave(&bucket->lock);
+    futex_t* futex = futex_find(bucket, space, uaddr);
+    int woken = futex ? wake_up_nr(&futex->wq, nr) : 0;
+    spin_unlock_irqrestore(&bucket->lock, flags);
+    return woken;
+}
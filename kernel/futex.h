@@ -0,0 +1,17 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "kernel.h"
+
+// futex: 用户态锁的慢路径。用户态在一个 32 位字上做原子操作，
+// 只有需要阻塞或唤醒时才进入内核。等待者按 (地址空间, 用户地址) 区分。
+#define FUTEX_WAIT      0   // *uaddr == val 时阻塞
+#define FUTEX_WAKE      1   // 唤醒最多 val 个等待者
+
+#define FUTEX_HASH_SIZE 64
+
+// 返回: WAIT 被唤醒为 0，值不相等为 -1；WAKE 返回唤醒的个数
+int futex_wait(u32 uaddr, u32 val);
+int futex_wake(u32 uaddr, int nr);
+
+#endif // FUTEX_H
@@ -0,0 +1,77 @@
+#include "gdt.h"
+#include "smp.h"
+#include <string.h>
+
+// 内核 GDT: 引导程序的 5 个平坦段之后追加每个 CPU 的 TSS
+
+typedef struct {
+    u16 limit_low;
+    u16 base_low;
+    u8 base_mid;
+    u8 access;
+    u8 granularity;
+    u8 base_high;
+} __attribute__((packed)) gdt_entry_t;
+
+static gdt_entry_t gdt[GDT_TSS_BASE + MAX_CPUS];
+static tss_t tss[MAX_CPUS];
+
+static struct {
+    u16 limit;
+    u32 base;
+} __attribute__((packed)) gdt_ptr;
+
+static void gdt_set_entry(int index, u32 base, u32 limit, u8 access, u8 granularity) {
+    gdt[index].limit_low = limit & 0xFFFF;
+    gdt[index].base_low = base & 0xFFFF;
+    gdt[index].base_mid = (base >> 16) & 0xFF;
+    gdt[index].access = access;
+    gdt[index].granularity = (granularity & 0xF0) | ((limit >> 16) & 0x0F);
+    gdt[index].base_high = base >> 24;
+}
+
+static void gdt_setup(void) {
+    gdt_set_entry(0, 0, 0, 0, 0);
+    gdt_set_entry(1, 0, 0xFFFFF, 0x9A, 0xCF);   // 内核代码段
+    gdt_set_entry(2, 0, 0xFFFFF, 0x92, 0xCF);   // 内核数据段
+    gdt_set_entry(3, 0, 0xFFFFF, 0xFA, 0xCF);   // 用户代码段
+    gdt_set_entry(4, 0, 0xFFFFF, 0xF2, 0xCF);   // 用户数据段
+    gdt_ptr.limit = sizeof(gdt) - 1;
+    gdt_ptr.base = (u32)&gdt;
+}
+
+void gdt_init_cpu(cpu_t* cpu) {
+    if (cpu->id == 0) {
+        gdt_setup();
+    }
+
+    tss_t* t = &tss[cpu->id];
+    memset(t, 0, sizeof(tss_t));
+    t->ss0 = KERNEL_DS;
+    t->iomap_base = sizeof(tss_t);  // 没有 I/O 位图
+    gdt_set_entry(GDT_TSS_BASE + cpu->id, (u32)t, sizeof(tss_t) - 1, 0x89, 0x00);
+
+    __asm__ __volatile__ (
+        "lgdt %0\n"
+        "movw %1, %%ax\n"
+        "movw %%ax, %%ds\n"
+        "movw %%ax, %%es\n"
+        "movw %%ax, %%fs\n"
+        "movw %%ax, %%gs\n"
+        "movw %%ax, %%ss\n"
+        "ljmp %2, $1f\n"
+        "1:\n"
+        "ltr %w3\n"
+        :
+        : "m"(gdt_ptr), "i"(KERNEL_DS), "i"(KERNEL_CS), "r"((GDT_TSS_BASE + cpu->id) * 8)
+        : "eax", "memory"
+    );
+}
+
+void gdt_set_kernel_stack(u32 cpu_id, u32 esp0) {
+    tss[cpu_id].esp0 = esp0;
+}
+
+u32* gdt_kernel_stack_slot(u32 cpu_id) {
+    return &tss[cpu_id].esp0;
+}
@@ -0,0 +1,37 @@
+#ifndef GDT_H
+#define GDT_H
+
+#include "kernel.h"
+
+// 段选择子 (与引导程序的 GDT 布局一致，sysenter/sysexit 依赖这个顺序)
+#define KERNEL_CS           0x08
+#define KERNEL_DS           0x10
+#define USER_CS             0x1B
+#define USER_DS             0x23
+#define GDT_TSS_BASE        5       // 每个 CPU 一个 TSS 描述符，从第 5 项开始
+
+// 任务状态段: 只用 ss0/esp0 (从用户态进入内核时的栈)
+typedef struct {
+    u32 prev;
+    u32 esp0, ss0;
+    u32 esp1, ss1;
+    u32 esp2, ss2;
+    u32 cr3, eip, eflags;
+    u32 eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    u32 es, cs, ss, ds, fs, gs;
+    u32 ldt;
+    u16 trap, iomap_base;
+} tss_t;
+
+struct cpu;
+
+// 为本 CPU 加载内核 GDT 和 TSS
+void gdt_init_cpu(struct cpu* cpu);
+
+// 设置本 CPU 从用户态进入内核时使用的栈顶
+void gdt_set_kernel_stack(u32 cpu_id, u32 esp0);
+
+// esp0 字段地址 (sysenter 入口从这里取栈)
+u32* gdt_kernel_stack_slot(u32 cpu_id);
+
+#endif // GDT_H
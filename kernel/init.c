@@ -0,0 +1,215 @@
+#include "init.h"
+#include "sched.h"
+#include "smp.h"
+#include "clock.h"
+#include "wait.h"
+#include "spinlock.h"
+#include "boottime.h"
+#include <string.h>
+#include <stdio.h>
+
+// 依赖图并行初始化
+// 调用者和最多 cpu_count - 1 个辅助任务组成工作池，每个工作者反复取出
+// 依赖都已完成的节点执行。节点结束后唤醒等待者: 既包括空闲的工作者，
+// 也包括用 init_wait 等待就绪信号的任务。同一时刻只能运行一张图。
+
+static init_node_t* graph = NULL;
+static int graph_size = 0;
+static int nr_unfinished = 0;               // 受 graph_lock 保护
+static spinlock_t graph_lock = SPINLOCK_INIT;
+static wait_queue_t graph_wq = WAIT_QUEUE_INIT;
+
+static int find_node(init_node_t* nodes, int count, const char* name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(nodes[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int depends_on(init_node_t* node, int id) {
+    for (int d = 0; d < INIT_MAX_DEPS && node->dep_ids[d] >= 0; d++) {
+        if (node->dep_ids[d] == id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 解析依赖名并检查是否有环 (Kahn 算法能排完所有节点即无环)
+static int graph_prepare(init_node_t* nodes, int count) {
+    for (int i = 0; i < count; i++) {
+        init_node_t* node = &nodes[i];
+        node->state = INIT_PENDING;
+        node->result = 0;
+        node->nr_waiting = 0;
+        for (int d = 0; d < INIT_MAX_DEPS; d++) {
+            node->dep_ids[d] = -1;
+            if (!node->deps[d]) {
+                break;
+            }
+            int id = find_node(nodes, count, node->deps[d]);
+            if (id < 0) {
+                printf("初始化: %s 依赖的 %s 不存在\n", node->name, node->deps[d]);
+                return -1;
+            }
+            node->dep_ids[d] = id;
+            node->nr_waiting++;
+        }
+    }
+
+    // 借用 state 模拟一遍拓扑排序，结束后复原
+    int sorted = 0;
+    int progress = 1;
+    while (progress) {
+        progress = 0;
+        for (int i = 0; i < count; i++) {
+            if (nodes[i].state != INIT_PENDING || nodes[i].nr_waiting > 0) {
+                continue;
+            }
+            nodes[i].state = INIT_DONE;
+            sorted++;
+            progress = 1;
+            for (int j = 0; j < count; j++) {
+                if (depends_on(&nodes[j], i)) {
+                    nodes[j].nr_waiting--;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        init_node_t* node = &nodes[i];
+        if (sorted < count && node->state == INIT_PENDING) {
+            printf("初始化: %s 处于依赖环中\n", node->name);
+        }
+        node->state = INIT_PENDING;
+        node->nr_waiting = 0;
+        for (int d = 0; d < INIT_MAX_DEPS && node->dep_ids[d] >= 0; d++) {
+            node->nr_waiting++;
+        }
+    }
+    return sorted == count ? 0 : -1;
+}
+
+// 取出一个依赖都已完成的节点 (调用者持有 graph_lock)
+static init_node_t* take_ready(void) {
+    for (int i = 0; i < graph_size; i++) {
+        init_node_t* node = &graph[i];
+        if (node->state == INIT_PENDING && node->nr_waiting == 0) {
+            node->state = INIT_RUNNING;
+            return node;
+        }
+    }
+    return NULL;
+}
+
+// 节点结束 (调用者持有 graph_lock): 依赖它的节点少等一个，失败则连带跳过
+static void node_finish(init_node_t* node, int state) {
+    int id = node - graph;
+    node->state = state;
+    nr_unfinished--;
+    for (int i = 0; i < graph_size; i++) {
+        init_node_t* other = &graph[i];
+        if (other->state != INIT_PENDING || !depends_on(other, id)) {
+            continue;
+        }
+        if (state == INIT_FAILED) {
+            printf("初始化: %s 失败，跳过 %s\n", node->name, other->name);
+            node_finish(other, INIT_FAILED);
+        } else {
+            other->nr_waiting--;
+        }
+    }
+}
+
+// 等待下一个可执行的节点，整张图结束时返回 NULL
+static init_node_t* next_ready(void) {
+    init_node_t* node;
+    wait_entry_t wait;
+    wait.queued = 0;
+    for (;;) {
+        prepare_to_wait(&graph_wq, &wait);
+        u32 flags = spin_lock_irqsave(&graph_lock);
+        node = take_ready();
+        int finished = nr_unfinished == 0;
+        spin_unlock_irqrestore(&graph_lock, flags);
+        if (node || finished) {
+            break;
+        }
+        schedule();
+    }
+    finish_wait(&graph_wq, &wait);
+    return node;
+}
+
+static void init_worker(void) {
+    init_node_t* node;
+    while ((node = next_ready()) != NULL) {
+        node->cpu = this_cpu()->id;
+        node->start_ns = clock_now();
+        node->result = node->func();
+        node->end_ns = clock_now();
+        boottime_record(node->name, node->start_ns, node->end_ns);
+
+        u32 flags = spin_lock_irqsave(&graph_lock);
+        node_finish(node, node->result < 0 ? INIT_FAILED : INIT_DONE);
+        spin_unlock_irqrestore(&graph_lock, flags);
+        wake_up(&graph_wq);
+    }
+}
+
+int init_run(init_node_t* nodes, int count) {
+    if (graph_prepare(nodes, count) < 0) {
+        return -1;
+    }
+
+    u32 flags = spin_lock_irqsave(&graph_lock);
+    graph = nodes;
+    graph_size = count;
+    nr_unfinished = count;
+    spin_unlock_irqrestore(&graph_lock, flags);
+
+    // 辅助任务: 每个多出来的 CPU 一个，但不超过节点数
+    int helpers = (int)cpu_count - 1;
+    if (helpers > count - 1) {
+        helpers = count - 1;
+    }
+    for (int i = 0; i < helpers; i++) {
+        if (create_process("initd", init_worker) < 0) {
+            break; // 少几个工作者只影响并行度
+        }
+    }
+
+    u64 start = clock_now();
+    init_worker();
+
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        init_node_t* node = &nodes[i];
+        if (node->state == INIT_FAILED) {
+            failed++;
+        }
+        u32 us = (u32)div_u64_rem(node->end_ns - node->start_ns, NSEC_PER_USEC, NULL);
+        printf("初始化: %-8s %s cpu%u %u.%03ums\n", node->name,
+               node->state == INIT_DONE ? "完成" : "失败", node->cpu, us / 1000, us % 1000);
+    }
+    u32 total = (u32)div_u64_rem(clock_now() - start, NSEC_PER_USEC, NULL);
+    printf("初始化: %d 个子系统, %d 个工作者, 耗时 %u.%03ums\n",
+           count, helpers + 1, total / 1000, total % 1000);
+    return failed;
+}
+
+int init_wait(const char* name) {
+    u32 flags = spin_lock_irqsave(&graph_lock);
+    int id = graph ? find_node(graph, graph_size, name) : -1;
+    spin_unlock_irqrestore(&graph_lock, flags);
+    if (id < 0) {
+        return -1;
+    }
+
+    init_node_t* node = &graph[id];
+    wait_event(&graph_wq, node->state >= INIT_DONE);
+    return node->state;
+}
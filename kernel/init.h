@@ -0,0 +1,44 @@
+#ifndef INIT_H
+#define INIT_H
+
+#include "kernel.h"
+
+// 依赖图并行初始化
+// 每个子系统声明自己依赖的子系统，init_run 按拓扑顺序执行，
+// 互不依赖的子系统由多个初始化任务在空闲的 CPU 上同时运行。
+// 子系统完成后即发出就绪信号，其他代码可以用 init_wait 等待。
+
+#define INIT_MAX_DEPS   4
+
+// 节点状态
+#define INIT_PENDING    0
+#define INIT_RUNNING    1
+#define INIT_DONE       2
+#define INIT_FAILED     3       // 初始化函数返回负数，或依赖失败而跳过
+
+typedef struct init_node {
+    const char* name;
+    int (*func)(void);                  // 返回负数表示失败
+    const char* deps[INIT_MAX_DEPS];    // 依赖的节点名，NULL 结束
+
+    // 以下由 init_run 维护
+    int dep_ids[INIT_MAX_DEPS];         // 依赖的节点下标，-1 结束
+    volatile int state;
+    int result;
+    u32 nr_waiting;                     // 尚未完成的依赖数
+    u64 start_ns;
+    u64 end_ns;
+    u32 cpu;                            // 在哪个 CPU 上运行
+} init_node_t;
+
+// 没有依赖时写 INIT_NODE("fs", fs_init, NULL)
+#define INIT_NODE(n, f, ...)    { .name = (n), .func = (f), .deps = { __VA_ARGS__ } }
+
+// 执行整张图 (须在调度器和时钟就绪、中断打开后调用)，全部结束后返回。
+// 依赖不存在或有环时不执行任何节点并返回 -1；否则返回失败的节点数
+int init_run(init_node_t* nodes, int count);
+
+// 阻塞直到名为 name 的节点结束，返回它的状态 (INIT_DONE / INIT_FAILED)，没有该节点返回 -1
+int init_wait(const char* name);
+
+#endif // INIT_H
@@ -0,0 +1,304 @@
+#include "input.h"
+#include "irq.h"
+#include "io.h"
+#include "../gui/gui.h"
+#include <string.h>
+#include <stdio.h>
+
+// PS/2 控制器端口
+#define PS2_DATA            0x60
+#define PS2_STATUS          0x64
+#define PS2_CMD             0x64
+
+#define PS2_STATUS_OUTPUT   0x01    // 输出缓冲区有数据
+#define PS2_STATUS_INPUT    0x02    // 输入缓冲区满，暂不能写
+#define PS2_STATUS_AUX      0x20    // 数据来自鼠标
+
+#define PS2_CMD_READ_CONFIG   0x20
+#define PS2_CMD_WRITE_CONFIG  0x60
+#define PS2_CMD_ENABLE_AUX    0xA8
+#define PS2_CMD_WRITE_AUX     0xD4
+
+#define PS2_CONFIG_AUX_IRQ    0x02
+#define PS2_CONFIG_AUX_CLOCK  0x20  // 置位表示关闭鼠标时钟
+
+#define MOUSE_SET_DEFAULTS    0xF6
+#define MOUSE_ENABLE_REPORT   0xF4
+
+// 扫描码 (第 1 套)
+#define SC_EXTENDED         0xE0
+#define SC_RELEASE          0x80
+#define SC_LSHIFT           0x2A
+#define SC_RSHIFT           0x36
+#define SC_CTRL             0x1D
+#define SC_ALT              0x38
+
+// 中断与 tasklet 之间的环形缓冲 (单生产者单消费者，不需要锁)
+#define INPUT_RING_SIZE     256
+
+typedef struct {
+    volatile u32 head;
+    volatile u32 tail;
+    u8 data[INPUT_RING_SIZE];
+} input_ring_t;
+
+static input_ring_t kbd_ring;
+static input_ring_t mouse_ring;
+static tasklet_t kbd_tasklet;
+static tasklet_t mouse_tasklet;
+
+// 键盘状态 (只在 tasklet 中访问)
+static u32 kbd_modifiers = 0;
+static int kbd_extended = 0;
+
+// 鼠标状态 (只在 tasklet 中访问)
+static u8 mouse_packet[3];
+static int mouse_index = 0;
+static int mouse_x = 0;
+static int mouse_y = 0;
+static int mouse_buttons = 0;
+
+// 美式键盘布局
+static const char keymap[0x3A] = {
+    0, 27, '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b',
+    '\t', 'q', 'w', 'e', 'r', 't', 'y', 'u', 'i', 'o', 'p', '[', ']', '\n',
+    0, 'a', 's', 'd', 'f', 'g', 'h', 'j', 'k', 'l', ';', '\'', '`',
+    0, '\\', 'z', 'x', 'c', 'v', 'b', 'n', 'm', ',', '.', '/', 0,
+    '*', 0, ' ',
+};
+
+static const char keymap_shift[0x3A] = {
+    0, 27, '!', '@', '#', '$', '%', '^', '&', '*', '(', ')', '_', '+', '\b',
+    '\t', 'Q', 'W', 'E', 'R', 'T', 'Y', 'U', 'I', 'O', 'P', '{', '}', '\n',
+    0, 'A', 'S', 'D', 'F', 'G', 'H', 'J', 'K', 'L', ':', '"', '~',
+    0, '|', 'Z', 'X', 'C', 'V', 'B', 'N', 'M', '<', '>', '?', 0,
+    '*', 0, ' ',
+};
+
+static void ring_put(input_ring_t* ring, u8 value) {
+    if (ring->tail - ring->head >= INPUT_RING_SIZE) {
+        return; // 消费者跟不上，丢弃
+    }
+    ring->data[ring->tail % INPUT_RING_SIZE] = value;
+    __sync_synchronize();
+    ring->tail++;
+}
+
+static int ring_get(input_ring_t* ring, u8* value) {
+    if (ring->head == ring->tail) {
+        return 0;
+    }
+    *value = ring->data[ring->head % INPUT_RING_SIZE];
+    __sync_synchronize();
+    ring->head++;
+    return 1;
+}
+
+// 控制器读写 (只在初始化时使用，带超时)
+static int ps2_wait_write(void) {
+    for (int i = 0; i < 100000; i++) {
+        if (!(inb(PS2_STATUS) & PS2_STATUS_INPUT)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int ps2_wait_read(void) {
+    for (int i = 0; i < 100000; i++) {
+        if (inb(PS2_STATUS) & PS2_STATUS_OUTPUT) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void ps2_command(u8 cmd) {
+    ps2_wait_write();
+    outb(PS2_CMD, cmd);
+}
+
+static void ps2_write(u8 value) {
+    ps2_wait_write();
+    outb(PS2_DATA, value);
+}
+
+static int ps2_read(void) {
+    if (ps2_wait_read() < 0) {
+        return -1;
+    }
+    return inb(PS2_DATA);
+}
+
+static int mouse_command(u8 cmd) {
+    ps2_command(PS2_CMD_WRITE_AUX);
+    ps2_write(cmd);
+    return ps2_read(); // 0xFA 表示确认
+}
+
+// 中断处理: 读空控制器的输出缓冲区，按来源分发
+static void ps2_drain(void) {
+    u8 status;
+    while ((status = inb(PS2_STATUS)) & PS2_STATUS_OUTPUT) {
+        u8 value = inb(PS2_DATA);
+        if (status & PS2_STATUS_AUX) {
+            ring_put(&mouse_ring, value);
+            tasklet_schedule(&mouse_tasklet);
+        } else {
+            ring_put(&kbd_ring, value);
+            tasklet_schedule(&kbd_tasklet);
+        }
+    }
+}
+
+static void kbd_interrupt(irq_frame_t* frame) {
+    (void)frame;
+    ps2_drain();
+}
+
+static void mouse_interrupt(irq_frame_t* frame) {
+    (void)frame;
+    ps2_drain();
+}
+
+// 键盘下半部: 扫描码 -> 按键事件
+static void kbd_process(void* data) {
+    u8 sc;
+    (void)data;
+    while (ring_get(&kbd_ring, &sc)) {
+        if (sc == SC_EXTENDED) {
+            kbd_extended = 1;
+            continue;
+        }
+
+        int release = sc & SC_RELEASE;
+        u8 code = sc & ~SC_RELEASE;
+        int extended = kbd_extended;
+        kbd_extended = 0;
+
+        u32 mod = 0;
+        if (code == SC_LSHIFT || code == SC_RSHIFT) {
+            mod = KEY_MOD_SHIFT;
+        } else if (code == SC_CTRL) {
+            mod = KEY_MOD_CTRL;
+        } else if (code == SC_ALT) {
+            mod = KEY_MOD_ALT;
+        }
+        if (mod) {
+            if (release) {
+                kbd_modifiers &= ~mod;
+            } else {
+                kbd_modifiers |= mod;
+            }
+        }
+
+        event_t event;
+        memset(&event, 0, sizeof(event));
+        event.type = release ? EVENT_KEY_UP : EVENT_KEY_DOWN;
+        event.data.keyboard.key = code | (extended ? 0x100 : 0);
+        event.data.keyboard.modifiers = kbd_modifiers;
+        if (!extended && code < sizeof(keymap)) {
+            event.data.keyboard.character = (kbd_modifiers & KEY_MOD_SHIFT) ?
+                                            keymap_shift[code] : keymap[code];
+        }
+        gui_push_event(&event);
+    }
+}
+
+static void mouse_emit(u32 type, int button) {
+    event_t event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.data.mouse.x = mouse_x;
+    event.data.mouse.y = mouse_y;
+    event.data.mouse.button = button;
+    event.data.mouse.modifiers = kbd_modifiers;
+    gui_push_event(&event);
+}
+
+// 鼠标下半部: 3 字节数据包 -> 移动与按键事件
+static void mouse_process(void* data) {
+    static const int button_ids[3] = {
+        MOUSE_BUTTON_LEFT, MOUSE_BUTTON_RIGHT, MOUSE_BUTTON_MIDDLE
+    };
+    u8 value;
+    (void)data;
+    while (ring_get(&mouse_ring, &value)) {
+        // 第一个字节的位 3 恒为 1，用来重新同步
+        if (mouse_index == 0 && !(value & 0x08)) {
+            continue;
+        }
+        mouse_packet[mouse_index++] = value;
+        if (mouse_index < 3) {
+            continue;
+        }
+        mouse_index = 0;
+
+        u8 flags = mouse_packet[0];
+        if (flags & 0xC0) {
+            continue; // 溢出，丢弃
+        }
+        int dx = mouse_packet[1] - ((flags << 4) & 0x100);
+        int dy = mouse_packet[2] - ((flags << 3) & 0x100);
+
+        if (dx || dy) {
+            int width = gui_get_screen_width();
+            int height = gui_get_screen_height();
+            mouse_x += dx;
+            mouse_y -= dy; // PS/2 的 y 轴向上
+            mouse_x = mouse_x < 0 ? 0 : (mouse_x >= width ? width - 1 : mouse_x);
+            mouse_y = mouse_y < 0 ? 0 : (mouse_y >= height ? height - 1 : mouse_y);
+            mouse_emit(EVENT_MOUSE_MOVE, 0);
+        }
+
+        int buttons = flags & 0x07;
+        int changed = buttons ^ mouse_buttons;
+        mouse_buttons = buttons;
+        for (int i = 0; i < 3; i++) {
+            if (changed & (1 << i)) {
+                mouse_emit((buttons & (1 << i)) ? EVENT_MOUSE_DOWN : EVENT_MOUSE_UP,
+                           button_ids[i]);
+            }
+        }
+    }
+}
+
+static void mouse_init(void) {
+    ps2_command(PS2_CMD_ENABLE_AUX);
+
+    // 打开鼠标中断和时钟
+    ps2_command(PS2_CMD_READ_CONFIG);
+    int config = ps2_read();
+    if (config < 0) {
+        printf("PS/2 控制器无响应\n");
+        return;
+    }
+    config = (config | PS2_CONFIG_AUX_IRQ) & ~PS2_CONFIG_AUX_CLOCK;
+    ps2_command(PS2_CMD_WRITE_CONFIG);
+    ps2_write(config);
+
+    mouse_command(MOUSE_SET_DEFAULTS);
+    if (mouse_command(MOUSE_ENABLE_REPORT) != 0xFA) {
+        printf("未检测到 PS/2 鼠标\n");
+    }
+}
+
+void input_init(void) {
+    tasklet_init(&kbd_tasklet, kbd_process, NULL);
+    tasklet_init(&mouse_tasklet, mouse_process, NULL);
+
+    // 丢弃控制器里残留的数据
+    while (inb(PS2_STATUS) & PS2_STATUS_OUTPUT) {
+        inb(PS2_DATA);
+    }
+    mouse_init();
+
+    mouse_x = gui_get_screen_width() / 2;
+    mouse_y = gui_get_screen_height() / 2;
+
+    irq_register(IRQ_BASE + IRQ_KEYBOARD, kbd_interrupt);
+    irq_register(IRQ_BASE + IRQ_MOUSE, mouse_interrupt);
+    irq_unmask(IRQ_KEYBOARD);
+    irq_unmask(IRQ_MOUSE);
+    printf("PS/2 键盘和鼠标已启用\n");
+}
@@ -0,0 +1,10 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "kernel.h"
+
+// PS/2 键盘与鼠标
+// 中断处理程序只把扫描码放进环形缓冲，解码和生成 GUI 事件在 tasklet 中完成。
+void input_init(void);
+
+#endif // INPUT_H
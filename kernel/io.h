@@ -0,0 +1,53 @@
+#ifndef IO_H
+#define IO_H
+
+#include "kernel.h"
+
+// 端口 I/O
+static inline void outb(u16 port, u8 value) {
+    __asm__ __volatile__ ("outb %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline u8 inb(u16 port) {
+    u8 value;
+    __asm__ __volatile__ ("inb %1, %0" : "=a"(value) : "Nd"(port));
+    return value;
+}
+
+static inline void outw(u16 port, u16 value) {
+    __asm__ __volatile__ ("outw %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline u16 inw(u16 port) {
+    u16 value;
+    __asm__ __volatile__ ("inw %1, %0" : "=a"(value) : "Nd"(port));
+    return value;
+}
+
+static inline void outl(u16 port, u32 value) {
+    __asm__ __volatile__ ("outl %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline u32 inl(u16 port) {
+    u32 value;
+    __asm__ __volatile__ ("inl %1, %0" : "=a"(value) : "Nd"(port));
+    return value;
+}
+
+static inline void cpuid(u32 leaf, u32* eax, u32* ebx, u32* ecx, u32* edx) {
+    __asm__ __volatile__ ("cpuid"
+                          : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                          : "a"(leaf), "c"(0));
+}
+
+static inline u64 rdmsr(u32 msr) {
+    u32 lo, hi;
+    __asm__ __volatile__ ("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((u64)hi << 32) | lo;
+}
+
+static inline void wrmsr(u32 msr, u64 value) {
+    __asm__ __volatile__ ("wrmsr" : : "a"((u32)value), "d"((u32)(value >> 32)), "c"(msr));
+}
+
+#endif // IO_H
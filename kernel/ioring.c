@@ -0,0 +1,164 @@
+#include "ioring.h"
+#include "vmm.h"
+#include "syscall.h"
+#include "../fs/fs.h"
+#include <string.h>
+
+// 异步 I/O 环
+// 底层文件系统是同步的，请求在 SYS_IORING_ENTER 中依次执行并立即完成；
+// 收益来自批量提交: 一次进入内核处理整批请求，完成结果由用户态直接从 CQ 读取。
+// 环位于用户内存，内核只信任自己记录的地址和大小，不读取用户可改写的掩码和偏移。
+
+#define barrier() __asm__ __volatile__ ("" : : : "memory")
+
+static u32 ring_bytes(u32 entries) {
+    return sizeof(io_ring_t) + entries * sizeof(io_sqe_t) + 2 * entries * sizeof(io_cqe_t);
+}
+
+// 环仍完整映射且可写 (用户态可能已经 munmap)
+static int ring_mapped(vm_space_t* space) {
+    vma_t* vma = vma_find(space, space->ioring);
+    return vma && (vma->flags & VM_WRITE) &&
+           vma->end - space->ioring >= ring_bytes(space->ioring_entries);
+}
+
+// 已有的环被 munmap 或不再可写时允许重新建立
+u32 ioring_setup(u32 entries) {
+    vm_space_t* space = vmm_current_space();
+    if (space == vmm_kernel_space() || (space->ioring && ring_mapped(space)) ||
+        entries == 0 || entries > IORING_MAX_ENTRIES) {
+        return 0;
+    }
+
+    u32 n = 1;
+    while (n < entries) {
+        n <<= 1;
+    }
+
+    // 普通匿名映射: 首次访问时由页错误分配清零页，fork 时随地址空间写时复制
+    void* addr = sys_mmap(NULL, ring_bytes(n), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS);
+    if (addr == MAP_FAILED) {
+        return 0;
+    }
+
+    io_ring_t* ring = addr;
+    ring->sq_mask = n - 1;
+    ring->cq_mask = 2 * n - 1;
+    ring->sq_entries = n;
+    ring->cq_entries = 2 * n;
+    ring->sqes_offset = sizeof(io_ring_t);
+    ring->cqes_offset = sizeof(io_ring_t) + n * sizeof(io_sqe_t);
+
+    space->ioring = (u32)ring;
+    space->ioring_entries = n;
+    return (u32)ring;
+}
+
+void ioring_unmapped(vm_space_t* space, u32 start, u32 end) {
+    u32 ring = space->ioring;
+    if (ring && start < ring + ring_bytes(space->ioring_entries) && ring < end) {
+        space->ioring = 0;
+        space->ioring_entries = 0;
+    }
+}
+
+// fs_stat 在 dcache 锁内填写结果，先填到内核缓冲区再复制给用户 (复制时可能缺页)
+static s32 ioring_stat(const char* path, u32 addr) {
+    if (!user_write_ok(addr, sizeof(dir_entry_t))) {
+        return -1;
+    }
+    dir_entry_t* stat = kmalloc(sizeof(dir_entry_t));
+    if (!stat) {
+        return -1;
+    }
+    s32 result = fs_stat(path, stat);
+    if (result == 0) {
+        memcpy((void*)addr, stat, sizeof(dir_entry_t));
+    }
+    kfree(stat);
+    return result;
+}
+
+// 执行一个请求，返回值与对应的同步调用相同
+static s32 ioring_do(const io_sqe_t* sqe, char** kpath) {
+    switch (sqe->opcode) {
+        case IORING_OP_NOP:
+            return 0;
+
+        case IORING_OP_READ:
+        case IORING_OP_WRITE:
+            if (sqe->offset != IORING_OFF_CUR && fs_seek(sqe->fd, (off_t)sqe->offset, SEEK_SET) < 0) {
+                return -1;
+            }
+            if (sqe->opcode == IORING_OP_READ) {
+                return user_fs_read(sqe->fd, sqe->addr, sqe->len);
+            }
+            return user_fs_write(sqe->fd, sqe->addr, sqe->len);
+
+        case IORING_OP_OPEN:
+        case IORING_OP_STAT:
+            // 路径缓冲区在整批请求中复用
+            if (!*kpath && !(*kpath = kmalloc(FS_MAX_PATH_LEN))) {
+                return -1;
+            }
+            if (user_copy_string(*kpath, sqe->addr, FS_MAX_PATH_LEN) < 0) {
+                return -1;
+            }
+            if (sqe->opcode == IORING_OP_OPEN) {
+                return fs_open(*kpath, (int)sqe->len);
+            }
+            return ioring_stat(*kpath, sqe->addr2);
+
+        case IORING_OP_CLOSE:
+            return fs_close(sqe->fd);
+
+        default:
+            return -1;
+    }
+}
+
+int ioring_enter(u32 to_submit) {
+    vm_space_t* space = vmm_current_space();
+    if (!space->ioring || !ring_mapped(space)) {
+        return -1;
+    }
+
+    u32 entries = space->ioring_entries;
+    io_ring_t* ring = (io_ring_t*)space->ioring;
+    io_sqe_t* sqes = (io_sqe_t*)(space->ioring + sizeof(io_ring_t));
+    io_cqe_t* cqes = (io_cqe_t*)((u32)sqes + entries * sizeof(io_sqe_t));
+
+    char* kpath = NULL;
+    u32 head = ring->sq_head;
+    u32 tail = ring->sq_tail;
+    u32 cq_tail = ring->cq_tail;
+    barrier(); // 先读 sq_tail 再读 SQE
+
+    u32 done = 0;
+    while (done < to_submit && head != tail) {
+        // CQ 已满: 剩下的 SQE 留到用户态取走完成项之后
+        if (cq_tail - ring->cq_head >= 2 * entries) {
+            break;
+        }
+
+        // 先复制到内核栈，用户态同时改写 SQE 也不影响检查过的参数
+        io_sqe_t sqe = sqes[head & (entries - 1)];
+        head++;
+        s32 result = ioring_do(&sqe, &kpath);
+
+        io_cqe_t* cqe = &cqes[cq_tail & (2 * entries - 1)];
+        cqe->user_data = sqe.user_data;
+        cqe->result = result;
+        cqe->flags = 0;
+        cq_tail++;
+
+        // 先写完 CQE 再发布尾指针 (x86 写操作不会乱序，只需阻止编译器重排)
+        barrier();
+        ring->cq_tail = cq_tail;
+        ring->sq_head = head;
+        done++;
+    }
+
+    kfree(kpath);
+    return done;
+}
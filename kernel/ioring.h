@@ -0,0 +1,69 @@
+#ifndef IORING_H
+#define IORING_H
+
+#include "kernel.h"
+
+// 异步 I/O 环: 每个地址空间一对共享的提交队列 (SQ) 与完成队列 (CQ)。
+// 用户态填写 SQE 后推进 sq_tail，一次 SYS_IORING_ENTER 处理一批请求；
+// 结果写入 CQE 并推进 cq_tail，用户态直接读取，不需要每个请求一次系统调用。
+// 环位于用户内存中，用户态按下面的布局访问: 环头，随后是 SQE 数组和 CQE 数组。
+
+#define IORING_MAX_ENTRIES  256
+
+// 操作码
+#define IORING_OP_NOP       0
+#define IORING_OP_READ      1   // fd, addr = 缓冲区, len, offset
+#define IORING_OP_WRITE     2   // fd, addr = 缓冲区, len, offset
+#define IORING_OP_OPEN      3   // addr = 路径, len = 打开标志；结果为文件描述符
+#define IORING_OP_CLOSE     4   // fd
+#define IORING_OP_STAT      5   // addr = 路径, addr2 = dir_entry_t 缓冲区
+
+// offset 取此值时从文件当前位置读写
+#define IORING_OFF_CUR      0xFFFFFFFF
+
+// 提交队列项 (32 字节)
+typedef struct {
+    u8 opcode;
+    u8 flags;                   // 保留，须为 0
+    u16 reserved;
+    s32 fd;
+    u32 addr;
+    u32 len;
+    u32 offset;
+    u32 addr2;
+    u64 user_data;              // 原样带回 CQE
+} io_sqe_t;
+
+// 完成队列项 (16 字节)
+typedef struct {
+    u64 user_data;
+    s32 result;                 // 与对应同步调用的返回值相同，失败为 -1
+    u32 flags;
+} io_cqe_t;
+
+// 环头 (位于共享区起始处)
+typedef struct {
+    volatile u32 sq_head;       // 内核推进
+    volatile u32 sq_tail;       // 用户推进
+    volatile u32 cq_head;       // 用户推进
+    volatile u32 cq_tail;       // 内核推进
+    u32 sq_mask;
+    u32 cq_mask;
+    u32 sq_entries;
+    u32 cq_entries;             // SQ 的两倍，批量提交时不易溢出
+    u32 sqes_offset;            // SQE 数组相对环头的偏移
+    u32 cqes_offset;            // CQE 数组相对环头的偏移
+    u32 reserved[6];
+} io_ring_t;
+
+// 创建当前地址空间的环 (entries 向上取 2 的幂)，返回环头的用户地址，失败返回 0
+u32 ioring_setup(u32 entries);
+
+// 处理最多 to_submit 个 SQE (CQ 满时提前停止)，返回实际处理的个数，失败返回 -1
+int ioring_enter(u32 to_submit);
+
+// munmap 的范围 [start, end) 碰到环时撤销环的登记，之后可以重新 ioring_setup
+struct vm_space;
+void ioring_unmapped(struct vm_space* space, u32 start, u32 end);
+
+#endif // IORING_H
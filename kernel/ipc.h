@@ -0,0 +1,54 @@
+#ifndef IPC_H
+#define IPC_H
+
+#include "kernel.h"
+
+// 进程间通信通道: 一个通道有两端，每端一个消息队列 (一页大小的环)。
+// 小数据随消息复制，大块数据 (像素缓冲区、文件数据) 以整页移交: 发送方的映射被摘下，
+// 物理页直接映射进接收方，不复制内容。消息还可以携带一个通道句柄，
+// 另有不排队的通知位用于轻量唤醒。句柄属于任务，fork 时继承，退出时关闭。
+
+#define IPC_MAX_HANDLES     16      // 每个任务的句柄数
+#define IPC_INLINE_MAX      224     // 随消息复制的数据上限
+#define IPC_QUEUE_LEN       16      // 每端排队的消息数
+#define IPC_MAX_PAGES       256     // 单条消息最多移交的页数 (1MB)
+#define IPC_NO_HANDLE       (-1)
+
+// ipc_recv 标志
+#define IPC_NONBLOCK        0x1     // 没有消息时立即返回 -1
+
+// 消息 (用户态与内核共用的布局)
+typedef struct {
+    u32 len;                        // data 中的字节数
+    s32 handle;                     // 发送: 要传递的句柄 (发送方仍保留)；接收: 新句柄
+    u32 pages_addr;                 // 发送: 要移交的页 (页对齐)；接收: 映射到的地址
+    u32 pages_len;                  // 字节数 (页的整数倍)；接收方映射失败时为 0
+    u32 notify;                     // 接收: 收到的通知位 (读出后清零)
+    u8 data[IPC_INLINE_MAX];
+} ipc_msg_t;
+
+struct ipc_end;
+struct task;
+
+// 以下操作作用于当前任务的句柄表，失败返回 -1
+int ipc_create(int handles[2]);
+int ipc_close(int handle);
+
+// 队列满时阻塞，对端关闭时失败 (已摘下的页随之释放)
+int ipc_send(int handle, const ipc_msg_t* msg);
+
+// 收到消息返回 1，只收到通知返回 0；对端已关闭且队列为空时返回 -1
+// msg 必须是内核内存 (通知位在通道锁内读取，不能在锁内访问用户内存)
+int ipc_recv(int handle, ipc_msg_t* msg, u32 flags);
+
+// 置对端的通知位并唤醒对端
+int ipc_notify(int handle, u32 bits);
+
+// 任务创建与退出时的句柄表处理
+void ipc_fork_handles(struct task* parent, struct task* child);
+void ipc_release_handles(struct task* task);
+
+// 往返延迟与页移交带宽测试
+void ipc_benchmark(void);
+
+#endif // IPC_H
@@ -0,0 +1,344 @@
+#include "irq.h"
+#include "smp.h"
+#include "apic.h"
+#include "io.h"
+#include "spinlock.h"
+#include "ksyms.h"
+#include "sched.h"
+#include <stdio.h>
+
+// 中断分发
+// 256 个向量各有一个入口桩，统一进入 irq_common 构造 irq_frame_t，
+// 再由 irq_dispatch 按向量查表调用处理函数。硬件中断先应答再处理，
+// 耗时的工作交给软中断/tasklet，在中断返回前打开中断执行。
+
+// 8259 PIC 端口
+#define PIC1_CMD            0x20
+#define PIC1_DATA           0x21
+#define PIC2_CMD            0xA0
+#define PIC2_DATA           0xA1
+#define PIC_EOI             0x20
+
+// 软中断单次最多重复处理的轮数，剩余的留到下次
+#define SOFTIRQ_MAX_RESTART 10
+
+// IDT 门描述符
+typedef struct {
+    u16 offset_low;
+    u16 selector;
+    u8 zero;
+    u8 type_attr;
+    u16 offset_high;
+} __attribute__((packed)) idt_entry_t;
+
+static idt_entry_t idt[IDT_ENTRIES];
+
+static struct {
+    u16 limit;
+    u32 base;
+} __attribute__((packed)) idt_ptr;
+
+static irq_handler_t irq_handlers[IDT_ENTRIES];
+static u8 irq_user[IDT_ENTRIES];        // 用户态可触发的软件中断，不需要应答
+static softirq_handler_t softirq_handlers[NR_SOFTIRQS];
+static u16 pic_mask = 0xFFFF;
+static spinlock_t pic_lock = SPINLOCK_INIT;
+
+static const char* exception_names[EXCEPTION_COUNT] = {
+    "除零", "调试", "NMI", "断点", "溢出", "越界", "非法指令", "设备不可用",
+    "双重错误", "协处理器段越界", "无效 TSS", "段不存在", "栈段错误",
+    "一般保护错误", "页错误", "保留", "浮点错误", "对齐检查", "机器检查",
+    "SIMD 浮点错误", "虚拟化异常", "控制保护异常",
+};
+
+// 入口桩: 每个向量 16 字节，没有错误码的向量补一个 0，使现场布局一致
+extern u8 irq_stubs[];
+__asm__ (
+    ".section .text\n"
+    ".align 16\n"
+    ".global irq_stubs\n"
+    "irq_stubs:\n"
+    ".set vec, 0\n"
+    ".rept 256\n"
+    ".align 16\n"
+    ".if !((vec == 8) || (vec >= 10 && vec <= 14) || (vec == 17) || (vec == 21))\n"
+    "    pushl $0\n"
+    ".endif\n"
+    "    pushl $vec\n"
+    "    jmp irq_common\n"
+    ".set vec, vec + 1\n"
+    ".endr\n"
+    "irq_common:\n"
+    "    pushal\n"
+    "    cld\n"
+    "    pushl %esp\n"
+    "    call irq_dispatch\n"
+    "    addl $4, %esp\n"
+    ".global irq_return\n"
+    "irq_return:\n"
+    "    popal\n"
+    "    addl $8, %esp\n"
+    "    iret\n"
+);
+
+static void idt_set_gate(int vector, u32 offset, u8 type_attr) {
+    idt[vector].offset_low = offset & 0xFFFF;
+    idt[vector].selector = 0x08;      // 内核代码段
+    idt[vector].zero = 0;
+    idt[vector].type_attr = type_attr;
+    idt[vector].offset_high = offset >> 16;
+}
+
+void idt_load(void) {
+    __asm__ __volatile__ ("lidt %0" : : "m"(idt_ptr));
+}
+
+// 重映射 8259 PIC 到 0x20-0x2F，避免与 CPU 异常冲突，然后屏蔽所有 IRQ
+static void pic_init(void) {
+    outb(PIC1_CMD, 0x11);   // ICW1: 级联，需要 ICW4
+    outb(PIC2_CMD, 0x11);
+    outb(PIC1_DATA, IRQ_BASE);      // ICW2: 主片向量基址
+    outb(PIC2_DATA, IRQ_BASE + 8);  // ICW2: 从片向量基址
+    outb(PIC1_DATA, 0x04);  // ICW3: 从片接在 IRQ2
+    outb(PIC2_DATA, 0x02);
+    outb(PIC1_DATA, 0x01);  // ICW4: 8086 模式
+    outb(PIC2_DATA, 0x01);
+    outb(PIC1_DATA, 0xFF);
+    outb(PIC2_DATA, 0xFF);
+}
+
+static void pic_write_mask(void) {
+    outb(PIC1_DATA, pic_mask & 0xFF);
+    outb(PIC2_DATA, pic_mask >> 8);
+}
+
+void irq_unmask(int line) {
+    if (line < 0 || line >= IRQ_COUNT) {
+        return;
+    }
+    u32 flags = spin_lock_irqsave(&pic_lock);
+    pic_mask &= ~(1 << line);
+    if (line >= 8) {
+        pic_mask &= ~(1 << IRQ_CASCADE);
+    }
+    pic_write_mask();
+    spin_unlock_irqrestore(&pic_lock, flags);
+}
+
+void irq_mask(int line) {
+    if (line < 0 || line >= IRQ_COUNT) {
+        return;
+    }
+    u32 flags = spin_lock_irqsave(&pic_lock);
+    pic_mask |= 1 << line;
+    pic_write_mask();
+    spin_unlock_irqrestore(&pic_lock, flags);
+}
+
+int irq_register(int vector, irq_handler_t handler) {
+    if (vector < 0 || vector >= IDT_ENTRIES) {
+        return -1;
+    }
+    if (irq_handlers[vector] && irq_handlers[vector] != handler) {
+        printf("中断向量 %d 已被占用\n", vector);
+        return -1;
+    }
+    irq_handlers[vector] = handler;
+    return 0;
+}
+
+void irq_unregister(int vector) {
+    if (vector >= 0 && vector < IDT_ENTRIES) {
+        irq_handlers[vector] = NULL;
+    }
+}
+
+int irq_register_user(int vector, irq_handler_t handler) {
+    if (vector < EXCEPTION_COUNT || irq_register(vector, handler) < 0) {
+        return -1;
+    }
+    irq_user[vector] = 1;
+    idt_set_gate(vector, (u32)irq_stubs + vector * 16, 0xEF); // 存在，DPL=3，32 位陷阱门
+    return 0;
+}
+
+// 应答硬件中断。伪中断不需要应答
+static void irq_ack(u32 vector) {
+    if (vector == LAPIC_SPURIOUS_VECTOR) {
+        return;
+    }
+    if (vector < IRQ_BASE + IRQ_COUNT) {
+        if (vector >= IRQ_BASE + 8) {
+            outb(PIC2_CMD, PIC_EOI);
+        }
+        outb(PIC1_CMD, PIC_EOI);
+        return;
+    }
+    lapic_eoi();
+}
+
+// 未处理的异常: 发生在用户态时终止当前任务，发生在内核中只能停机
+static void exception_fatal(irq_frame_t* frame) {
+    const char* name = exception_names[frame->vector];
+    u32 offset = 0;
+    const char* sym = ksym_lookup(frame->eip, &offset);
+    printf("CPU %u 异常 %u (%s): EIP 0x%x (%s+0x%x), 错误码 0x%x\n", this_cpu()->id,
+           frame->vector, name ? name : "保留", frame->eip, sym ? sym : "?", offset,
+           frame->error_code);
+    if (frame->cs & 3) {
+        printf("终止任务 %u\n", current_task()->pid);
+        local_irq_restore(frame->eflags);
+        task_exit(-1);
+    }
+    for (;;) {
+        __asm__ __volatile__ ("cli; hlt");
+    }
+}
+
+void irq_dispatch(irq_frame_t* frame) {
+    u32 vector = frame->vector;
+    irq_handler_t handler = irq_handlers[vector];
+
+    if (vector < EXCEPTION_COUNT || irq_user[vector]) {
+        // 异常和系统调用在当前任务的上下文中处理，可以睡眠，不计入中断嵌套
+        if (handler) {
+            handler(frame);
+        } else {
+            exception_fatal(frame);
+        }
+    } else {
+        cpu_t* cpu = this_cpu();
+        cpu->irq_depth++;
+        irq_ack(vector);
+        if (handler) {
+            handler(frame);
+        }
+        cpu->irq_depth--;
+    }
+    irq_exit();
+}
+
+// 最外层返回前: 执行推迟的工作，然后按需重新调度
+// 打断了软中断处理的中断不调度: 被切走的任务会把 in_softirq 留在这个 CPU 上，
+// 期间这里的软中断都无法执行。need_resched 留给外层 softirq_run 结束后的检查
+void irq_exit(void) {
+    cpu_t* cpu = this_cpu();
+    if (cpu->irq_depth > 0 || cpu->in_softirq) {
+        return;
+    }
+    softirq_run();
+    if (cpu->need_resched) {
+        cpu->need_resched = 0;
+        preempt_schedule();
+    }
+}
+
+int in_interrupt(void) {
+    cpu_t* cpu = this_cpu();
+    return cpu->irq_depth > 0 || cpu->in_softirq;
+}
+
+// 软中断
+void softirq_register(int nr, softirq_handler_t handler) {
+    if (nr >= 0 && nr < NR_SOFTIRQS) {
+        softirq_handlers[nr] = handler;
+    }
+}
+
+void softirq_raise(int nr) {
+    __sync_fetch_and_or(&this_cpu()->softirq_pending, 1u << nr);
+}
+
+void softirq_run(void) {
+    u32 flags = local_irq_save();
+    cpu_t* cpu = this_cpu();
+    if (cpu->in_softirq || cpu->irq_depth > 0) {
+        local_irq_restore(flags);
+        return;
+    }
+
+    cpu->in_softirq = 1;
+    for (int round = 0; round < SOFTIRQ_MAX_RESTART && cpu->softirq_pending; round++) {
+        u32 pending = __sync_lock_test_and_set(&cpu->softirq_pending, 0);
+        local_irq_enable();
+        for (int nr = 0; pending; nr++, pending >>= 1) {
+            if ((pending & 1) && softirq_handlers[nr]) {
+                softirq_handlers[nr]();
+            }
+        }
+        local_irq_disable();
+    }
+    cpu->in_softirq = 0;
+    local_irq_restore(flags);
+}
+
+// tasklet
+void tasklet_init(tasklet_t* tasklet, void (*func)(void* data), void* data) {
+    tasklet->next = NULL;
+    tasklet->state = 0;
+    tasklet->func = func;
+    tasklet->data = data;
+}
+
+static void tasklet_queue(cpu_t* cpu, tasklet_t* tasklet) {
+    tasklet->next = NULL;
+    if (cpu->tasklet_tail) {
+        cpu->tasklet_tail->next = tasklet;
+    } else {
+        cpu->tasklet_head = tasklet;
+    }
+    cpu->tasklet_tail = tasklet;
+}
+
+void tasklet_schedule(tasklet_t* tasklet) {
+    // 已在队列中的 tasklet 不重复入队
+    if (__sync_fetch_and_or(&tasklet->state, TASKLET_SCHED) & TASKLET_SCHED) {
+        return;
+    }
+    u32 flags = local_irq_save();
+    tasklet_queue(this_cpu(), tasklet);
+    softirq_raise(SOFTIRQ_TASKLET);
+    local_irq_restore(flags);
+}
+
+static void tasklet_action(void) {
+    cpu_t* cpu = this_cpu();
+
+    local_irq_disable();
+    tasklet_t* list = cpu->tasklet_head;
+    cpu->tasklet_head = NULL;
+    cpu->tasklet_tail = NULL;
+    local_irq_enable();
+
+    while (list) {
+        tasklet_t* tasklet = list;
+        list = list->next;
+
+        // 正在别的 CPU 上运行: 放回队列稍后再试
+        if (__sync_fetch_and_or(&tasklet->state, TASKLET_RUN) & TASKLET_RUN) {
+            local_irq_disable();
+            tasklet_queue(cpu, tasklet);
+            softirq_raise(SOFTIRQ_TASKLET);
+            local_irq_enable();
+            continue;
+        }
+        __sync_fetch_and_and(&tasklet->state, ~TASKLET_SCHED);
+        tasklet->func(tasklet->data);
+        __sync_fetch_and_and(&tasklet->state, ~TASKLET_RUN);
+    }
+}
+
+void interrupt_init(void) {
+    pic_init();
+
+    // 所有向量都指向入口桩; 异常和硬件中断使用中断门 (DPL=0)
+    for (int vector = 0; vector < IDT_ENTRIES; vector++) {
+        idt_set_gate(vector, (u32)irq_stubs + vector * 16, 0x8E);
+    }
+    softirq_register(SOFTIRQ_TASKLET, tasklet_action);
+
+    idt_ptr.limit = sizeof(idt) - 1;
+    idt_ptr.base = (u32)&idt;
+    idt_load();
+    printf("中断系统初始化: %d 个向量\n", IDT_ENTRIES);
+}
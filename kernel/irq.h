@@ -0,0 +1,77 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "kernel.h"
+
+// 向量分配
+#define EXCEPTION_COUNT     32
+#define IRQ_BASE            0x20        // 8259 重映射后的 IRQ0
+#define IRQ_COUNT           16
+#define IDT_ENTRIES         256
+
+// 传统 IRQ 线
+#define IRQ_PIT             0
+#define IRQ_KEYBOARD        1
+#define IRQ_CASCADE         2
+#define IRQ_COM1            4
+#define IRQ_MOUSE           12
+#define IRQ_DISK            14
+
+// 中断现场 (由 irq_common 构造，顺序与压栈相反)
+typedef struct irq_frame {
+    u32 edi, esi, ebp, esp_dummy, ebx, edx, ecx, eax;   // pushal
+    u32 vector;
+    u32 error_code;                                     // 无错误码的向量为 0
+    u32 eip, cs, eflags;                                // CPU 压入
+    u32 useresp, ss;                                    // 仅从用户态进入时存在
+} irq_frame_t;
+
+typedef void (*irq_handler_t)(irq_frame_t* frame);
+
+// 从栈顶的 irq_frame_t 恢复现场并 iret (跳转目标，不能直接调用)
+void irq_return(void);
+
+// 注册中断处理函数 (可在 interrupt_init 之前调用)
+int irq_register(int vector, irq_handler_t handler);
+void irq_unregister(int vector);
+
+// 注册用户态可以用 int 指令触发的软件中断 (陷阱门，DPL=3，须在 interrupt_init 之后)
+int irq_register_user(int vector, irq_handler_t handler);
+
+// 中断/系统调用返回前: 执行软中断并按需重新调度
+void irq_exit(void);
+
+// 打开/屏蔽 8259 上的传统 IRQ 线
+void irq_unmask(int line);
+void irq_mask(int line);
+
+// 中断处理中 (含软中断) 返回非 0
+int in_interrupt(void);
+
+// 软中断: 每个 CPU 一个待处理位图，在中断返回和空闲循环中执行，执行时中断打开
+#define SOFTIRQ_TIMER       0
+#define SOFTIRQ_BLOCK       1
+#define SOFTIRQ_TASKLET     2
+#define NR_SOFTIRQS         3
+
+typedef void (*softirq_handler_t)(void);
+
+void softirq_register(int nr, softirq_handler_t handler);
+void softirq_raise(int nr);
+void softirq_run(void);
+
+// tasklet: 中断处理程序推迟的工作，同一 tasklet 不会在两个 CPU 上并发执行
+#define TASKLET_SCHED       0x1
+#define TASKLET_RUN         0x2
+
+typedef struct tasklet {
+    struct tasklet* next;
+    volatile u32 state;
+    void (*func)(void* data);
+    void* data;
+} tasklet_t;
+
+void tasklet_init(tasklet_t* tasklet, void (*func)(void* data), void* data);
+void tasklet_schedule(tasklet_t* tasklet);
+
+#endif // IRQ_H
@@ -1,6 +1,19 @@
 #include "kernel.h"
+#include "mm.h"
+#include "vmm.h"
+#include "smp.h"
+#include "timer.h"
+#include "input.h"
+#include "syscall.h"
+#include "klog.h"
+#include "profile.h"
+#include "ipc.h"
+#include "init.h"
+#include "boottime.h"
 #include <stdio.h>
 #include "../fs/fs.h"
+#include "../fs/pagecache.h"
+#include "../fs/dcache.h"
 #include "../gui/gui.h"
 #include "../apps/apps.h"
 
@@ -8,50 +21,125 @@
 static int kernel_running = 1;
 static u32 kernel_tick = 0;
 
+// 合成器帧率: 60Hz，每帧最多 10ms CPU 时间
+#define GUI_FRAME_PERIOD_US  16667
+#define GUI_FRAME_BUDGET_US  10000
+
+// 可以并行的初始化阶段
+static int input_node(void) {
+    input_init();
+    return 0;
+}
+
+static int apps_node(void) {
+    launch_desktop_apps();
+    return 0;
+}
+
+// 文件系统和图形界面互不依赖，可以同时初始化；输入事件要送到图形界面
+static init_node_t boot_nodes[] = {
+    INIT_NODE("fs", fs_init, NULL),
+    INIT_NODE("gui", gui_init, NULL),
+    INIT_NODE("input", input_node, "gui"),
+    INIT_NODE("apps", apps_node, "fs", "gui", "input"),
+};
+
 // 内核初始化
 void kernel_init(void) {
     printf("[%s] 初始化内核版本 %s\n", KERNEL_NAME, KERNEL_VERSION);
     
     // 初始化内存管理
     printf("初始化内存管理...\n");
+    mm_init();
+    vmm_init();
+    boottime_mark("mm");
     
     // 初始化中断系统
     printf("初始化中断系统...\n");
     interrupt_init();
+    boottime_mark("interrupts");
+    
+    // 初始化调度器并启动其他处理器
+    printf("初始化多处理器...\n");
+    smp_init();
+    boottime_mark("smp");
     
-    // 初始化文件系统
-    printf("初始化文件系统...\n");
-    fs_init();
+    // 启动时钟节拍并打开中断
+    printf("初始化时钟...\n");
+    timer_init();
+    boottime_mark("timer");
     
-    // 初始化GUI系统
-    printf("初始化图形界面...\n");
-    gui_init();
+    // 初始化系统调用
+    syscall_init();
+    
+    // 启动内核日志 (输出到串口)
+    klog_init();
+    
+    // 采样分析器 (串口命令控制)
+    profile_init();
+
+    // 内存统计 (串口命令 m 输出)
+    kmem_debug_init();
+
+    // 调度统计 (串口命令 s 输出)
+    sched_debug_init();
+
+    // 启动时间线 (串口命令 b 输出)
+    boottime_debug_init();
+
+    // 页缓存统计 (串口命令 c 输出)
+    pagecache_debug_init();
+
+    // 目录项缓存统计 (串口命令 n 输出)
+    dcache_debug_init();
+    boottime_mark("syscall_debug");
+    
+    local_irq_enable();
+    
+    // 输入设备、文件系统、图形界面和桌面应用程序按依赖关系并行初始化
+    printf("初始化子系统...\n");
+    if (init_run(boot_nodes, sizeof(boot_nodes) / sizeof(boot_nodes[0])) != 0) {
+        printf("部分子系统初始化失败\n");
+    }
+    boottime_mark("subsystems");
     
     printf("内核初始化完成\n");
     
-    // 启动桌面应用程序
-    printf("启动桌面应用程序...\n");
-    launch_desktop_apps();
+#ifdef KERNEL_BENCHMARK
+    // 性能测试
+    syscall_benchmark();
+    vmm_fork_benchmark();
+    gui_tlb_benchmark();
+    ipc_benchmark();
+#endif
 }
 
 // 内核主循环
 void kernel_main(void) {
     printf("[%s] 内核主循环启动\n", KERNEL_NAME);
+
+    // 主循环即合成器: 以截止期类运行，帧按时完成，又不会饿死其他任务
+    if (sched_set_deadline(GUI_FRAME_BUDGET_US, GUI_FRAME_PERIOD_US) < 0) {
+        printf("无法设置合成器的截止期调度\n");
+    }
     
     while (kernel_running) {
         kernel_tick++;
         
-        // 进程调度
-        schedule();
-        
         // 处理中断
         // interrupt_process();
         
         // 更新GUI
         gui_update();
         
-        // 简单的时间片轮转
-        sleep(10);
+        // 第一帧画出即启动完成，输出启动时间线
+        if (kernel_tick == 1) {
+            boottime_mark("first_frame");
+            boottime_report();
+        }
+        
+        // 睡眠到下一帧; 期间没有任务时 CPU 停止节拍进入 hlt
+        sched_wait_period();
     }
     
     printf("[%s] 内核主循环结束\n", KERNEL_NAME);
@@ -74,49 +162,6 @@ void kernel_shutdown(void) {
     printf("[%s] 系统已安全关闭\n", KERNEL_NAME);
 }
 
-// 简单的内存分配实现
-void* kmalloc(size_t size) {
-    // 这里应该实现真正的内存分配器
-    // 暂时使用简单的实现
-    static u8 memory_pool[1024 * 1024]; // 1MB 内存池
-    static size_t pool_offset = 0;
-    
-    if (pool_offset + size > sizeof(memory_pool)) {
-        return NULL; // 内存不足
-    }
-    
-    void* ptr = &memory_pool[pool_offset];
-    pool_offset += size;
-    return ptr;
-}
-
-void kfree(void* ptr) {
-    // 简单实现，不释放内存
-    // 实际应该实现真正的内存释放
-}
-
-// 进程调度实现
-int create_process(const char* name, void (*entry)(void)) {
-    printf("创建进程: %s\n", name);
-    // 这里应该实现真正的进程创建
-    return 0;
-}
-
-void schedule(void) {
-    // 简单的调度器实现
-    // 实际应该实现时间片轮转或优先级调度
-}
-
-void sleep(int ms) {
-    // 简单的睡眠实现
-    // 实际应该使用定时器中断
-}
-
-// 中断处理实现
-void interrupt_init(void) {
-    printf("中断系统初始化\n");
-}
+// 进程调度实现 (见 sched.c)，睡眠与定时器 (见 timer.c)
 
-void interrupt_handler(int irq) {
-    printf("处理中断: %d\n", irq);
-}
\ No newline at end of file
+// 中断处理实现 (见 irq.c)
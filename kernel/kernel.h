@@ -29,6 +29,16 @@ typedef int64_t s64;
 #define SYS_EXEC    8
 #define SYS_EXIT    9
 #define SYS_WAIT   10
+#define SYS_GETPID 11
+#define SYS_FUTEX  12
+#define SYS_IORING_SETUP 13
+#define SYS_IORING_ENTER 14
+#define SYS_IPC_CREATE 15
+#define SYS_IPC_SEND   16
+#define SYS_IPC_RECV   17
+#define SYS_IPC_NOTIFY 18
+#define SYS_IPC_CLOSE  19
+#define NR_SYSCALLS 20
 
 // 内核初始化函数
 void kernel_init(void);
@@ -46,6 +56,6 @@ void sleep(int ms);
 
 // 中断处理
 void interrupt_init(void);
-void interrupt_handler(int irq);
+void idt_load(void);
 
 #endif // KERNEL_H
\ No newline at end of file
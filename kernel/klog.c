@@ -0,0 +1,240 @@
+#include "klog.h"
+#include "smp.h"
+#include "serial.h"
+#include "clock.h"
+#include <stdio.h>
+
+// 每个 CPU 的环形缓冲
+// 写入者用 CAS 预留槽位 (同一 CPU 上的中断嵌套和被迁移的任务都可能并发写)，
+// 写完后在槽位上记下序号表示提交；klogd 按序号顺序取出。满时丢弃新记录。
+#define KLOG_RING_SIZE      128     // 必须为 2 的幂
+#define KLOG_DRAIN_MS       20
+#define KLOG_LINE_SIZE      256
+
+typedef struct {
+    volatile u32 seq;               // 提交时写入 位置 + 1
+    u8 subsys;
+    u8 level;
+    u16 cpu;
+    u64 timestamp;
+    const char* fmt;
+    u32 args[KLOG_MAX_ARGS];
+    char str[KLOG_STR_SIZE];
+} klog_record_t;
+
+typedef struct {
+    volatile u32 head;              // 下一个预留位置
+    volatile u32 tail;              // 下一个待输出位置
+    volatile u32 dropped;
+    klog_record_t records[KLOG_RING_SIZE];
+} klog_ring_t;
+
+volatile u32 klog_mask = (1u << KLOG_NR_SUBSYS) - 1;
+volatile u32 klog_level = KLOG_INFO;
+
+static klog_ring_t rings[MAX_CPUS];
+static spinlock_t drain_lock = SPINLOCK_INIT;
+static int klog_ready = 0;
+
+static const char* subsys_names[KLOG_NR_SUBSYS] = {
+    "kernel", "mm", "sched", "irq", "fs", "gui", "apps"
+};
+
+static const char level_chars[] = "EWID";
+
+// 找到下一个转换说明符 (跳过 %% 以及标志、宽度、精度和长度修饰)
+static const char* next_conversion(const char* p) {
+    for (; *p; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        p++;
+        while ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == ' ' ||
+               *p == '#' || *p == '.' || *p == 'l' || *p == 'h' || *p == 'z') {
+            p++;
+        }
+        if (!*p) {
+            return NULL;
+        }
+        if (*p != '%') {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// 按转换说明取参数；%s 的内容复制到记录里
+static void klog_capture(klog_record_t* rec, const char* fmt, __builtin_va_list ap) {
+    u32 nargs = 0;
+    u32 str_used = 0;
+
+    for (const char* p = next_conversion(fmt); p && nargs < KLOG_MAX_ARGS;
+         p = next_conversion(p + 1)) {
+        u32 value = __builtin_va_arg(ap, u32);
+        if (*p == 's') {
+            // 以记录内的偏移代替指针，输出时再换回
+            const char* src = value ? (const char*)value : "(null)";
+            u32 start = str_used;
+            while (*src && str_used < KLOG_STR_SIZE - 1) {
+                rec->str[str_used++] = *src++;
+            }
+            if (str_used < KLOG_STR_SIZE) {
+                rec->str[str_used++] = '\0';
+            }
+            value = start;
+        }
+        rec->args[nargs++] = value;
+    }
+}
+
+void klog_write(u32 subsys, u32 level, const char* fmt, ...) {
+    u32 cpu_id = this_cpu()->id;
+    klog_ring_t* ring = &rings[cpu_id];
+
+    // 预留槽位
+    u32 pos;
+    do {
+        pos = ring->head;
+        if (pos - ring->tail >= KLOG_RING_SIZE) {
+            __sync_fetch_and_add(&ring->dropped, 1);
+            return;
+        }
+    } while (!__sync_bool_compare_and_swap(&ring->head, pos, pos + 1));
+
+    klog_record_t* rec = &ring->records[pos & (KLOG_RING_SIZE - 1)];
+    rec->subsys = subsys;
+    rec->level = level;
+    rec->cpu = cpu_id;
+    rec->timestamp = clock_now();
+    rec->fmt = fmt;
+
+    __builtin_va_list ap;
+    __builtin_va_start(ap, fmt);
+    klog_capture(rec, fmt, ap);
+    __builtin_va_end(ap);
+
+    // 提交
+    __sync_synchronize();
+    rec->seq = pos + 1;
+}
+
+// 把 %s 参数从偏移换回指针 (指向本地副本)
+static void klog_resolve_strings(klog_record_t* rec) {
+    u32 nargs = 0;
+    for (const char* p = next_conversion(rec->fmt); p && nargs < KLOG_MAX_ARGS;
+         p = next_conversion(p + 1)) {
+        if (*p == 's') {
+            u32 offset = rec->args[nargs];
+            rec->args[nargs] = (u32)(offset < KLOG_STR_SIZE ? &rec->str[offset] : "");
+        }
+        nargs++;
+    }
+}
+
+static void klog_emit(klog_record_t* rec) {
+    char line[KLOG_LINE_SIZE];
+    u32 rem;
+    u64 us = div_u64_rem(rec->timestamp, NSEC_PER_USEC, NULL);
+    u32 secs = (u32)div_u64_rem(us, 1000000, &rem);
+
+    klog_resolve_strings(rec);
+    int len = snprintf(line, sizeof(line), "[%5u.%06u] %c cpu%u %s: ", secs, rem,
+                       level_chars[rec->level & 3], rec->cpu,
+                       rec->subsys < KLOG_NR_SUBSYS ? subsys_names[rec->subsys] : "?");
+    if (len < 0 || len >= (int)sizeof(line)) {
+        return;
+    }
+    // 参数个数不足时多传的参数会被忽略
+    int body = snprintf(line + len, sizeof(line) - len, rec->fmt,
+                        rec->args[0], rec->args[1], rec->args[2],
+                        rec->args[3], rec->args[4], rec->args[5]);
+    if (body < 0) {
+        return;
+    }
+    len += body;
+    if (len >= (int)sizeof(line)) {
+        len = sizeof(line) - 1;
+    }
+    serial_write(line, len);
+}
+
+// 输出一个 CPU 上已提交的记录
+static u32 klog_drain_ring(klog_ring_t* ring) {
+    u32 count = 0;
+    while (ring->tail != ring->head) {
+        u32 pos = ring->tail;
+        klog_record_t* slot = &ring->records[pos & (KLOG_RING_SIZE - 1)];
+        if (slot->seq != pos + 1) {
+            break; // 写入者还没提交
+        }
+        __sync_synchronize();
+        klog_record_t rec = *slot;
+        __sync_synchronize();
+        ring->tail = pos + 1;
+
+        klog_emit(&rec);
+        count++;
+    }
+
+    u32 dropped = __sync_lock_test_and_set(&ring->dropped, 0);
+    if (dropped) {
+        char line[64];
+        int len = snprintf(line, sizeof(line), "klog: 丢弃 %u 条记录\n", dropped);
+        if (len > 0) {
+            serial_write(line, len);
+        }
+    }
+    return count;
+}
+
+// klogd 正在输出时直接返回 (它持锁时可能被本 CPU 的中断打断)
+void klog_flush(void) {
+    u32 flags = local_irq_save();
+    if (spin_trylock(&drain_lock)) {
+        for (u32 i = 0; i < cpu_count; i++) {
+            klog_drain_ring(&rings[i]);
+        }
+        spin_unlock(&drain_lock);
+    }
+    local_irq_restore(flags);
+}
+
+// 输出串口很慢，持有 drain_lock 时不关中断
+static void klogd_main(void) {
+    for (;;) {
+        spin_lock(&drain_lock);
+        for (u32 i = 0; i < cpu_count; i++) {
+            klog_drain_ring(&rings[i]);
+        }
+        spin_unlock(&drain_lock);
+        sleep(KLOG_DRAIN_MS);
+    }
+}
+
+void klog_set_level(u32 level) {
+    klog_level = level;
+}
+
+void klog_enable(u32 subsys, int enable) {
+    if (subsys >= KLOG_NR_SUBSYS) {
+        return;
+    }
+    if (enable) {
+        __sync_fetch_and_or(&klog_mask, 1u << subsys);
+    } else {
+        __sync_fetch_and_and(&klog_mask, ~(1u << subsys));
+    }
+}
+
+void klog_init(void) {
+    if (klog_ready) {
+        return;
+    }
+    serial_init();
+    if (create_process("klogd", klogd_main) < 0) {
+        printf("无法创建 klogd\n");
+        return;
+    }
+    klog_ready = 1;
+    klog(KLOG_KERNEL, KLOG_INFO, "内核日志启动, %u 个 CPU\n", cpu_count);
+}
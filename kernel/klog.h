@@ -0,0 +1,55 @@
+#ifndef KLOG_H
+#define KLOG_H
+
+#include "kernel.h"
+
+// 内核日志
+// 记录只保存格式串指针和参数 (外加 %s 参数的副本)，写入当前 CPU 的
+// 无锁环形缓冲；klogd 任务在后台格式化后输出到串口。
+// 未开启的子系统/级别在调用处只有一次位测试。
+
+// 日志级别
+#define KLOG_ERR        0
+#define KLOG_WARN       1
+#define KLOG_INFO       2
+#define KLOG_DEBUG      3
+
+// 子系统
+#define KLOG_KERNEL     0
+#define KLOG_MM         1
+#define KLOG_SCHED      2
+#define KLOG_IRQ        3
+#define KLOG_FS         4
+#define KLOG_GUI        5
+#define KLOG_APPS       6
+#define KLOG_NR_SUBSYS  7
+
+// 每条记录最多的参数个数 (均按 32 位取)，以及 %s 副本的总长度
+#define KLOG_MAX_ARGS   6
+#define KLOG_STR_SIZE   48
+
+extern volatile u32 klog_mask;     // 每个子系统一位
+extern volatile u32 klog_level;    // 不高于此级别的记录才写入
+
+static inline int klog_enabled(u32 subsys, u32 level) {
+    return (klog_mask & (1u << subsys)) && level <= klog_level;
+}
+
+#define klog(subsys, level, ...)                        \
+    do {                                                \
+        if (klog_enabled(subsys, level)) {              \
+            klog_write(subsys, level, __VA_ARGS__);     \
+        }                                               \
+    } while (0)
+
+void klog_init(void);
+void klog_write(u32 subsys, u32 level, const char* fmt, ...);
+
+// 配置
+void klog_set_level(u32 level);
+void klog_enable(u32 subsys, int enable);
+
+// 同步输出所有未输出的记录 (不依赖 klogd)
+void klog_flush(void);
+
+#endif // KLOG_H
@@ -0,0 +1,35 @@
+#include "ksyms.h"
+
+// 链接脚本导出的代码段边界
+extern u8 __text_start[];
+extern u8 __text_end[];
+
+int ksym_index(u32 addr) {
+    if (ksym_count == 0 || addr < ksym_addrs[0] || addr >= (u32)__text_end) {
+        return -1;
+    }
+
+    // 二分查找最后一个起始地址 <= addr 的符号
+    u32 lo = 0;
+    u32 hi = ksym_count - 1;
+    while (lo < hi) {
+        u32 mid = (lo + hi + 1) / 2;
+        if (ksym_addrs[mid] <= addr) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+const char* ksym_lookup(u32 addr, u32* offset) {
+    int index = ksym_index(addr);
+    if (index < 0) {
+        return NULL;
+    }
+    if (offset) {
+        *offset = addr - ksym_addrs[index];
+    }
+    return ksym_names[index];
+}
@@ -0,0 +1,17 @@
+#ifndef KSYMS_H
+#define KSYMS_H
+
+#include "kernel.h"
+
+// 内核符号表 (链接时由 tools/ksyms.sh 生成，按地址升序)
+extern const u32 ksym_count;
+extern const u32 ksym_addrs[];
+extern const char* const ksym_names[];
+
+// 地址所在函数的序号，不在内核代码段内返回 -1
+int ksym_index(u32 addr);
+
+// 地址所在函数名和偏移，找不到返回 NULL
+const char* ksym_lookup(u32 addr, u32* offset);
+
+#endif // KSYMS_H
@@ -0,0 +1,100 @@
+#ifndef MM_H
+#define MM_H
+
+#include "kernel.h"
+#include "spinlock.h"
+
+// 页大小
+#define PAGE_SHIFT      12
+#define PAGE_SIZE       (1 << PAGE_SHIFT)
+#define PAGE_MASK       (~(PAGE_SIZE - 1))
+
+// 最大块阶数 (2^10 页 = 4MB)
+#define MAX_ORDER       11
+
+// 内核可直接访问的物理内存上限 (1GB)
+#define PHYS_MEM_LIMIT  0x40000000ULL
+
+// 页标志
+#define PG_FREE         0x01  // 位于空闲链表中
+#define PG_SLAB         0x02  // 属于某个 slab
+#define PG_LARGE        0x04  // 大对象分配的头页
+#define PG_RESERVED     0x08  // 保留页，不参与分配
+
+struct kmem_cache;
+
+// 页描述符
+typedef struct page {
+    u32 flags;
+    u16 order;                  // 块阶数 (仅头页有效)
+    u16 inuse;                  // slab 中已分配的对象数 (大对象头页: 分配标签)
+    volatile u32 refcount;      // 引用数 (写时复制共享的用户页可大于 1)
+    void* freelist;             // slab 空闲对象链表
+    struct kmem_cache* cache;   // 所属 slab 缓存
+    struct page* next;
+    struct page* prev;
+} page_t;
+
+// 分配标签: 按子系统统计内核内存，每个标签使用独立的 slab 缓存
+#define KMEM_KERNEL     0
+#define KMEM_FS         1
+#define KMEM_GUI        2
+#define KMEM_APPS       3
+#define KMEM_NR_TAGS    4
+
+// 每个标签的统计 (字节数按尺寸等级取整)
+typedef struct {
+    volatile u32 live_bytes;    // 当前已分配
+    volatile u32 peak_bytes;    // live_bytes 的最高值
+    volatile u32 held_bytes;    // 占用的页 (slab 页 + 大对象页)
+    volatile u32 live_objects;
+    volatile u32 nr_allocs;     // 累计分配次数
+    volatile u32 nr_frees;
+    volatile u32 nr_failed;     // 分配失败次数
+    volatile u32 requested;     // 累计请求的字节数
+    volatile u32 allocated;     // 累计实际分配的字节数 (与 requested 之差为内部碎片)
+} kmem_stats_t;
+
+// slab 缓存 (每个标签、每个尺寸等级一个)
+typedef struct kmem_cache {
+    spinlock_t lock;
+    u32 tag;                    // KMEM_*
+    u32 size;                   // 对象大小
+    u32 objs_per_slab;          // 每个 slab 的对象数
+    page_t* partial;            // 仍有空闲对象的 slab
+    u32 nr_slabs;               // 当前持有的 slab 数
+    u32 nr_empty;               // 完全空闲的 slab 数
+} kmem_cache_t;
+
+// 内存管理初始化
+void mm_init(void);
+
+// 物理页分配 (伙伴系统，按阶数)
+void page_init(void);
+void* page_alloc(u32 order);
+void page_free(void* addr, u32 order);
+page_t* virt_to_page(const void* addr);
+void* page_to_virt(page_t* page);
+u32 page_free_count(void);
+u32 page_total_count(void);
+u32 page_max_pfn(void);
+
+// 单页引用计数: page_alloc 返回时为 1，page_put 减到 0 时释放
+void page_get(void* addr);
+void page_put(void* addr);
+u32 page_refcount(void* addr);
+
+// slab 分配器
+void slab_init(void);
+u32 size_to_order(size_t size);
+
+// 带标签的分配 (kmalloc 使用 KMEM_KERNEL)，kfree 按对象所在缓存自动记账
+void* kmalloc_tagged(size_t size, int tag);
+
+// 内存统计
+int kmem_get_stats(int tag, kmem_stats_t* stats);
+const char* kmem_tag_name(int tag);
+void kmem_dump(void);           // 输出到串口
+void kmem_debug_init(void);     // 注册串口命令 m (须在中断初始化之后)
+
+#endif // MM_H
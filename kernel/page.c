@@ -0,0 +1,299 @@
+#include "mm.h"
+#include "spinlock.h"
+#include "../boot/boot.h"
+#include <string.h>
+#include <stdio.h>
+
+// 伙伴系统物理页分配器
+// 所有物理页帧由 mem_map 描述，空闲块按阶数挂在 free_area 中，
+// 块 i 的伙伴为 i ^ (1 << order)，释放时逐级合并。
+
+// 内核映像边界 (linker.ld)
+extern u8 __kernel_end[];
+
+#define MAX_RANGES 32
+
+typedef struct {
+    u32 start;  // 起始页帧号
+    u32 end;    // 结束页帧号 (不含)
+} pfn_range_t;
+
+static page_t* mem_map = NULL;
+static u32 max_pfn = 0;
+
+// 每个阶数的空闲块链表
+static page_t* free_area[MAX_ORDER];
+static u32 nr_free = 0;
+static u32 nr_total = 0;
+static spinlock_t zone_lock = SPINLOCK_INIT;
+
+static inline u32 page_to_pfn(page_t* page) {
+    return (u32)(page - mem_map);
+}
+
+static void free_area_push(page_t* page, u32 order) {
+    page->flags = PG_FREE;
+    page->order = order;
+    page->prev = NULL;
+    page->next = free_area[order];
+    if (free_area[order]) {
+        free_area[order]->prev = page;
+    }
+    free_area[order] = page;
+}
+
+static void free_area_remove(page_t* page, u32 order) {
+    if (page->prev) {
+        page->prev->next = page->next;
+    } else {
+        free_area[order] = page->next;
+    }
+    if (page->next) {
+        page->next->prev = page->prev;
+    }
+    page->next = NULL;
+    page->prev = NULL;
+    page->flags = 0;
+}
+
+// 将 [start, end) 内的页按最大对齐块放入伙伴系统
+static void free_pfn_range(u32 start, u32 end) {
+    while (start < end) {
+        u32 order = 0;
+        while (order + 1 < MAX_ORDER &&
+               !(start & ((1u << (order + 1)) - 1)) &&
+               start + (1u << (order + 1)) <= end) {
+            order++;
+        }
+        mem_map[start].flags = 0;
+        page_free(page_to_virt(&mem_map[start]), order);
+        start += 1u << order;
+    }
+}
+
+// 从引导信息收集可用物理内存区间
+static int collect_ranges(pfn_range_t* ranges) {
+    const boot_info_t* info = boot_get_info();
+    int count = 0;
+
+    if (info->flags & BOOT_FLAG_MMAP) {
+        u32 addr = info->mmap_addr;
+        while (addr < info->mmap_addr + info->mmap_length && count < MAX_RANGES) {
+            const mmap_entry_t* entry = (const mmap_entry_t*)addr;
+            addr += entry->size + sizeof(entry->size);
+
+            if (entry->type != MMAP_TYPE_AVAILABLE || entry->base_addr >= PHYS_MEM_LIMIT) {
+                continue;
+            }
+            u64 end = entry->base_addr + entry->length;
+            if (end > PHYS_MEM_LIMIT) {
+                end = PHYS_MEM_LIMIT;
+            }
+            ranges[count].start = (u32)((entry->base_addr + PAGE_SIZE - 1) >> PAGE_SHIFT);
+            ranges[count].end = (u32)(end >> PAGE_SHIFT);
+            if (ranges[count].start < ranges[count].end) {
+                count++;
+            }
+        }
+    } else {
+        // 没有内存映射表时退回到 mem_lower/mem_upper
+        u64 upper_end = 0x100000 + (u64)info->mem_upper * 1024;
+        if (upper_end > PHYS_MEM_LIMIT) {
+            upper_end = PHYS_MEM_LIMIT;
+        }
+        ranges[count].start = 0;
+        ranges[count].end = info->mem_lower * 1024 / PAGE_SIZE;
+        count++;
+        ranges[count].start = 0x100000 >> PAGE_SHIFT;
+        ranges[count].end = (u32)(upper_end >> PAGE_SHIFT);
+        count++;
+    }
+
+    return count;
+}
+
+static void reserve_pfn_range(u32 start, u32 end) {
+    for (u32 pfn = start; pfn < end && pfn < max_pfn; pfn++) {
+        mem_map[pfn].flags = PG_RESERVED;
+    }
+}
+
+void page_init(void) {
+    pfn_range_t ranges[MAX_RANGES];
+    int count = collect_ranges(ranges);
+    const boot_info_t* info = boot_get_info();
+
+    max_pfn = 0;
+    for (int i = 0; i < count; i++) {
+        if (ranges[i].end > max_pfn) {
+            max_pfn = ranges[i].end;
+        }
+    }
+
+    // 在内核映像之后找一段能放下 mem_map 的可用内存
+    u32 kernel_end_pfn = ((u32)__kernel_end + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    u32 map_pages = (max_pfn * sizeof(page_t) + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    u32 map_pfn = 0;
+    for (int i = 0; i < count && !map_pfn; i++) {
+        u32 start = ranges[i].start > kernel_end_pfn ? ranges[i].start : kernel_end_pfn;
+        if (start + map_pages <= ranges[i].end) {
+            map_pfn = start;
+        }
+    }
+    if (!map_pfn) {
+        printf("无法放置页描述符表\n");
+        return;
+    }
+
+    mem_map = (page_t*)(map_pfn << PAGE_SHIFT);
+    memset(mem_map, 0, max_pfn * sizeof(page_t));
+    memset(free_area, 0, sizeof(free_area));
+    nr_free = 0;
+
+    // 先全部标记为保留，再放开可用区间
+    for (u32 pfn = 0; pfn < max_pfn; pfn++) {
+        mem_map[pfn].flags = PG_RESERVED;
+    }
+    for (int i = 0; i < count; i++) {
+        for (u32 pfn = ranges[i].start; pfn < ranges[i].end; pfn++) {
+            mem_map[pfn].flags = 0;
+        }
+    }
+
+    // 保留低 1MB、内核映像、mem_map 自身和引导模块
+    reserve_pfn_range(0, KERNEL_LOAD_ADDR >> PAGE_SHIFT);
+    reserve_pfn_range(KERNEL_LOAD_ADDR >> PAGE_SHIFT, kernel_end_pfn);
+    reserve_pfn_range(map_pfn, map_pfn + map_pages);
+    if (info->flags & BOOT_FLAG_MODS) {
+        const module_entry_t* mods = (const module_entry_t*)info->mods_addr;
+        for (u32 i = 0; i < info->mods_count; i++) {
+            reserve_pfn_range(mods[i].mod_start >> PAGE_SHIFT,
+                              (mods[i].mod_end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+        }
+    }
+
+    // 把连续的非保留页交给伙伴系统
+    u32 pfn = 0;
+    while (pfn < max_pfn) {
+        if (mem_map[pfn].flags & PG_RESERVED) {
+            pfn++;
+            continue;
+        }
+        u32 start = pfn;
+        while (pfn < max_pfn && !(mem_map[pfn].flags & PG_RESERVED)) {
+            pfn++;
+        }
+        free_pfn_range(start, pfn);
+    }
+    nr_total = nr_free;
+
+    printf("物理内存: %u MB 可用, 页描述符 %u KB\n",
+           nr_free >> (20 - PAGE_SHIFT), map_pages * PAGE_SIZE / 1024);
+}
+
+// 分配 2^order 个连续页，块按自身大小对齐
+void* page_alloc(u32 order) {
+    if (order >= MAX_ORDER) {
+        return NULL;
+    }
+
+    u32 flags = spin_lock_irqsave(&zone_lock);
+    u32 current = order;
+    while (current < MAX_ORDER && !free_area[current]) {
+        current++;
+    }
+    if (current == MAX_ORDER) {
+        spin_unlock_irqrestore(&zone_lock, flags);
+        return NULL; // 内存不足
+    }
+
+    page_t* page = free_area[current];
+    free_area_remove(page, current);
+
+    // 逐级拆分，把后半块放回低一阶的链表
+    while (current > order) {
+        current--;
+        free_area_push(page + (1u << current), current);
+    }
+
+    page->order = order;
+    page->refcount = 1;
+    nr_free -= 1u << order;
+    spin_unlock_irqrestore(&zone_lock, flags);
+    return page_to_virt(page);
+}
+
+void page_free(void* addr, u32 order) {
+    page_t* page = virt_to_page(addr);
+    if (!page || order >= MAX_ORDER || (page->flags & (PG_FREE | PG_RESERVED))) {
+        return;
+    }
+
+    u32 flags = spin_lock_irqsave(&zone_lock);
+    page->cache = NULL;
+    page->freelist = NULL;
+    page->inuse = 0;
+    nr_free += 1u << order;
+
+    // 与空闲伙伴逐级合并
+    u32 pfn = page_to_pfn(page);
+    while (order + 1 < MAX_ORDER) {
+        u32 buddy_pfn = pfn ^ (1u << order);
+        if (buddy_pfn >= max_pfn) {
+            break;
+        }
+        page_t* buddy = &mem_map[buddy_pfn];
+        if (!(buddy->flags & PG_FREE) || buddy->order != order) {
+            break;
+        }
+        free_area_remove(buddy, order);
+        pfn &= ~(1u << order);
+        order++;
+    }
+
+    free_area_push(&mem_map[pfn], order);
+    spin_unlock_irqrestore(&zone_lock, flags);
+}
+
+void page_get(void* addr) {
+    page_t* page = virt_to_page(addr);
+    if (page) {
+        __sync_fetch_and_add(&page->refcount, 1);
+    }
+}
+
+void page_put(void* addr) {
+    page_t* page = virt_to_page(addr);
+    if (page && __sync_sub_and_fetch(&page->refcount, 1) == 0) {
+        page_free(addr, 0);
+    }
+}
+
+u32 page_refcount(void* addr) {
+    page_t* page = virt_to_page(addr);
+    return page ? page->refcount : 0;
+}
+
+page_t* virt_to_page(const void* addr) {
+    u32 pfn = (u32)addr >> PAGE_SHIFT;
+    if (!mem_map || pfn >= max_pfn) {
+        return NULL;
+    }
+    return &mem_map[pfn];
+}
+
+void* page_to_virt(page_t* page) {
+    return (void*)(page_to_pfn(page) << PAGE_SHIFT);
+}
+
+u32 page_free_count(void) {
+    return nr_free;
+}
+
+u32 page_total_count(void) {
+    return nr_total;
+}
+
+u32 page_max_pfn(void) {
+    return max_pfn;
+}
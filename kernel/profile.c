@@ -0,0 +1,186 @@
+#include "profile.h"
+#include "ksyms.h"
+#include "smp.h"
+#include "sched.h"
+#include "timer.h"
+#include "serial.h"
+#include "mm.h"
+#include "clock.h"
+#include <stdio.h>
+
+// 每个 CPU 一个样本缓冲，只有本 CPU 的时钟中断写入，不需要锁
+typedef struct {
+    u32* eips;
+    volatile u32 count;
+    volatile u32 lost;
+    volatile u32 user;          // 用户态样本只计数
+    u32 gen;                    // 与 reset_gen 不同时表示样本已作废
+} profile_buf_t;
+
+static profile_buf_t bufs[MAX_CPUS];
+static volatile u32 reset_gen = 0;
+static volatile int profiling = 0;
+static volatile int dumping = 0;
+static int profile_ready = 0;
+
+void profile_sample(irq_frame_t* frame) {
+    if (!profiling) {
+        return;
+    }
+
+    // 清空由各 CPU 在自己的下一次采样时完成，避免与采样竞争
+    profile_buf_t* buf = &bufs[this_cpu()->id];
+    if (buf->gen != reset_gen) {
+        buf->count = 0;
+        buf->lost = 0;
+        buf->user = 0;
+        buf->gen = reset_gen;
+    }
+    if ((frame->cs & 3) != 0) {
+        buf->user++;
+    } else if (buf->eips && buf->count < PROFILE_BUF_SIZE) {
+        buf->eips[buf->count++] = frame->eip;
+    } else {
+        buf->lost++;
+    }
+}
+
+void profile_start(void) {
+    if (!profile_ready) {
+        return;
+    }
+    profiling = 1;
+    serial_puts("profile: 开始采样\n");
+}
+
+void profile_stop(void) {
+    profiling = 0;
+    serial_puts("profile: 停止采样\n");
+}
+
+void profile_reset(void) {
+    reset_gen++;
+    serial_puts("profile: 样本已清空\n");
+}
+
+void profile_dump(void) {
+    char line[128];
+    int was_profiling = profiling;
+    profiling = 0;
+    sleep(2); // 等其他 CPU 上正在进行的采样结束
+
+    // 每个符号一个计数，最后一项统计代码段外的地址
+    u32* hist = kmalloc((ksym_count + 1) * sizeof(u32));
+    if (!hist) {
+        serial_puts("profile: 内存不足\n");
+        profiling = was_profiling;
+        return;
+    }
+    for (u32 i = 0; i <= ksym_count; i++) {
+        hist[i] = 0;
+    }
+
+    u32 total = 0;
+    u32 user = 0;
+    u32 lost = 0;
+    for (u32 cpu = 0; cpu < cpu_count; cpu++) {
+        profile_buf_t* buf = &bufs[cpu];
+        if (buf->gen != reset_gen) {
+            continue;
+        }
+        for (u32 i = 0; i < buf->count; i++) {
+            int index = ksym_index(buf->eips[i]);
+            hist[index < 0 ? ksym_count : (u32)index]++;
+        }
+        total += buf->count + buf->user;
+        user += buf->user;
+        lost += buf->lost;
+    }
+
+    snprintf(line, sizeof(line), "profile: %u 个样本 (用户态 %u, 丢失 %u), %u 个符号\n",
+             total, user, lost, ksym_count);
+    serial_puts(line);
+    if (total == 0) {
+        kfree(hist);
+        profiling = was_profiling;
+        return;
+    }
+
+    // 每次选出剩余计数最多的符号 (条目数很少，不需要排序)
+    serial_puts("   样本     比例  函数\n");
+    for (int n = 0; n < PROFILE_TOP; n++) {
+        u32 best = 0;
+        for (u32 i = 1; i <= ksym_count; i++) {
+            if (hist[i] > hist[best]) {
+                best = i;
+            }
+        }
+        if (hist[best] == 0) {
+            break;
+        }
+        u32 permille = (u32)div_u64_rem((u64)hist[best] * 1000, total, NULL);
+        snprintf(line, sizeof(line), "%7u  %3u.%u%%  %s\n", hist[best], permille / 10,
+                 permille % 10, best < ksym_count ? ksym_names[best] : "[未知]");
+        serial_puts(line);
+        hist[best] = 0;
+    }
+    if (user) {
+        u32 permille = (u32)div_u64_rem((u64)user * 1000, total, NULL);
+        snprintf(line, sizeof(line), "%7u  %3u.%u%%  [用户态]\n", user, permille / 10,
+                 permille % 10);
+        serial_puts(line);
+    }
+
+    kfree(hist);
+    profiling = was_profiling;
+}
+
+static void profile_dump_task(void) {
+    profile_dump();
+    dumping = 0;
+}
+
+// 串口命令 (tasklet 中执行，耗时的输出交给单独的任务)
+static void profile_command(char key) {
+    switch (key) {
+        case 'p':
+            if (profiling) {
+                profile_stop();
+            } else {
+                profile_start();
+            }
+            break;
+        case 'd':
+            if (!dumping) {
+                dumping = 1;
+                if (create_process("profile_dump", profile_dump_task) < 0) {
+                    dumping = 0;
+                }
+            }
+            break;
+        case 'r':
+            profile_reset();
+            break;
+        default:
+            break;
+    }
+}
+
+void profile_init(void) {
+    for (u32 i = 0; i < cpu_count; i++) {
+        bufs[i].eips = kmalloc(PROFILE_BUF_SIZE * sizeof(u32));
+        if (!bufs[i].eips) {
+            printf("profile: 无法为 CPU %u 分配样本缓冲\n", i);
+            return;
+        }
+    }
+    profile_ready = 1;
+    serial_register_command('p', profile_command);
+    serial_register_command('d', profile_command);
+    serial_register_command('r', profile_command);
+    printf("采样分析器: %u 个内核符号，串口命令 p/d/r\n", ksym_count);
+
+#ifdef KERNEL_PROFILE
+    profile_start();
+#endif
+}
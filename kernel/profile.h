@@ -0,0 +1,27 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "kernel.h"
+#include "irq.h"
+
+// 采样分析器: 时钟中断记录被打断的 EIP，按内核符号汇总后从串口输出直方图
+// 串口命令: p 开始/停止采样, d 输出直方图, r 清空样本
+
+// 每个 CPU 的样本缓冲 (满后计入丢失数)
+#define PROFILE_BUF_SIZE    8192
+
+// 直方图输出的条目数
+#define PROFILE_TOP         30
+
+void profile_init(void);
+void profile_start(void);
+void profile_stop(void);
+void profile_reset(void);
+
+// 汇总并从串口输出直方图 (可能睡眠，不能在中断中调用)
+void profile_dump(void);
+
+// 时钟中断中调用
+void profile_sample(irq_frame_t* frame);
+
+#endif // PROFILE_H
@@ -0,0 +1,864 @@
+#include "sched.h"
+#include "smp.h"
+#include "mm.h"
+#include "apic.h"
+#include "timer.h"
+#include "clock.h"
+#include "gdt.h"
+#include "vmm.h"
+#include "serial.h"
+#include "../fs/file.h"
+#include <string.h>
+#include <stdio.h>
+
+// 调度器: 每个 CPU 一个运行队列，空闲 CPU 从最忙的 CPU 窃取任务。
+// 截止期类 (EDF) 任务在队列中单独排序，总是先于普通任务运行；
+// 每个周期只能用完自己的预算，用完后暂停到下个周期，不会饿死普通任务。
+
+static volatile u32 next_pid = 1;
+
+// 保护所有任务的 parent/children/sibling
+static spinlock_t tasks_lock = SPINLOCK_INIT;
+
+// 每个 CPU 各自记录 (只在本 CPU 关中断时更新)，读取时求和
+static sched_class_stats_t class_stats[MAX_CPUS][SCHED_NR_CLASSES];
+
+// 上下文切换: 保存当前寄存器到 *old_esp，切换到 new_esp
+void context_switch(u32* old_esp, u32 new_esp);
+__asm__ (
+    ".section .text\n"
+    ".global context_switch\n"
+    "context_switch:\n"
+    "    movl 4(%esp), %eax\n"
+    "    movl 8(%esp), %edx\n"
+    "    pushl %ebp\n"
+    "    pushl %ebx\n"
+    "    pushl %esi\n"
+    "    pushl %edi\n"
+    "    pushfl\n"
+    "    movl %esp, (%eax)\n"
+    "    movl %edx, %esp\n"
+    "    popfl\n"
+    "    popl %edi\n"
+    "    popl %esi\n"
+    "    popl %ebx\n"
+    "    popl %ebp\n"
+    "    ret\n"
+);
+
+// 运行队列操作 (调用者持有锁)
+static void rq_push(run_queue_t* rq, task_t* task) {
+    task->enqueue_ns = clock_now();
+    if (task->policy == SCHED_DEADLINE) {
+        // 按截止期插入，相同截止期先来先运行
+        task_t** link = &rq->dl_head;
+        while (*link && (*link)->dl_deadline <= task->dl_deadline) {
+            link = &(*link)->next;
+        }
+        task->next = *link;
+        *link = task;
+        rq->count++;
+        return;
+    }
+
+    task->next = NULL;
+    if (rq->tail) {
+        rq->tail->next = task;
+    } else {
+        rq->head = task;
+    }
+    rq->tail = task;
+    rq->count++;
+    if (task->affinity == CPU_ANY) {
+        rq->migratable++;
+    }
+}
+
+// 从队列中取出第一个允许在 cpu_id 上运行的任务
+static task_t* rq_take_for(run_queue_t* rq, u32 cpu_id) {
+    task_t* prev = NULL;
+    task_t* task = rq->head;
+    while (task) {
+        if (task->affinity == CPU_ANY || task->affinity == (int)cpu_id) {
+            if (prev) {
+                prev->next = task->next;
+            } else {
+                rq->head = task->next;
+            }
+            if (rq->tail == task) {
+                rq->tail = prev;
+            }
+            task->next = NULL;
+            rq->count--;
+            if (task->affinity == CPU_ANY) {
+                rq->migratable--;
+            }
+            return task;
+        }
+        prev = task;
+        task = task->next;
+    }
+    return NULL;
+}
+
+static task_t* rq_take_dl(run_queue_t* rq) {
+    task_t* task = rq->dl_head;
+    if (task) {
+        rq->dl_head = task->next;
+        task->next = NULL;
+        rq->count--;
+    }
+    return task;
+}
+
+// 找到可迁移任务最多的 CPU
+static cpu_t* steal_victim(cpu_t* cpu) {
+    cpu_t* victim = NULL;
+    u32 max_count = 0;
+    for (u32 i = 0; i < cpu_count; i++) {
+        cpu_t* other = &cpus[i];
+        if (other == cpu || !other->online) {
+            continue;
+        }
+        if (other->rq.migratable > max_count) {
+            max_count = other->rq.migratable;
+            victim = other;
+        }
+    }
+    return victim;
+}
+
+// 工作窃取: 从最忙的 CPU 取一个可迁移的任务
+static task_t* steal_task(cpu_t* cpu) {
+    cpu_t* victim = steal_victim(cpu);
+    if (!victim) {
+        return NULL;
+    }
+
+    if (!spin_trylock(&victim->rq.lock)) {
+        return NULL; // 对方正忙，下次再试
+    }
+    task_t* task = rq_take_for(&victim->rq, cpu->id);
+    spin_unlock(&victim->rq.lock);
+
+    if (task) {
+        cpu->nr_steals++;
+    }
+    return task;
+}
+
+// 唤醒在 hlt 中等待的 CPU
+static void cpu_kick(cpu_t* cpu) {
+    __sync_synchronize();
+    if (cpu->halted && cpu != this_cpu()) {
+        lapic_send_ipi(cpu->apic_id, RESCHED_VECTOR);
+    }
+}
+
+// 把任务放入 cpu 的运行队列并唤醒相应的 CPU
+static void rq_enqueue(cpu_t* cpu, task_t* task) {
+    u32 flags = spin_lock_irqsave(&cpu->rq.lock);
+    rq_push(&cpu->rq, task);
+    spin_unlock_irqrestore(&cpu->rq.lock, flags);
+
+    // 截止期类任务尽快抢占目标 CPU 上正在运行的任务 (由 schedule 比较截止期)
+    if (task->policy == SCHED_DEADLINE && !cpu->halted) {
+        cpu->need_resched = 1;
+        if (cpu != this_cpu()) {
+            lapic_send_ipi(cpu->apic_id, RESCHED_VECTOR);
+        }
+    }
+
+    cpu_kick(cpu);
+    // 目标 CPU 正忙时叫醒一个空闲 CPU 来窃取
+    if (task->affinity == CPU_ANY && !cpu->halted) {
+        for (u32 i = 0; i < cpu_count; i++) {
+            if (cpus[i].online && cpus[i].halted && &cpus[i] != cpu) {
+                cpu_kick(&cpus[i]);
+                break;
+            }
+        }
+    }
+}
+
+static void task_free(task_t* task) {
+    if (task->files) {
+        fd_table_destroy(task->files);
+    }
+    if (task->space) {
+        vmm_destroy_space(task->space);
+    }
+    if (task->stack) {
+        page_free(task->stack, TASK_STACK_ORDER);
+    }
+    kfree(task);
+}
+
+// 切换完成后的收尾: 此时已不在前一个任务的栈上，可以安全地让它被别的 CPU 取走
+static void finish_switch(cpu_t* cpu) {
+    task_t* prev = cpu->switch_prev;
+    cpu->switch_prev = NULL;
+    if (!prev) {
+        return;
+    }
+
+    // 在 on_cpu 清零之前被唤醒的任务由这里负责入队
+    spin_lock(&prev->lock);
+    prev->on_cpu = 0;
+    u32 state = prev->state;
+    int throttled = prev->dl_throttled; // 暂停中的任务由补充预算的定时器入队
+    spin_unlock(&prev->lock);
+
+    if (state == TASK_RUNNABLE && !throttled && prev != cpu->idle) {
+        spin_lock(&cpu->rq.lock);
+        rq_push(&cpu->rq, prev);
+        spin_unlock(&cpu->rq.lock);
+    } else if (state == TASK_DEAD) {
+        task_free(prev);
+    }
+}
+
+// 释放已退出的任务 (已离开任务树): 还没切换走的由 finish_switch 释放
+static void task_reap(task_t* task) {
+    u32 flags = spin_lock_irqsave(&task->lock);
+    task->state = TASK_DEAD;
+    int running = task->on_cpu;
+    spin_unlock_irqrestore(&task->lock, flags);
+    if (!running) {
+        task_free(task);
+    }
+}
+
+// 新任务的第一条指令
+static void task_entry(void) {
+    cpu_t* cpu = this_cpu();
+    finish_switch(cpu);
+    local_irq_enable();
+
+    cpu->current->entry();
+    task_exit(0);
+}
+
+static task_t* task_alloc(const char* name) {
+    task_t* task = kmalloc(sizeof(task_t));
+    if (!task) {
+        return NULL;
+    }
+    memset(task, 0, sizeof(task_t));
+    task->pid = __sync_fetch_and_add(&next_pid, 1);
+    strncpy(task->name, name, sizeof(task->name) - 1);
+    task->lock = (spinlock_t)SPINLOCK_INIT;
+    wait_queue_init(&task->child_exit);
+    task->affinity = CPU_ANY;
+    task->state = TASK_RUNNABLE;
+    return task;
+}
+
+// 为任务构造初始栈，使 context_switch 返回到 task_entry
+static int task_setup_stack(task_t* task, void (*entry)(void)) {
+    task->stack = page_alloc(TASK_STACK_ORDER);
+    if (!task->stack) {
+        return -1;
+    }
+
+    u32* sp = (u32*)((u8*)task->stack + TASK_STACK_SIZE);
+    *--sp = 0;                  // task_entry 的返回地址 (不会用到)
+    *--sp = (u32)task_entry;
+    *--sp = 0;                  // ebp
+    *--sp = 0;                  // ebx
+    *--sp = 0;                  // esi
+    *--sp = 0;                  // edi
+    *--sp = 0x002;              // eflags
+    task->esp = (u32)sp;
+    task->entry = entry;
+    return 0;
+}
+
+// 把当前执行上下文包装成任务
+static task_t* task_adopt_current(cpu_t* cpu, const char* name) {
+    task_t* task = task_alloc(name);
+    if (!task) {
+        return NULL;
+    }
+    task->state = TASK_RUNNING;
+    task->on_cpu = 1;
+    task->cpu = cpu->id;
+    task->affinity = cpu->id;
+    cpu->current = task;
+    return task;
+}
+
+static void idle_entry(void) {
+    cpu_idle();
+}
+
+void sched_init(void) {
+    cpu_t* cpu = &cpus[0];
+
+    // 引导上下文成为内核主任务 (pid 0)，固定在 CPU 0
+    task_t* main_task = task_adopt_current(cpu, "kernel");
+    if (main_task) {
+        main_task->pid = 0;
+    }
+
+    // CPU 0 另建一个空闲任务
+    task_t* idle = task_alloc("idle/0");
+    if (idle && task_setup_stack(idle, idle_entry) == 0) {
+        idle->affinity = 0;
+        cpu->idle = idle;
+    }
+
+    printf("调度器初始化完成\n");
+}
+
+// AP 的引导上下文直接成为其空闲任务
+void sched_init_cpu(cpu_t* cpu) {
+    char name[16] = "idle/";
+    name[5] = '0' + cpu->id / 10;
+    name[6] = '0' + cpu->id % 10;
+    name[7] = '\0';
+    cpu->idle = task_adopt_current(cpu, name);
+}
+
+task_t* current_task(void) {
+    return this_cpu()->current;
+}
+
+void sched_enqueue(task_t* task) {
+    cpu_t* cpu = this_cpu();
+    if (task->affinity != CPU_ANY && task->affinity < (int)cpu_count) {
+        cpu = &cpus[task->affinity];
+    }
+
+    task->state = TASK_RUNNABLE;
+    rq_enqueue(cpu, task);
+}
+
+// 截止期调度
+
+// 进入下一个周期并补满预算 (落后超过一个周期时从现在重新对齐)
+static void dl_new_period(task_t* task, u64 now) {
+    if (now >= task->dl_deadline + task->dl_period) {
+        task->dl_deadline = now + task->dl_period;
+    } else if (now >= task->dl_deadline) {
+        task->dl_deadline += task->dl_period;
+    }
+    task->dl_budget = (s64)task->dl_runtime;
+}
+
+static void dl_wakeup(task_t* task) {
+    u64 now = clock_now();
+    if (now >= task->dl_deadline) {
+        dl_new_period(task, now);
+    }
+}
+
+// 周期开始: 补充预算，解除暂停
+static void dl_replenish(void* data) {
+    task_t* task = data;
+    u32 flags = spin_lock_irqsave(&task->lock);
+    dl_new_period(task, clock_now());
+    task->dl_throttled = 0;
+    int queue = task->state == TASK_RUNNABLE && !task->on_cpu;
+    spin_unlock_irqrestore(&task->lock, flags);
+
+    if (queue) {
+        int target = task->affinity != CPU_ANY ? task->affinity : task->cpu;
+        rq_enqueue(&cpus[target], task);
+    }
+}
+
+// 暂停到本周期结束 (中断已关闭)
+static void dl_throttle(task_t* task, u64 now) {
+    spin_lock(&task->lock);
+    task->dl_throttled = 1;
+    spin_unlock(&task->lock);
+
+    u64 delta = task->dl_deadline > now ? task->dl_deadline - now : 0;
+    timer_add(&task->dl_timer, ms_to_ticks((u32)div_u64_rem(delta + NSEC_PER_MSEC - 1, NSEC_PER_MSEC, NULL)));
+}
+
+// 节拍中扣除预算，用完后暂停
+static void dl_tick(cpu_t* cpu, task_t* task) {
+    u64 now = clock_now();
+    task->dl_budget -= (s64)(now - task->dl_last);
+    task->dl_last = now;
+    if (task->dl_budget > 0) {
+        task_t* head = cpu->rq.dl_head;
+        if (head && head->dl_deadline < task->dl_deadline) {
+            cpu->need_resched = 1;
+        }
+        return;
+    }
+    class_stats[cpu->id][SCHED_DEADLINE].nr_throttled++;
+    dl_throttle(task, now);
+    cpu->need_resched = 1;
+}
+
+int sched_set_deadline(u32 runtime_us, u32 period_us) {
+    if (runtime_us == 0 || runtime_us > period_us) {
+        return -1;
+    }
+    task_t* task = current_task();
+    u32 flags = local_irq_save();
+    u64 now = clock_now();
+    timer_setup(&task->dl_timer, dl_replenish, task);
+    task->dl_runtime = runtime_us * NSEC_PER_USEC;
+    task->dl_period = period_us * NSEC_PER_USEC;
+    task->dl_deadline = now + task->dl_period;
+    task->dl_budget = (s64)task->dl_runtime;
+    task->dl_last = now;
+    task->dl_throttled = 0;
+    task->policy = SCHED_DEADLINE;
+    local_irq_restore(flags);
+    return 0;
+}
+
+void sched_wait_period(void) {
+    task_t* task = current_task();
+    if (task->policy != SCHED_DEADLINE) {
+        schedule();
+        return;
+    }
+
+    u32 flags = local_irq_save();
+    u64 now = clock_now();
+    if (now > task->dl_deadline) {
+        // 本周期的工作超过了截止期: 立即开始下个周期，不再等待
+        class_stats[this_cpu()->id][SCHED_DEADLINE].deadline_misses++;
+        dl_new_period(task, now);
+        local_irq_restore(flags);
+        return;
+    }
+    dl_throttle(task, now);
+    schedule();
+    local_irq_restore(flags);
+}
+
+// 唤醒阻塞的任务，放回它上次运行的 CPU；任务不在阻塞状态时返回 0
+int sched_wakeup(task_t* task) {
+    u32 flags = spin_lock_irqsave(&task->lock);
+    if (task->state != TASK_BLOCKED) {
+        spin_unlock_irqrestore(&task->lock, flags);
+        return 0;
+    }
+    task->state = TASK_RUNNABLE;
+    // 截止期类任务阻塞期间错过了截止期: 开始新的周期
+    if (task->policy == SCHED_DEADLINE && !task->dl_throttled) {
+        dl_wakeup(task);
+    }
+    // 还没切换走的任务由 finish_switch 入队，暂停中的任务由定时器入队
+    int queue = !task->on_cpu && !task->dl_throttled;
+    spin_unlock_irqrestore(&task->lock, flags);
+
+    if (queue) {
+        int target = task->affinity != CPU_ANY ? task->affinity : task->cpu;
+        rq_enqueue(&cpus[target], task);
+    }
+    return 1;
+}
+
+// 时钟节拍: 时间片用完或空闲时有任务等待就请求重新调度
+void sched_tick(cpu_t* cpu) {
+    task_t* task = cpu->current;
+    if (task == cpu->idle) {
+        if (cpu->rq.count > 0) {
+            cpu->need_resched = 1;
+        }
+        return;
+    }
+    if (task->policy == SCHED_DEADLINE) {
+        dl_tick(cpu, task);
+        return;
+    }
+    if (cpu->rq.dl_head) {
+        cpu->need_resched = 1; // 截止期类任务就绪
+        return;
+    }
+    if (task->slice > 0) {
+        task->slice--;
+    }
+    if (task->slice == 0 && cpu->rq.count > 0) {
+        cpu->need_resched = 1;
+    }
+}
+
+int create_process(const char* name, void (*entry)(void)) {
+    task_t* task = task_alloc(name);
+    if (!task) {
+        return -1;
+    }
+    if (task_setup_stack(task, entry) < 0) {
+        kfree(task);
+        return -1;
+    }
+
+    sched_enqueue(task);
+    return task->pid;
+}
+
+// 选择下一个任务 (调用者持有运行队列锁): 截止期最早的截止期类任务优先。
+// 仍可运行的截止期类任务只让给截止期更早的任务，此时 *keep 置 1 且返回 NULL
+static task_t* pick_next(cpu_t* cpu, task_t* prev, int* keep) {
+    run_queue_t* rq = &cpu->rq;
+    int prev_dl = prev->policy == SCHED_DEADLINE && !prev->dl_throttled &&
+                  (prev->state == TASK_RUNNING || prev->state == TASK_RUNNABLE);
+    *keep = 0;
+    if (rq->dl_head && (!prev_dl || rq->dl_head->dl_deadline < prev->dl_deadline)) {
+        return rq_take_dl(rq);
+    }
+    if (prev_dl) {
+        *keep = 1;
+        return NULL;
+    }
+    return rq_take_for(rq, cpu->id);
+}
+
+// 就绪到上 CPU 的延迟
+static void sched_account(cpu_t* cpu, task_t* next, u64 now) {
+    sched_class_stats_t* st = &class_stats[cpu->id][next->policy];
+    u64 latency = now - next->enqueue_ns;
+    st->nr_runs++;
+    st->total_latency_ns += latency;
+    if (latency > st->max_latency_ns) {
+        st->max_latency_ns = latency;
+    }
+    if (next->policy == SCHED_DEADLINE && now > next->dl_deadline) {
+        st->deadline_misses++;
+    }
+}
+
+void schedule(void) {
+    u32 flags = local_irq_save();
+    cpu_t* cpu = this_cpu();
+    task_t* prev = cpu->current;
+
+    int keep;
+    spin_lock(&cpu->rq.lock);
+    task_t* next = pick_next(cpu, prev, &keep);
+    spin_unlock(&cpu->rq.lock);
+
+    if (!next && !keep) {
+        next = steal_task(cpu);
+    }
+    if (!next) {
+        // 没有其他任务: 当前任务仍可运行 (或刚被唤醒) 就继续，否则回到空闲任务
+        spin_lock(&prev->lock);
+        int runnable = (prev->state == TASK_RUNNING || prev->state == TASK_RUNNABLE) &&
+                       !prev->dl_throttled;
+        if (runnable) {
+            prev->state = TASK_RUNNING;
+        }
+        spin_unlock(&prev->lock);
+        if (runnable || !cpu->idle || prev == cpu->idle) {
+            prev->slice = TIME_SLICE_TICKS;
+            local_irq_restore(flags);
+            return;
+        }
+        next = cpu->idle;
+    }
+
+    spin_lock(&prev->lock);
+    if (prev->state == TASK_RUNNING) {
+        prev->state = TASK_RUNNABLE;
+    }
+    spin_unlock(&prev->lock);
+    // 运行时间统计
+    u64 now = clock_now();
+    prev->runtime_ns += now - prev->exec_start;
+    next->exec_start = now;
+    if (prev->policy == SCHED_DEADLINE) {
+        prev->dl_budget -= (s64)(now - prev->dl_last);
+    }
+    next->dl_last = now;
+    if (next != cpu->idle) {
+        sched_account(cpu, next, now);
+    }
+
+    next->state = TASK_RUNNING;
+    next->on_cpu = 1;
+    next->slice = TIME_SLICE_TICKS;
+    next->cpu = cpu->id;
+    if (next->stack) {
+        gdt_set_kernel_stack(cpu->id, (u32)next->stack + TASK_STACK_SIZE);
+    }
+    vmm_switch(next->space);
+    cpu->current = next;
+    cpu->switch_prev = prev;
+    cpu->nr_switches++;
+
+    context_switch(&prev->esp, next->esp);
+
+    // 回到这里时可能已在另一个 CPU 上
+    finish_switch(this_cpu());
+    local_irq_restore(flags);
+}
+
+// 从用户态进入内核时 CPU 切换到内核栈顶，int 0x80 和 sysenter 都在栈顶构造 irq_frame_t
+irq_frame_t* task_user_frame(task_t* task) {
+    return (irq_frame_t*)((u8*)task->stack + TASK_STACK_SIZE) - 1;
+}
+
+// fork 出的子任务的第一条指令: 收尾后从复制的现场返回用户态
+void fork_child_return(void);
+__asm__ (
+    ".section .text\n"
+    ".global fork_child_return\n"
+    "fork_child_return:\n"
+    "    call fork_child_finish\n"
+    "    jmp irq_return\n"
+);
+
+void fork_child_finish(void) {
+    finish_switch(this_cpu());
+}
+
+int task_fork(void) {
+    task_t* parent = current_task();
+    if (!parent->stack) {
+        return -1; // 引导任务没有用户现场
+    }
+
+    task_t* child = task_alloc(parent->name);
+    if (!child) {
+        return -1;
+    }
+    child->ppid = parent->pid;
+    child->stack = page_alloc(TASK_STACK_ORDER);
+    if (!child->stack) {
+        task_free(child);
+        return -1;
+    }
+    child->space = vmm_fork_space(vmm_current_space());
+    if (!child->space) {
+        task_free(child);
+        return -1;
+    }
+    // 描述符表复制一份，打开的文件 (连同读写位置) 父子共享
+    if (parent->files && !(child->files = fd_table_fork(parent->files))) {
+        task_free(child);
+        return -1;
+    }
+
+    // 子任务的 fork 返回 0
+    irq_frame_t* frame = task_user_frame(child);
+    *frame = *task_user_frame(parent);
+    frame->eax = 0;
+
+    // 使 context_switch 返回到 fork_child_return，此时栈顶正好是现场
+    u32* sp = (u32*)frame;
+    *--sp = (u32)fork_child_return;
+    *--sp = 0;                  // ebp
+    *--sp = 0;                  // ebx
+    *--sp = 0;                  // esi
+    *--sp = 0;                  // edi
+    *--sp = 0x002;              // eflags
+    child->esp = (u32)sp;
+
+    ipc_fork_handles(parent, child);
+
+    u32 flags = spin_lock_irqsave(&tasks_lock);
+    child->parent = parent;
+    child->sibling = parent->children;
+    parent->children = child;
+    spin_unlock_irqrestore(&tasks_lock, flags);
+
+    int pid = child->pid; // 入队后子任务可能立即运行并退出
+    sched_enqueue(child);
+    return pid;
+}
+
+void sched_yield(void) {
+    schedule();
+}
+
+// 中断返回时的抢占: 正在登记等待 (已置为阻塞但还没调用 schedule) 的任务
+// 保持可运行，回来后由等待循环重新检查条件
+void preempt_schedule(void) {
+    task_t* task = current_task();
+    u32 flags = spin_lock_irqsave(&task->lock);
+    if (task->state == TASK_BLOCKED) {
+        task->state = TASK_RUNNING;
+    }
+    spin_unlock_irqrestore(&task->lock, flags);
+    schedule();
+}
+
+void task_exit(int code) {
+    task_t* task = current_task();
+    task->exit_code = code;
+
+    if (task->policy == SCHED_DEADLINE) {
+        timer_del(&task->dl_timer);
+    }
+
+    // 关闭 IPC 句柄，对端随即看到关闭
+    ipc_release_handles(task);
+
+    // 关闭打开的文件
+    if (task->files) {
+        fd_table_t* files = task->files;
+        task->files = NULL;
+        fd_table_destroy(files);
+    }
+
+    // 地址空间不再需要，立即释放
+    if (task->space) {
+        vm_space_t* space = task->space;
+        task->space = NULL;
+        vmm_switch(NULL);
+        vmm_destroy_space(space);
+    }
+
+    local_irq_save();
+    spin_lock(&tasks_lock);
+
+    // 子任务成为孤儿: 已退出的直接回收，其余退出后自行释放
+    task_t* orphans = NULL;
+    task_t* child = task->children;
+    while (child) {
+        task_t* next = child->sibling;
+        child->parent = NULL;
+        if (child->state == TASK_ZOMBIE) {
+            child->sibling = orphans;
+            orphans = child;
+        }
+        child = next;
+    }
+    task->children = NULL;
+
+    // 有父任务时留下退出码等待回收，唤醒必须在锁内进行 (父任务此时不会被释放)
+    if (task->parent) {
+        task->state = TASK_ZOMBIE;
+        wake_up(&task->parent->child_exit);
+    } else {
+        task->state = TASK_DEAD;
+    }
+    spin_unlock(&tasks_lock);
+
+    while (orphans) {
+        task_t* next = orphans->sibling;
+        task_reap(orphans);
+        orphans = next;
+    }
+
+    schedule();
+    for (;;) {
+        __asm__ __volatile__ ("hlt");
+    }
+}
+
+// 从父任务的子任务链表中找一个符合条件且已退出的任务并摘下
+static task_t* take_zombie(task_t* parent, int pid, int* found) {
+    task_t** link = &parent->children;
+    *found = 0;
+    while (*link) {
+        task_t* child = *link;
+        if (pid == -1 || (int)child->pid == pid) {
+            *found = 1;
+            if (child->state == TASK_ZOMBIE) {
+                *link = child->sibling;
+                child->sibling = NULL;
+                child->parent = NULL;
+                return child;
+            }
+        }
+        link = &child->sibling;
+    }
+    return NULL;
+}
+
+int task_wait(int pid, int* status) {
+    task_t* task = current_task();
+    task_t* zombie = NULL;
+    int found = 0;
+    wait_entry_t wait;
+    wait.queued = 0;
+
+    for (;;) {
+        prepare_to_wait(&task->child_exit, &wait);
+        u32 flags = spin_lock_irqsave(&tasks_lock);
+        zombie = take_zombie(task, pid, &found);
+        spin_unlock_irqrestore(&tasks_lock, flags);
+        if (zombie || !found) {
+            break;
+        }
+        schedule();
+    }
+    finish_wait(&task->child_exit, &wait);
+
+    if (!zombie) {
+        return -1;
+    }
+    int zombie_pid = zombie->pid;
+    if (status) {
+        *status = zombie->exit_code;
+    }
+    task_reap(zombie);
+    return zombie_pid;
+}
+
+// 空闲循环: 没有可运行任务时停止节拍并 hlt，直到中断或 IPI 唤醒
+void cpu_idle(void) {
+    cpu_t* cpu = this_cpu();
+    for (;;) {
+        softirq_run();
+        schedule();
+
+        local_irq_disable();
+        cpu->halted = 1;
+        __sync_synchronize();
+        cpu_t* victim = steal_victim(cpu);
+        if (cpu->rq.count == 0 && !victim) {
+            timer_idle_enter();
+            __asm__ __volatile__ ("sti; hlt; cli");
+            timer_idle_exit();
+        }
+        cpu->halted = 0;
+        local_irq_enable();
+    }
+}
+
+// 调度类统计
+void sched_get_class_stats(int policy, sched_class_stats_t* stats) {
+    memset(stats, 0, sizeof(sched_class_stats_t));
+    if (policy < 0 || policy >= SCHED_NR_CLASSES) {
+        return;
+    }
+    for (u32 i = 0; i < cpu_count; i++) {
+        sched_class_stats_t* st = &class_stats[i][policy];
+        stats->nr_runs += st->nr_runs;
+        stats->total_latency_ns += st->total_latency_ns;
+        if (st->max_latency_ns > stats->max_latency_ns) {
+            stats->max_latency_ns = st->max_latency_ns;
+        }
+        stats->deadline_misses += st->deadline_misses;
+        stats->nr_throttled += st->nr_throttled;
+    }
+}
+
+void sched_dump_stats(void) {
+    static const char* class_names[SCHED_NR_CLASSES] = { "normal", "deadline" };
+    char line[128];
+    serial_puts("sched: 调度类     运行次数   平均延迟us 最大延迟us 错过截止期 预算耗尽\n");
+    for (int policy = 0; policy < SCHED_NR_CLASSES; policy++) {
+        sched_class_stats_t st;
+        sched_get_class_stats(policy, &st);
+        u64 avg = st.nr_runs ? div_u64_rem(st.total_latency_ns, st.nr_runs, NULL) : 0;
+        snprintf(line, sizeof(line), "sched: %-10s %10u %10u %10u %10u %8u\n",
+                 class_names[policy], st.nr_runs,
+                 (u32)div_u64_rem(avg, NSEC_PER_USEC, NULL),
+                 (u32)div_u64_rem(st.max_latency_ns, NSEC_PER_USEC, NULL),
+                 st.deadline_misses, st.nr_throttled);
+        serial_puts(line);
+    }
+}
+
+static void sched_command(char key) {
+    (void)key;
+    sched_dump_stats();
+}
+
+void sched_debug_init(void) {
+    serial_register_command('s', sched_command);
+}
@@ -0,0 +1,123 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "kernel.h"
+#include "spinlock.h"
+#include "wait.h"
+#include "ipc.h"
+#include "timer.h"
+
+struct vm_space;
+struct fd_table;
+struct cpu;
+struct irq_frame;
+
+// 任务状态
+#define TASK_RUNNABLE   0
+#define TASK_RUNNING    1
+#define TASK_BLOCKED    2
+#define TASK_ZOMBIE     3       // 已退出，等待父任务回收
+#define TASK_DEAD       4       // 已退出，切换走之后释放
+
+// 调度类
+#define SCHED_NORMAL        0   // 时间片轮转
+#define SCHED_DEADLINE      1   // 最早截止期优先 (EDF)，每周期补充固定预算
+#define SCHED_NR_CLASSES    2
+
+// 不绑定 CPU
+#define CPU_ANY         (-1)
+
+// 内核栈大小 (2^2 页 = 16KB)
+#define TASK_STACK_ORDER 2
+#define TASK_STACK_SIZE  (4096 << TASK_STACK_ORDER)
+
+// 任务结构
+typedef struct task {
+    u32 esp;                    // 切换时保存的内核栈指针 (必须为第一个字段)
+    u32 pid;
+    u32 ppid;                   // 父任务 (fork 创建时有效)
+    struct task* parent;        // 会回收本任务的父任务 (NULL 表示退出后直接释放)
+    struct task* children;      // 子任务链表 (受 tasks_lock 保护)
+    struct task* sibling;
+    int exit_code;
+    wait_queue_t child_exit;    // 子任务退出时唤醒
+    char name[32];
+    spinlock_t lock;            // 保护 state 与 on_cpu
+    volatile u32 state;
+    volatile int on_cpu;        // 仍在某个 CPU 上运行 (尚未完成切换)
+    int cpu;                    // 最近运行的 CPU
+    u32 slice;                  // 剩余时间片 (节拍)
+    u64 exec_start;             // 本次上 CPU 的时刻 (ns)
+    u64 runtime_ns;             // 累计运行时间
+    int affinity;               // 绑定的 CPU，CPU_ANY 表示可迁移
+    void* stack;                // 内核栈 (NULL 表示引导栈)
+    struct vm_space* space;     // 地址空间 (NULL 表示内核线程)
+    struct ipc_end* handles[IPC_MAX_HANDLES]; // IPC 通道句柄
+    struct fd_table* files;     // 文件描述符表 (第一次打开文件时建立)
+    void (*entry)(void);
+    struct task* next;          // 运行队列链接
+    u64 enqueue_ns;             // 进入运行队列的时刻 (调度延迟统计)
+
+    // 截止期调度
+    int policy;                 // SCHED_*
+    u64 dl_runtime;             // 每周期预算 (ns)
+    u64 dl_period;              // 周期，同时是相对截止期 (ns)
+    u64 dl_deadline;            // 本周期的绝对截止期
+    s64 dl_budget;              // 本周期剩余预算
+    u64 dl_last;                // 上次扣除预算的时刻
+    int dl_throttled;           // 等待下个周期 (受 lock 保护)
+    ktimer_t dl_timer;          // 下个周期开始时补充预算
+} task_t;
+
+// 每个 CPU 的运行队列
+typedef struct {
+    spinlock_t lock;
+    task_t* head;
+    task_t* tail;
+    volatile u32 count;
+    volatile u32 migratable;    // 可被其他 CPU 窃取的任务数
+    task_t* dl_head;            // 截止期类任务，按截止期排序 (不参与窃取)
+} run_queue_t;
+
+// 每个调度类的统计
+typedef struct {
+    u32 nr_runs;                // 从就绪到上 CPU 的次数
+    u64 total_latency_ns;       // 就绪到上 CPU 的累计等待
+    u64 max_latency_ns;
+    u32 deadline_misses;        // 截止期类: 过了截止期才上 CPU 或才完成本周期工作
+    u32 nr_throttled;           // 截止期类: 预算用完被暂停的次数
+} sched_class_stats_t;
+
+// 调度器
+void sched_init(void);
+void sched_init_cpu(struct cpu* cpu);
+task_t* current_task(void);
+void sched_enqueue(task_t* task);
+int sched_wakeup(task_t* task);
+void sched_tick(struct cpu* cpu);
+void sched_yield(void);
+void preempt_schedule(void);
+
+// 把当前任务改为截止期类: 每 period_us 微秒保证 runtime_us 微秒的 CPU 时间
+int sched_set_deadline(u32 runtime_us, u32 period_us);
+
+// 截止期类任务完成本周期的工作，睡眠到下个周期开始
+void sched_wait_period(void);
+
+// 调度类统计 (所有 CPU 之和)
+void sched_get_class_stats(int policy, sched_class_stats_t* stats);
+void sched_dump_stats(void);            // 输出到串口
+void sched_debug_init(void);            // 注册串口命令 s
+void task_exit(int code);
+
+// 等待子任务退出并回收 (pid 为 -1 表示任意子任务)，返回其 pid，没有这样的子任务返回 -1
+int task_wait(int pid, int* status);
+
+// 任务从用户态进入内核时保存的现场 (位于内核栈顶)
+struct irq_frame* task_user_frame(task_t* task);
+
+// 复制当前任务 (由 SYS_FORK 调用): 地址空间写时复制，子任务从同一用户现场返回 0
+int task_fork(void);
+void cpu_idle(void);
+
+#endif // SCHED_H
@@ -0,0 +1,120 @@
+#include "serial.h"
+#include "io.h"
+#include "spinlock.h"
+#include "irq.h"
+
+// 16550 UART 寄存器
+#define UART_DATA       0
+#define UART_IER        1
+#define UART_FCR        2
+#define UART_LCR        3
+#define UART_MCR        4
+#define UART_LSR        5
+
+#define UART_LSR_DR     0x01    // 接收数据就绪
+#define UART_LSR_THRE   0x20    // 发送保持寄存器空
+#define UART_IER_RX     0x01    // 接收数据中断
+#define UART_MCR_OUT2   0x08    // 允许 UART 中断送到 8259
+
+// 中断与 tasklet 之间的接收环 (单生产者单消费者)
+#define SERIAL_RX_SIZE  64
+
+static int serial_ready = 0;
+static int serial_rx_ready = 0;
+static spinlock_t serial_lock = SPINLOCK_INIT;
+
+static volatile u32 rx_head = 0;
+static volatile u32 rx_tail = 0;
+static char rx_ring[SERIAL_RX_SIZE];
+static tasklet_t rx_tasklet;
+static void (*commands[128])(char key);
+
+void serial_init(void) {
+    if (serial_ready) {
+        return;
+    }
+    outb(SERIAL_COM1 + UART_IER, 0x00);    // 关闭 UART 中断
+    outb(SERIAL_COM1 + UART_LCR, 0x80);    // 设置波特率除数
+    outb(SERIAL_COM1 + UART_DATA, 0x01);   // 115200
+    outb(SERIAL_COM1 + UART_IER, 0x00);
+    outb(SERIAL_COM1 + UART_LCR, 0x03);    // 8N1
+    outb(SERIAL_COM1 + UART_FCR, 0xC7);    // 打开并清空 FIFO
+    outb(SERIAL_COM1 + UART_MCR, 0x03);    // DTR | RTS
+    serial_ready = 1;
+}
+
+static void serial_putc_locked(char c) {
+    while (!(inb(SERIAL_COM1 + UART_LSR) & UART_LSR_THRE)) {
+        cpu_relax();
+    }
+    outb(SERIAL_COM1 + UART_DATA, c);
+}
+
+void serial_putc(char c) {
+    u32 flags = spin_lock_irqsave(&serial_lock);
+    if (c == '\n') {
+        serial_putc_locked('\r');
+    }
+    serial_putc_locked(c);
+    spin_unlock_irqrestore(&serial_lock, flags);
+}
+
+void serial_write(const char* buf, u32 len) {
+    u32 flags = spin_lock_irqsave(&serial_lock);
+    for (u32 i = 0; i < len; i++) {
+        if (buf[i] == '\n') {
+            serial_putc_locked('\r');
+        }
+        serial_putc_locked(buf[i]);
+    }
+    spin_unlock_irqrestore(&serial_lock, flags);
+}
+
+void serial_puts(const char* str) {
+    u32 len = 0;
+    while (str[len]) {
+        len++;
+    }
+    serial_write(str, len);
+}
+
+// 接收中断: 读空 FIFO，字符交给 tasklet 处理
+static void serial_interrupt(irq_frame_t* frame) {
+    (void)frame;
+    while (inb(SERIAL_COM1 + UART_LSR) & UART_LSR_DR) {
+        char c = inb(SERIAL_COM1 + UART_DATA);
+        if (rx_head - rx_tail < SERIAL_RX_SIZE) {
+            rx_ring[rx_head % SERIAL_RX_SIZE] = c;
+            rx_head++;
+        }
+    }
+    tasklet_schedule(&rx_tasklet);
+}
+
+static void serial_rx_process(void* data) {
+    (void)data;
+    while (rx_tail != rx_head) {
+        char c = rx_ring[rx_tail % SERIAL_RX_SIZE];
+        rx_tail++;
+        if (c > 0 && commands[(int)c]) {
+            commands[(int)c](c);
+        }
+    }
+}
+
+void serial_register_command(char key, void (*handler)(char key)) {
+    serial_init();
+    if (key > 0) {
+        commands[(int)key] = handler;
+    }
+    if (serial_rx_ready) {
+        return;
+    }
+    serial_rx_ready = 1;
+
+    tasklet_init(&rx_tasklet, serial_rx_process, NULL);
+    irq_register(IRQ_BASE + IRQ_COM1, serial_interrupt);
+    outb(SERIAL_COM1 + UART_MCR, 0x03 | UART_MCR_OUT2);
+    outb(SERIAL_COM1 + UART_IER, UART_IER_RX);
+    irq_unmask(IRQ_COM1);
+}
@@ -0,0 +1,17 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "kernel.h"
+
+// COM1 串口 (轮询方式输出，中断方式接收)
+#define SERIAL_COM1     0x3F8
+
+void serial_init(void);
+void serial_putc(char c);
+void serial_write(const char* buf, u32 len);
+void serial_puts(const char* str);
+
+// 单字符调试命令: 收到 key 时在 tasklet 中调用 handler，需在中断初始化之后注册
+void serial_register_command(char key, void (*handler)(char key));
+
+#endif // SERIAL_H
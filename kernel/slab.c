@@ -0,0 +1,289 @@
+#include "mm.h"
+#include "serial.h"
+#include <string.h>
+#include <stdio.h>
+
+// 尺寸等级: 16, 32, 64 ... 2048 字节
+#define SLAB_MIN_SHIFT   4
+#define SLAB_MAX_SHIFT   11
+#define SLAB_NR_CLASSES  (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+#define SLAB_MAX_SIZE    (1 << SLAB_MAX_SHIFT)
+
+// 每个等级最多缓存的空 slab 数，避免分配/释放交替时反复申请页
+#define SLAB_KEEP_EMPTY  1
+
+static kmem_cache_t caches[KMEM_NR_TAGS][SLAB_NR_CLASSES];
+static kmem_stats_t stats[KMEM_NR_TAGS];
+
+static const char* tag_names[KMEM_NR_TAGS] = {
+    "kernel", "fs", "gui", "apps"
+};
+
+// 统计更新 (各尺寸等级的缓存锁互不相同，所以用原子操作)
+static void stats_alloc(kmem_stats_t* st, u32 requested, u32 bytes) {
+    u32 live = __sync_add_and_fetch(&st->live_bytes, bytes);
+    u32 peak;
+    while (live > (peak = st->peak_bytes) &&
+           !__sync_bool_compare_and_swap(&st->peak_bytes, peak, live)) {
+    }
+    __sync_fetch_and_add(&st->live_objects, 1);
+    __sync_fetch_and_add(&st->nr_allocs, 1);
+    __sync_fetch_and_add(&st->requested, requested);
+    __sync_fetch_and_add(&st->allocated, bytes);
+}
+
+static void stats_free(kmem_stats_t* st, u32 bytes) {
+    __sync_fetch_and_sub(&st->live_bytes, bytes);
+    __sync_fetch_and_sub(&st->live_objects, 1);
+    __sync_fetch_and_add(&st->nr_frees, 1);
+}
+
+// 尺寸到等级的映射 (O(1))
+static inline u32 size_to_class(size_t size) {
+    if (size <= (1 << SLAB_MIN_SHIFT)) {
+        return 0;
+    }
+    return 32 - __builtin_clz(size - 1) - SLAB_MIN_SHIFT;
+}
+
+// 满足 size 字节所需的最小页阶数
+u32 size_to_order(size_t size) {
+    u32 pages = (size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    if (pages <= 1) {
+        return 0;
+    }
+    return 32 - __builtin_clz(pages - 1);
+}
+
+static void partial_remove(kmem_cache_t* cache, page_t* page) {
+    if (page->prev) {
+        page->prev->next = page->next;
+    } else {
+        cache->partial = page->next;
+    }
+    if (page->next) {
+        page->next->prev = page->prev;
+    }
+    page->next = NULL;
+    page->prev = NULL;
+}
+
+static void partial_push(kmem_cache_t* cache, page_t* page) {
+    page->prev = NULL;
+    page->next = cache->partial;
+    if (cache->partial) {
+        cache->partial->prev = page;
+    }
+    cache->partial = page;
+}
+
+// 为缓存申请一个新 slab 并切分为空闲对象链表
+static page_t* slab_grow(kmem_cache_t* cache) {
+    u8* base = page_alloc(0);
+    if (!base) {
+        return NULL;
+    }
+
+    page_t* page = virt_to_page(base);
+    page->flags = PG_SLAB;
+    page->cache = cache;
+    page->inuse = 0;
+    page->freelist = NULL;
+    for (int i = cache->objs_per_slab - 1; i >= 0; i--) {
+        void** obj = (void**)(base + i * cache->size);
+        *obj = page->freelist;
+        page->freelist = obj;
+    }
+
+    cache->nr_slabs++;
+    cache->nr_empty++;
+    __sync_fetch_and_add(&stats[cache->tag].held_bytes, PAGE_SIZE);
+    partial_push(cache, page);
+    return page;
+}
+
+void slab_init(void) {
+    for (int tag = 0; tag < KMEM_NR_TAGS; tag++) {
+        for (int i = 0; i < SLAB_NR_CLASSES; i++) {
+            kmem_cache_t* cache = &caches[tag][i];
+            cache->lock = (spinlock_t)SPINLOCK_INIT;
+            cache->tag = tag;
+            cache->size = 1u << (i + SLAB_MIN_SHIFT);
+            cache->objs_per_slab = PAGE_SIZE / cache->size;
+            cache->partial = NULL;
+            cache->nr_slabs = 0;
+            cache->nr_empty = 0;
+        }
+    }
+    memset(stats, 0, sizeof(stats));
+    printf("slab 分配器: %d 个尺寸等级 (%d - %d 字节), %d 个分配标签\n",
+           SLAB_NR_CLASSES, 1 << SLAB_MIN_SHIFT, SLAB_MAX_SIZE, KMEM_NR_TAGS);
+}
+
+void mm_init(void) {
+    page_init();
+    slab_init();
+}
+
+void* kmalloc(size_t size) {
+    return kmalloc_tagged(size, KMEM_KERNEL);
+}
+
+void* kmalloc_tagged(size_t size, int tag) {
+    if (size == 0) {
+        return NULL;
+    }
+    if (tag < 0 || tag >= KMEM_NR_TAGS) {
+        tag = KMEM_KERNEL;
+    }
+    kmem_stats_t* st = &stats[tag];
+
+    // 大对象直接按页分配
+    if (size > SLAB_MAX_SIZE) {
+        u32 order = size_to_order(size);
+        void* ptr = page_alloc(order);
+        if (!ptr) {
+            __sync_fetch_and_add(&st->nr_failed, 1);
+            return NULL;
+        }
+        page_t* page = virt_to_page(ptr);
+        page->flags = PG_LARGE;
+        page->order = order;
+        page->inuse = tag;
+        __sync_fetch_and_add(&st->held_bytes, PAGE_SIZE << order);
+        stats_alloc(st, size, PAGE_SIZE << order);
+        return ptr;
+    }
+
+    kmem_cache_t* cache = &caches[tag][size_to_class(size)];
+    u32 flags = spin_lock_irqsave(&cache->lock);
+    page_t* page = cache->partial;
+    if (!page) {
+        page = slab_grow(cache);
+        if (!page) {
+            spin_unlock_irqrestore(&cache->lock, flags);
+            __sync_fetch_and_add(&st->nr_failed, 1);
+            return NULL; // 内存不足
+        }
+    }
+
+    void** obj = page->freelist;
+    page->freelist = *obj;
+    if (page->inuse++ == 0) {
+        cache->nr_empty--;
+    }
+    if (!page->freelist) {
+        partial_remove(cache, page); // slab 已满
+    }
+    spin_unlock_irqrestore(&cache->lock, flags);
+    stats_alloc(st, size, cache->size);
+    return obj;
+}
+
+void kfree(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    page_t* page = virt_to_page(ptr);
+    if (!page) {
+        printf("kfree: 非法指针 %p\n", ptr);
+        return;
+    }
+
+    if (page->flags & PG_LARGE) {
+        kmem_stats_t* st = &stats[page->inuse < KMEM_NR_TAGS ? page->inuse : KMEM_KERNEL];
+        u32 bytes = PAGE_SIZE << page->order;
+        stats_free(st, bytes);
+        __sync_fetch_and_sub(&st->held_bytes, bytes);
+        page->flags = 0;
+        page_free(ptr, page->order);
+        return;
+    }
+
+    if (!(page->flags & PG_SLAB)) {
+        printf("kfree: 重复释放或非法指针 %p\n", ptr);
+        return;
+    }
+
+    kmem_cache_t* cache = page->cache;
+    stats_free(&stats[cache->tag], cache->size);
+    u32 flags = spin_lock_irqsave(&cache->lock);
+    if (!page->freelist) {
+        partial_push(cache, page); // 由满变为部分空闲
+    }
+
+    void** obj = ptr;
+    *obj = page->freelist;
+    page->freelist = obj;
+
+    if (--page->inuse == 0) {
+        // 保留少量空 slab，多余的归还页分配器
+        if (cache->nr_empty >= SLAB_KEEP_EMPTY) {
+            partial_remove(cache, page);
+            cache->nr_slabs--;
+            __sync_fetch_and_sub(&stats[cache->tag].held_bytes, PAGE_SIZE);
+            page->flags = 0;
+            page_free(page_to_virt(page), 0);
+        } else {
+            cache->nr_empty++;
+        }
+    }
+    spin_unlock_irqrestore(&cache->lock, flags);
+}
+
+// 内存统计
+int kmem_get_stats(int tag, kmem_stats_t* out) {
+    if (tag < 0 || tag >= KMEM_NR_TAGS || !out) {
+        return -1;
+    }
+    *out = stats[tag];
+    return 0;
+}
+
+const char* kmem_tag_name(int tag) {
+    if (tag < 0 || tag >= KMEM_NR_TAGS) {
+        return "?";
+    }
+    return tag_names[tag];
+}
+
+// 千分比 (分母为 0 时为 0)
+static u32 permille(u32 part, u32 whole) {
+    if (part > whole) {
+        part = whole; // 统计读取不是原子快照，可能短暂不一致
+    }
+    while (whole > 0x3FFFFF) {
+        part >>= 1;   // 保证 part * 1000 不溢出
+        whole >>= 1;
+    }
+    return whole ? part * 1000 / whole : 0;
+}
+
+void kmem_dump(void) {
+    char line[160];
+    serial_puts("kmem:  标签      当前KB    峰值KB    占用KB    对象数    分配/释放        外部碎片 内部碎片 失败\n");
+    for (int tag = 0; tag < KMEM_NR_TAGS; tag++) {
+        kmem_stats_t st = stats[tag];
+        // 外部碎片: 已占用的页中没有分配出去的部分；内部碎片: 尺寸取整浪费的部分
+        u32 external = permille(st.held_bytes - st.live_bytes, st.held_bytes);
+        u32 internal = permille(st.allocated - st.requested, st.allocated);
+        snprintf(line, sizeof(line),
+                 "kmem:  %-8s %8u  %8u  %8u  %8u  %8u/%-8u  %3u.%u%%   %3u.%u%%   %u\n",
+                 tag_names[tag], st.live_bytes / 1024, st.peak_bytes / 1024,
+                 st.held_bytes / 1024, st.live_objects, st.nr_allocs, st.nr_frees,
+                 external / 10, external % 10, internal / 10, internal % 10, st.nr_failed);
+        serial_puts(line);
+    }
+    snprintf(line, sizeof(line), "kmem:  物理页 %u / %u 空闲\n", page_free_count(), page_total_count());
+    serial_puts(line);
+}
+
+static void kmem_command(char key) {
+    (void)key;
+    kmem_dump();
+}
+
+void kmem_debug_init(void) {
+    serial_register_command('m', kmem_command);
+}
@@ -0,0 +1,183 @@
+#include "smp.h"
+#include "apic.h"
+#include "vmm.h"
+#include "timer.h"
+#include "gdt.h"
+#include "syscall.h"
+#include "io.h"
+#include <string.h>
+#include <stdio.h>
+
+// 多处理器启动: 通过 INIT-SIPI-SIPI 唤醒所有 AP
+
+cpu_t cpus[MAX_CPUS];
+volatile u32 cpu_count = 1;
+
+// APIC ID 到逻辑 CPU 编号的映射
+static u8 apic_to_cpu[256];
+
+// AP 栈区 (每个 AP 一个内核栈)
+#define AP_STACK_SIZE  TASK_STACK_SIZE
+
+// AP 启动代码: 实模式 -> 保护模式 -> 分页，然后跳到 ap_main
+// 代码被复制到 AP_TRAMPOLINE_ADDR 执行，所有绝对地址都需要换算。
+#define AP_ADDR(sym) "(" #sym " - ap_trampoline_start + 0x8000)"
+#define AP_STR(x)    AP_STR2(x)
+#define AP_STR2(x)   #x
+
+extern u8 ap_trampoline_start[];
+extern u8 ap_trampoline_end[];
+extern u8 ap_tramp_cr3[];
+extern u8 ap_tramp_cr4[];
+extern u8 ap_tramp_stack_base[];
+extern u8 ap_tramp_entry[];
+
+__asm__ (
+    ".section .text\n"
+    ".code16\n"
+    ".global ap_trampoline_start\n"
+    "ap_trampoline_start:\n"
+    "    cli\n"
+    "    xorw %ax, %ax\n"
+    "    movw %ax, %ds\n"
+    "    lgdtl " AP_ADDR(ap_tramp_gdt_ptr) "\n"
+    "    movl %cr0, %eax\n"
+    "    orl $1, %eax\n"
+    "    movl %eax, %cr0\n"
+    "    ljmpl $0x08, $" AP_ADDR(ap_tramp_pm) "\n"
+    ".code32\n"
+    "ap_tramp_pm:\n"
+    "    movw $0x10, %ax\n"
+    "    movw %ax, %ds\n"
+    "    movw %ax, %es\n"
+    "    movw %ax, %fs\n"
+    "    movw %ax, %gs\n"
+    "    movw %ax, %ss\n"
+    // 与 BSP 使用同一个内核页目录
+    "    movl " AP_ADDR(ap_tramp_cr3) ", %eax\n"
+    "    movl %eax, %cr3\n"
+    // 与 BSP 相同的 CR4 (全局页、4MB 大页)
+    "    movl " AP_ADDR(ap_tramp_cr4) ", %eax\n"
+    "    movl %eax, %cr4\n"
+    "    movl %cr0, %eax\n"
+    "    orl $0x80010000, %eax\n"
+    "    movl %eax, %cr0\n"
+    // 原子地领取一个栈
+    "    movl $1, %eax\n"
+    "    lock xaddl %eax, " AP_ADDR(ap_tramp_next) "\n"
+    "    incl %eax\n"
+    "    imull $" AP_STR(AP_STACK_SIZE) ", %eax\n"
+    "    addl " AP_ADDR(ap_tramp_stack_base) ", %eax\n"
+    "    movl %eax, %esp\n"
+    "    movl " AP_ADDR(ap_tramp_entry) ", %eax\n"
+    "    call *%eax\n"
+    "1:  hlt\n"
+    "    jmp 1b\n"
+    ".align 8\n"
+    "ap_tramp_gdt:\n"
+    "    .quad 0\n"
+    "    .quad 0x00CF9A000000FFFF\n"    // 内核代码段 0x08
+    "    .quad 0x00CF92000000FFFF\n"    // 内核数据段 0x10
+    "ap_tramp_gdt_ptr:\n"
+    "    .word 23\n"
+    "    .long " AP_ADDR(ap_tramp_gdt) "\n"
+    ".global ap_tramp_cr3\n"
+    "ap_tramp_cr3:        .long 0\n"
+    ".global ap_tramp_cr4\n"
+    "ap_tramp_cr4:        .long 0\n"
+    ".global ap_tramp_stack_base\n"
+    "ap_tramp_stack_base: .long 0\n"
+    ".global ap_tramp_entry\n"
+    "ap_tramp_entry:      .long 0\n"
+    "ap_tramp_next:       .long 0\n"
+    ".global ap_trampoline_end\n"
+    "ap_trampoline_end:\n"
+);
+
+static inline u32 read_cr4(void) {
+    u32 value;
+    __asm__ __volatile__ ("movl %%cr4, %0" : "=r"(value));
+    return value;
+}
+
+cpu_t* this_cpu(void) {
+    return &cpus[apic_to_cpu[lapic_id()]];
+}
+
+static void cpu_setup(cpu_t* cpu, u32 id) {
+    memset(cpu, 0, sizeof(cpu_t));
+    cpu->id = id;
+    cpu->apic_id = lapic_id();
+    cpu->rq.lock = (spinlock_t)SPINLOCK_INIT;
+    apic_to_cpu[cpu->apic_id] = id;
+    gdt_init_cpu(cpu);
+}
+
+// AP 的 C 入口
+static void ap_main(void) {
+    u32 id = __sync_fetch_and_add(&cpu_count, 1);
+    if (id >= MAX_CPUS) {
+        __sync_fetch_and_sub(&cpu_count, 1);
+        for (;;) {
+            __asm__ __volatile__ ("cli; hlt");
+        }
+    }
+
+    idt_load();
+    lapic_init_ap();
+
+    cpu_t* cpu = &cpus[id];
+    cpu_setup(cpu, id);
+    sched_init_cpu(cpu);
+    syscall_init_cpu();
+    cpu->online = 1;
+
+    cpu_idle();
+}
+
+void smp_init(void) {
+    memset(apic_to_cpu, 0, sizeof(apic_to_cpu));
+
+    // 引导 CPU 的当前上下文成为第一个任务
+    int has_apic = lapic_init() == 0;
+    cpu_setup(&cpus[0], 0);
+    sched_init();
+    cpus[0].online = 1;
+
+    if (!has_apic) {
+        printf("未检测到 APIC，以单处理器模式运行\n");
+        return;
+    }
+
+    // 每个 AP 一个栈，连续分配
+    void* stacks = page_alloc(size_to_order(MAX_CPUS * AP_STACK_SIZE));
+    if (!stacks) {
+        printf("无法分配 AP 栈\n");
+        return;
+    }
+
+    // 复制启动代码并填写参数
+    u8* tramp = (u8*)AP_TRAMPOLINE_ADDR;
+    memcpy(tramp, ap_trampoline_start, ap_trampoline_end - ap_trampoline_start);
+    *(u32*)(tramp + (ap_tramp_cr3 - ap_trampoline_start)) = (u32)vmm_kernel_space()->page_dir;
+    *(u32*)(tramp + (ap_tramp_cr4 - ap_trampoline_start)) = read_cr4();
+    *(u32*)(tramp + (ap_tramp_stack_base - ap_trampoline_start)) = (u32)stacks;
+    *(u32*)(tramp + (ap_tramp_entry - ap_trampoline_start)) = (u32)ap_main;
+
+    // 广播 INIT，然后两次 STARTUP
+    lapic_wait_icr();
+    lapic_write(LAPIC_ICR_HIGH, 0);
+    lapic_write(LAPIC_ICR_LOW, ICR_ALL_EXCLUDING_SELF | ICR_LEVEL_ASSERT | ICR_INIT);
+    pit_wait_us(10000);
+    for (int i = 0; i < 2; i++) {
+        lapic_wait_icr();
+        lapic_write(LAPIC_ICR_LOW, ICR_ALL_EXCLUDING_SELF | ICR_STARTUP |
+                    (AP_TRAMPOLINE_ADDR >> 12));
+        pit_wait_us(200);
+    }
+
+    // 等待 AP 报到
+    pit_wait_us(100000);
+
+    printf("多处理器: %u 个 CPU 在线\n", cpu_count);
+}
@@ -0,0 +1,43 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include "kernel.h"
+#include "sched.h"
+#include "irq.h"
+
+// 最多支持的 CPU 数
+#define MAX_CPUS            16
+
+// AP 启动代码的物理地址 (必须低于 1MB 且 4KB 对齐)
+#define AP_TRAMPOLINE_ADDR  0x8000
+
+// 每个 CPU 的数据
+typedef struct cpu {
+    u32 id;                     // 逻辑 CPU 编号
+    u32 apic_id;                // 本地 APIC ID
+    volatile int online;
+    task_t* current;            // 正在运行的任务
+    task_t* idle;               // 空闲任务 (不进入运行队列)
+    task_t* switch_prev;        // 刚被切换出去的任务，由新任务收尾
+    struct vm_space* space;     // 已加载的地址空间 (NULL 表示内核地址空间)
+    run_queue_t rq;
+    volatile int halted;        // 正在 hlt 中等待唤醒
+    volatile int tickless;      // 空闲期间已停止周期节拍
+    volatile int need_resched;  // 中断返回前需要重新调度
+    u32 irq_depth;              // 中断嵌套深度
+    int in_softirq;
+    volatile u32 softirq_pending;
+    tasklet_t* tasklet_head;    // 待执行的 tasklet
+    tasklet_t* tasklet_tail;
+    u32 nr_switches;
+    u32 nr_steals;
+} cpu_t;
+
+extern cpu_t cpus[MAX_CPUS];
+extern volatile u32 cpu_count;
+
+// 多处理器初始化
+void smp_init(void);
+cpu_t* this_cpu(void);
+
+#endif // SMP_H
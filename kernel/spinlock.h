@@ -0,0 +1,65 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include "kernel.h"
+
+// 自旋锁
+typedef struct {
+    volatile u32 locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0 }
+
+static inline void cpu_relax(void) {
+    __asm__ __volatile__ ("pause" : : : "memory");
+}
+
+static inline void spin_lock(spinlock_t* lock) {
+    while (__sync_lock_test_and_set(&lock->locked, 1)) {
+        while (lock->locked) {
+            cpu_relax();
+        }
+    }
+}
+
+static inline int spin_trylock(spinlock_t* lock) {
+    return !__sync_lock_test_and_set(&lock->locked, 1);
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    __sync_lock_release(&lock->locked);
+}
+
+// 本地中断开关
+static inline u32 local_irq_save(void) {
+    u32 flags;
+    __asm__ __volatile__ ("pushfl\n popl %0\n cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void local_irq_restore(u32 flags) {
+    if (flags & 0x200) {
+        __asm__ __volatile__ ("sti" : : : "memory");
+    }
+}
+
+static inline void local_irq_enable(void) {
+    __asm__ __volatile__ ("sti" : : : "memory");
+}
+
+static inline void local_irq_disable(void) {
+    __asm__ __volatile__ ("cli" : : : "memory");
+}
+
+static inline u32 spin_lock_irqsave(spinlock_t* lock) {
+    u32 flags = local_irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, u32 flags) {
+    spin_unlock(lock);
+    local_irq_restore(flags);
+}
+
+#endif // SPINLOCK_H
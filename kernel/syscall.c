@@ -0,0 +1,521 @@
+#include "syscall.h"
+#include "gdt.h"
+#include "smp.h"
+#include "vmm.h"
+#include "io.h"
+#include "clock.h"
+#include "exec.h"
+#include "futex.h"
+#include "ioring.h"
+#include "ipc.h"
+#include "../fs/fs.h"
+#include <string.h>
+#include <stdio.h>
+
+// 系统调用: sysenter/sysexit 快速入口，int 0x80 兜底，两者共用一张分发表
+
+#define SYSCALL_STR(x)      SYSCALL_STR2(x)
+#define SYSCALL_STR2(x)     #x
+
+#define SYSCALL_ERROR       ((u32)-1)
+
+static int has_sysenter = 0;
+
+// sysenter 入口: 从 TSS.esp0 取内核栈，构造与 int 0x80 相同的现场
+void sysenter_entry(void);
+__asm__ (
+    ".section .text\n"
+    ".global sysenter_entry\n"
+    "sysenter_entry:\n"
+    "    movl (%esp), %esp\n"
+    "    pushl $" SYSCALL_STR(USER_DS) "\n"
+    "    pushl %ecx\n"                      // 用户栈
+    "    pushfl\n"
+    "    orl $0x200, (%esp)\n"              // 用户态总是开中断
+    "    pushl $" SYSCALL_STR(USER_CS) "\n"
+    "    pushl %edx\n"                      // 返回地址
+    "    pushl $0\n"
+    "    pushl $" SYSCALL_STR(SYSCALL_VECTOR) "\n"
+    "    pushal\n"
+    "    cld\n"
+    "    sti\n"
+    "    pushl %esp\n"
+    "    call syscall_sysenter\n"
+    "    addl $4, %esp\n"
+    "    cli\n"
+    "    popal\n"
+    "    addl $8, %esp\n"
+    "    popl %edx\n"
+    "    addl $4, %esp\n"
+    "    andl $~0x200, (%esp)\n"
+    "    popfl\n"
+    "    popl %ecx\n"
+    "    sti\n"                             // sti 的中断延迟覆盖 sysexit
+    "    sysexit\n"
+);
+
+// 用户指针检查: 除了地址范围，还要求落在 VMA 内，否则内核访问时的页错误会终止任务
+static int user_bounds_ok(u32 addr, u32 size) {
+    return addr >= USER_BASE && addr <= USER_TOP && size <= USER_TOP - addr;
+}
+
+int user_range_ok(u32 addr, u32 size) {
+    return user_bounds_ok(addr, size) && vmm_user_access_ok(addr, size, 0);
+}
+
+int user_copy_string(char* dst, u32 src, u32 max) {
+    for (u32 i = 0; i < max; i++) {
+        // VMA 按页划分，每进入一页检查一次
+        if ((i == 0 || ((src + i) & ~PAGE_MASK) == 0) && !user_range_ok(src + i, 1)) {
+            return -1;
+        }
+        dst[i] = *(const char*)(src + i);
+        if (!dst[i]) {
+            return 0;
+        }
+    }
+    return -1; // 太长
+}
+
+int user_write_ok(u32 addr, u32 size) {
+    return user_bounds_ok(addr, size) && vmm_user_access_ok(addr, size, 1);
+}
+
+// 文件读写经过内核页中转: 文件系统和页缓存在自旋锁内复制数据，直接复制到用户缓冲区时
+// 缺页 (比如按需读入的 ELF 数据段) 会回到文件系统，在本 CPU 已持有的锁上死锁
+s32 user_fs_read(int fd, u32 buffer, u32 size) {
+    if (!user_write_ok(buffer, size)) {
+        return -1;
+    }
+    u8* bounce = page_alloc(0);
+    if (!bounce) {
+        return -1;
+    }
+    u32 done = 0;
+    while (done < size) {
+        u32 chunk = size - done < PAGE_SIZE ? size - done : PAGE_SIZE;
+        ssize_t n = fs_read(fd, bounce, chunk);
+        if (n < 0) {
+            page_free(bounce, 0);
+            return done ? (s32)done : -1;
+        }
+        memcpy((void*)(buffer + done), bounce, n); // 不持有任何锁，可以缺页
+        done += n;
+        if ((u32)n < chunk) {
+            break; // 文件结束
+        }
+    }
+    page_free(bounce, 0);
+    return (s32)done;
+}
+
+s32 user_fs_write(int fd, u32 buffer, u32 size) {
+    if (!user_range_ok(buffer, size)) {
+        return -1;
+    }
+    u8* bounce = page_alloc(0);
+    if (!bounce) {
+        return -1;
+    }
+    u32 done = 0;
+    while (done < size) {
+        u32 chunk = size - done < PAGE_SIZE ? size - done : PAGE_SIZE;
+        memcpy(bounce, (const void*)(buffer + done), chunk);
+        ssize_t n = fs_write(fd, bounce, chunk);
+        if (n < 0) {
+            page_free(bounce, 0);
+            return done ? (s32)done : -1;
+        }
+        done += n;
+        if ((u32)n < chunk) {
+            break; // 设备已满
+        }
+    }
+    page_free(bounce, 0);
+    return (s32)done;
+}
+
+// 各系统调用
+static u32 sys_read(u32 fd, u32 buffer, u32 size, u32 unused) {
+    (void)unused;
+    return user_fs_read(fd, buffer, size);
+}
+
+static u32 sys_write(u32 fd, u32 buffer, u32 size, u32 unused) {
+    (void)unused;
+    return user_fs_write(fd, buffer, size);
+}
+
+static u32 sys_open(u32 path, u32 flags, u32 unused1, u32 unused2) {
+    (void)unused1;
+    (void)unused2;
+    char* kpath = kmalloc(FS_MAX_PATH_LEN);
+    if (!kpath) {
+        return SYSCALL_ERROR;
+    }
+    u32 result = SYSCALL_ERROR;
+    if (user_copy_string(kpath, path, FS_MAX_PATH_LEN) == 0) {
+        result = fs_open(kpath, flags);
+    }
+    kfree(kpath);
+    return result;
+}
+
+static u32 sys_close(u32 fd, u32 unused1, u32 unused2, u32 unused3) {
+    (void)unused1;
+    (void)unused2;
+    (void)unused3;
+    return fs_close(fd);
+}
+
+static u32 sys_seek(u32 fd, u32 offset, u32 whence, u32 unused) {
+    (void)unused;
+    return fs_seek(fd, (off_t)offset, whence);
+}
+
+static u32 sys_mmap_call(u32 addr, u32 length, u32 prot, u32 flags) {
+    return (u32)sys_mmap((void*)addr, length, prot, flags);
+}
+
+static u32 sys_munmap_call(u32 addr, u32 length, u32 unused1, u32 unused2) {
+    (void)unused1;
+    (void)unused2;
+    return sys_munmap((void*)addr, length);
+}
+
+static u32 sys_fork(u32 unused1, u32 unused2, u32 unused3, u32 unused4) {
+    (void)unused1;
+    (void)unused2;
+    (void)unused3;
+    (void)unused4;
+    return task_fork();
+}
+
+static u32 sys_exec(u32 path, u32 unused1, u32 unused2, u32 unused3) {
+    (void)unused1;
+    (void)unused2;
+    (void)unused3;
+    char* kpath = kmalloc(FS_MAX_PATH_LEN);
+    if (!kpath) {
+        return SYSCALL_ERROR;
+    }
+    u32 result = SYSCALL_ERROR;
+    if (user_copy_string(kpath, path, FS_MAX_PATH_LEN) == 0) {
+        result = exec_load(kpath);
+    }
+    kfree(kpath);
+    return result;
+}
+
+static u32 sys_exit(u32 code, u32 unused1, u32 unused2, u32 unused3) {
+    (void)unused1;
+    (void)unused2;
+    (void)unused3;
+    task_exit((int)code);
+    return 0;
+}
+
+static u32 sys_wait(u32 pid, u32 status, u32 unused1, u32 unused2) {
+    (void)unused1;
+    (void)unused2;
+    if (status && !user_write_ok(status, sizeof(int))) {
+        return SYSCALL_ERROR;
+    }
+    int code = 0;
+    int result = task_wait((int)pid, &code);
+    if (result >= 0 && status) {
+        *(int*)status = code;
+    }
+    return result;
+}
+
+static u32 sys_futex(u32 uaddr, u32 op, u32 val, u32 unused) {
+    (void)unused;
+    if ((uaddr & 3) || !user_range_ok(uaddr, sizeof(u32))) {
+        return SYSCALL_ERROR;
+    }
+    switch (op) {
+        case FUTEX_WAIT:
+            return futex_wait(uaddr, val);
+        case FUTEX_WAKE:
+            return futex_wake(uaddr, (int)val);
+        default:
+            return SYSCALL_ERROR;
+    }
+}
+
+static u32 sys_ioring_setup(u32 entries, u32 unused1, u32 unused2, u32 unused3) {
+    (void)unused1;
+    (void)unused2;
+    (void)unused3;
+    u32 ring = ioring_setup(entries);
+    return ring ? ring : SYSCALL_ERROR;
+}
+
+static u32 sys_ioring_enter(u32 to_submit, u32 unused1, u32 unused2, u32 unused3) {
+    (void)unused1;
+    (void)unused2;
+    (void)unused3;
+    return ioring_enter(to_submit);
+}
+
+static u32 sys_ipc_create(u32 handles, u32 unused1, u32 unused2, u32 unused3) {
+    (void)unused1;
+    (void)unused2;
+    (void)unused3;
+    if (!user_write_ok(handles, 2 * sizeof(int))) {
+        return SYSCALL_ERROR;
+    }
+    int kh[2];
+    if (ipc_create(kh) < 0) {
+        return SYSCALL_ERROR;
+    }
+    ((int*)handles)[0] = kh[0];
+    ((int*)handles)[1] = kh[1];
+    return 0;
+}
+
+static u32 sys_ipc_send(u32 handle, u32 msg, u32 unused1, u32 unused2) {
+    (void)unused1;
+    (void)unused2;
+    if (!user_range_ok(msg, sizeof(ipc_msg_t))) {
+        return SYSCALL_ERROR;
+    }
+    ipc_msg_t kmsg = *(const ipc_msg_t*)msg; // 先复制，避免检查后被用户态改写
+    return ipc_send((int)handle, &kmsg);
+}
+
+static u32 sys_ipc_recv(u32 handle, u32 msg, u32 flags, u32 unused) {
+    (void)unused;
+    if (!user_write_ok(msg, sizeof(ipc_msg_t))) {
+        return SYSCALL_ERROR;
+    }
+    // 收到内核副本，不持有锁时再复制给用户态
+    ipc_msg_t kmsg;
+    memset(&kmsg, 0, sizeof(kmsg)); // 超出 len 的部分不能带出内核栈上的旧数据
+    int result = ipc_recv((int)handle, &kmsg, flags);
+    if (result >= 0) {
+        *(ipc_msg_t*)msg = kmsg;
+    }
+    return result;
+}
+
+static u32 sys_ipc_notify(u32 handle, u32 bits, u32 unused1, u32 unused2) {
+    (void)unused1;
+    (void)unused2;
+    return ipc_notify((int)handle, bits);
+}
+
+static u32 sys_ipc_close(u32 handle, u32 unused1, u32 unused2, u32 unused3) {
+    (void)unused1;
+    (void)unused2;
+    (void)unused3;
+    return ipc_close((int)handle);
+}
+
+static u32 sys_getpid(u32 unused1, u32 unused2, u32 unused3, u32 unused4) {
+    (void)unused1;
+    (void)unused2;
+    (void)unused3;
+    (void)unused4;
+    return current_task()->pid;
+}
+
+// 分发表 (未实现的调用为 NULL)
+static syscall_fn_t syscall_table[NR_SYSCALLS] = {
+    [SYS_READ]   = sys_read,
+    [SYS_WRITE]  = sys_write,
+    [SYS_OPEN]   = sys_open,
+    [SYS_CLOSE]  = sys_close,
+    [SYS_SEEK]   = sys_seek,
+    [SYS_MMAP]   = sys_mmap_call,
+    [SYS_MUNMAP] = sys_munmap_call,
+    [SYS_FORK]   = sys_fork,
+    [SYS_EXEC]   = sys_exec,
+    [SYS_EXIT]   = sys_exit,
+    [SYS_WAIT]   = sys_wait,
+    [SYS_GETPID] = sys_getpid,
+    [SYS_FUTEX]  = sys_futex,
+    [SYS_IORING_SETUP] = sys_ioring_setup,
+    [SYS_IORING_ENTER] = sys_ioring_enter,
+    [SYS_IPC_CREATE] = sys_ipc_create,
+    [SYS_IPC_SEND]   = sys_ipc_send,
+    [SYS_IPC_RECV]   = sys_ipc_recv,
+    [SYS_IPC_NOTIFY] = sys_ipc_notify,
+    [SYS_IPC_CLOSE]  = sys_ipc_close,
+};
+
+void syscall_dispatch(irq_frame_t* frame) {
+    u32 nr = frame->eax;
+    if (nr >= NR_SYSCALLS || !syscall_table[nr]) {
+        frame->eax = SYSCALL_ERROR;
+        return;
+    }
+    frame->eax = syscall_table[nr](frame->ebx, frame->esi, frame->edi, frame->ebp);
+}
+
+// sysenter 路径的 C 入口 (中断已打开)
+void syscall_sysenter(irq_frame_t* frame) {
+    syscall_dispatch(frame);
+    irq_exit();
+}
+
+void user_enter(u32 eip, u32 esp) {
+    __asm__ __volatile__ (
+        "cli\n"
+        "movw %2, %%ax\n"
+        "movw %%ax, %%ds\n"
+        "movw %%ax, %%es\n"
+        "movw %%ax, %%fs\n"
+        "movw %%ax, %%gs\n"
+        "pushl %2\n"        // ss
+        "pushl %1\n"        // esp
+        "pushl $0x202\n"    // eflags: IF
+        "pushl %3\n"        // cs
+        "pushl %0\n"        // eip
+        "iret\n"
+        :
+        : "r"(eip), "r"(esp), "i"(USER_DS), "i"(USER_CS)
+        : "eax", "memory"
+    );
+    __builtin_unreachable();
+}
+
+// 检查本 CPU 是否支持 sysenter 并设置 MSR
+void syscall_init_cpu(void) {
+    u32 eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    u32 family = (eax >> 8) & 0xF;
+    u32 model = (eax >> 4) & 0xF;
+    u32 stepping = eax & 0xF;
+
+    // 早期 Pentium Pro 报告 SEP 但并不支持
+    int supported = (edx & (1 << 11)) && !(family == 6 && model < 3 && stepping < 3);
+    if (!supported) {
+        return;
+    }
+
+    wrmsr(MSR_SYSENTER_CS, KERNEL_CS);
+    wrmsr(MSR_SYSENTER_ESP, (u32)gdt_kernel_stack_slot(this_cpu()->id));
+    wrmsr(MSR_SYSENTER_EIP, (u32)sysenter_entry);
+    if (this_cpu()->id == 0) {
+        has_sysenter = 1;
+    }
+}
+
+int syscall_has_sysenter(void) {
+    return has_sysenter;
+}
+
+void syscall_init(void) {
+    irq_register_user(SYSCALL_VECTOR, syscall_dispatch);
+    syscall_init_cpu();
+    printf("系统调用: int 0x%x%s\n", SYSCALL_VECTOR, has_sysenter ? ", sysenter" : "");
+}
+
+// 空系统调用往返测试
+// 用户态代码复制到固定地址执行，分别用 int 0x80 和 sysenter 循环调用
+// SYS_GETPID，用 rdtsc 计时，结果写入数据页。
+#define BENCH_CODE          0xBFF00000
+#define BENCH_DATA          0xBFF01000
+#define BENCH_STACK         0xBFF02000
+#define BENCH_PAGES         3
+#define BENCH_ITERATIONS    100000
+
+// 数据页布局
+#define BENCH_ITER_OFF      0
+#define BENCH_SEP_OFF       4
+#define BENCH_DONE_OFF      8
+#define BENCH_T0_OFF        16      // int 0x80 开始/结束
+#define BENCH_T1_OFF        24
+#define BENCH_T2_OFF        32      // sysenter 开始/结束
+#define BENCH_T3_OFF        40
+
+#define BENCH_D(off)        "(" SYSCALL_STR(BENCH_DATA) "+" SYSCALL_STR(off) ")"
+
+extern u8 syscall_bench_user_start[];
+extern u8 syscall_bench_user_end[];
+__asm__ (
+    ".section .text\n"
+    ".global syscall_bench_user_start\n"
+    "syscall_bench_user_start:\n"
+    "    movl " BENCH_D(BENCH_ITER_OFF) ", %edi\n"
+    "    rdtsc\n"
+    "    movl %eax, " BENCH_D(BENCH_T0_OFF) "\n"
+    "    movl %edx, " BENCH_D(BENCH_T0_OFF + 4) "\n"
+    "1:  movl $" SYSCALL_STR(SYS_GETPID) ", %eax\n"
+    "    int $" SYSCALL_STR(SYSCALL_VECTOR) "\n"
+    "    decl %edi\n"
+    "    jnz 1b\n"
+    "    rdtsc\n"
+    "    movl %eax, " BENCH_D(BENCH_T1_OFF) "\n"
+    "    movl %edx, " BENCH_D(BENCH_T1_OFF + 4) "\n"
+    "    cmpl $0, " BENCH_D(BENCH_SEP_OFF) "\n"
+    "    je 3f\n"
+    "    movl " BENCH_D(BENCH_ITER_OFF) ", %edi\n"
+    "    rdtsc\n"
+    "    movl %eax, " BENCH_D(BENCH_T2_OFF) "\n"
+    "    movl %edx, " BENCH_D(BENCH_T2_OFF + 4) "\n"
+    "2:  movl $" SYSCALL_STR(SYS_GETPID) ", %eax\n"
+    "    movl %esp, %ecx\n"
+    "    movl $(" SYSCALL_STR(BENCH_CODE) " + 4f - syscall_bench_user_start), %edx\n"
+    "    sysenter\n"
+    "4:  decl %edi\n"
+    "    jnz 2b\n"
+    "    rdtsc\n"
+    "    movl %eax, " BENCH_D(BENCH_T3_OFF) "\n"
+    "    movl %edx, " BENCH_D(BENCH_T3_OFF + 4) "\n"
+    "3:  movl $1, " BENCH_D(BENCH_DONE_OFF) "\n"
+    "    movl $" SYSCALL_STR(SYS_EXIT) ", %eax\n"
+    "    xorl %ebx, %ebx\n"
+    "    int $" SYSCALL_STR(SYSCALL_VECTOR) "\n"
+    "5:  jmp 5b\n"
+    ".global syscall_bench_user_end\n"
+    "syscall_bench_user_end:\n"
+);
+
+static void syscall_bench_task(void) {
+    user_enter(BENCH_CODE, BENCH_STACK + PAGE_SIZE);
+}
+
+static u32 bench_cycles(u32 start_off, u32 end_off) {
+    u64 start = *(volatile u64*)(BENCH_DATA + start_off);
+    u64 end = *(volatile u64*)(BENCH_DATA + end_off);
+    return (u32)div_u64_rem(end - start, BENCH_ITERATIONS, NULL);
+}
+
+void syscall_benchmark(void) {
+    // 测试任务退出时还在执行这几页上的代码，所以映射一直保留，
+    // 下次测试时由 MAP_FIXED 替换
+    void* base = sys_mmap((void*)BENCH_CODE, BENCH_PAGES * PAGE_SIZE,
+                          PROT_READ | PROT_WRITE | PROT_EXEC,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED);
+    if (base == MAP_FAILED) {
+        printf("系统调用测试: 无法映射用户页\n");
+        return;
+    }
+    memcpy(base, syscall_bench_user_start, syscall_bench_user_end - syscall_bench_user_start);
+
+    volatile u32* data = (volatile u32*)BENCH_DATA;
+    data[BENCH_ITER_OFF / 4] = BENCH_ITERATIONS;
+    data[BENCH_SEP_OFF / 4] = has_sysenter;
+    data[BENCH_DONE_OFF / 4] = 0;
+
+    if (create_process("syscall_bench", syscall_bench_task) < 0) {
+        printf("系统调用测试: 无法创建任务\n");
+        return;
+    }
+    for (int i = 0; i < 500 && !data[BENCH_DONE_OFF / 4]; i++) {
+        sleep(10);
+    }
+    if (!data[BENCH_DONE_OFF / 4]) {
+        printf("系统调用测试: 超时\n");
+        return;
+    }
+
+    printf("空系统调用往返: int 0x80 %u 周期", bench_cycles(BENCH_T0_OFF, BENCH_T1_OFF));
+    if (has_sysenter) {
+        printf(", sysenter %u 周期", bench_cycles(BENCH_T2_OFF, BENCH_T3_OFF));
+    }
+    printf(" (%d 次平均)\n", BENCH_ITERATIONS);
+}
@@ -0,0 +1,42 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include "kernel.h"
+#include "irq.h"
+
+// 系统调用约定 (两种入口相同):
+//   eax = 调用号，参数依次放在 ebx, esi, edi, ebp，返回值在 eax
+//   sysenter 入口另需 ecx = 用户栈指针，edx = 返回地址，二者返回后被破坏
+#define SYSCALL_VECTOR      0x80
+
+// MSR
+#define MSR_SYSENTER_CS     0x174
+#define MSR_SYSENTER_ESP    0x175
+#define MSR_SYSENTER_EIP    0x176
+
+typedef u32 (*syscall_fn_t)(u32 arg1, u32 arg2, u32 arg3, u32 arg4);
+
+// 系统调用初始化 (BSP 调用 syscall_init，每个 AP 调用 syscall_init_cpu)
+void syscall_init(void);
+void syscall_init_cpu(void);
+int syscall_has_sysenter(void);
+
+// 分发 (两种入口共用)
+void syscall_dispatch(irq_frame_t* frame);
+
+// 用户指针检查与字符串复制 (失败返回 -1)
+int user_range_ok(u32 addr, u32 size);          // 落在当前地址空间的 VMA 内
+int user_write_ok(u32 addr, u32 size);          // 落在可写的 VMA 内
+int user_copy_string(char* dst, u32 src, u32 max);
+
+// 在用户缓冲区和文件之间读写 (经过内核中转)，返回字节数，失败返回 -1
+s32 user_fs_read(int fd, u32 buffer, u32 size);
+s32 user_fs_write(int fd, u32 buffer, u32 size);
+
+// 以用户态进入 eip，不再返回
+void user_enter(u32 eip, u32 esp) __attribute__((noreturn));
+
+// 空系统调用往返开销测试
+void syscall_benchmark(void);
+
+#endif // SYSCALL_H
@@ -0,0 +1,391 @@
+#include "timer.h"
+#include "apic.h"
+#include "smp.h"
+#include "sched.h"
+#include "io.h"
+#include "irq.h"
+#include "spinlock.h"
+#include "profile.h"
+#include "clock.h"
+#include <stdio.h>
+
+// 时钟节拍与定时器轮
+// 每个 CPU 的本地 APIC 定时器提供 HZ 周期节拍；CPU 0 负责推进 jiffies，
+// 定时器轮在 SOFTIRQ_TIMER 中处理。CPU 空闲时停止周期节拍 (CPU 0 改为一次性定时到
+// 下一个定时器到期)，醒来后再补算经过的节拍。
+
+// LAPIC 定时器模式
+#define LAPIC_TIMER_ONESHOT   0x00000
+#define LAPIC_TIMER_PERIODIC  0x20000
+#define LAPIC_TIMER_MASKED    0x10000
+#define LAPIC_TIMER_DIV_16    0x3
+
+// PIT
+#define PIT_FREQUENCY         1193182
+
+#define TIMER_NEVER           (~0ULL)
+
+// 节拍计数 (只有 CPU 0 写，读者用序号检测撕裂)
+static volatile u32 jiffies_seq = 0;
+static volatile u64 jiffies = 0;
+
+static volatile int timer_ready = 0;
+static int use_lapic = 0;
+static u32 lapic_ticks_per_jiffy = 0;
+static u32 max_idle_ticks = 0;
+
+// 定时器轮
+static ktimer_t* wheel[TIMER_WHEEL_SIZE];
+static spinlock_t wheel_lock = SPINLOCK_INIT;
+static u64 wheel_clock = 0;         // 已处理到的节拍
+
+// CPU 0 空闲期间的一次性定时
+static u32 idle_program = 0;
+static u32 idle_residual = 0;
+static volatile u64 idle_deadline = TIMER_NEVER;
+static u64 idle_start_jiffies = 0;      // 进入空闲时的 jiffies 和单调时钟 (受 wheel_lock 保护)
+static u64 idle_start_ns = 0;
+
+#define barrier() __asm__ __volatile__ ("" : : : "memory")
+
+u64 get_jiffies(void) {
+    u32 seq;
+    u64 value;
+    do {
+        seq = jiffies_seq;
+        barrier();
+        value = jiffies;
+        barrier();
+    } while ((seq & 1) || seq != jiffies_seq);
+    return value;
+}
+
+static void jiffies_advance(u32 ticks) {
+    jiffies_seq++;
+    barrier();
+    jiffies += ticks;
+    barrier();
+    jiffies_seq++;
+}
+
+u32 ms_to_ticks(u32 ms) {
+    return (ms * HZ + 999) / 1000;
+}
+
+// 用 PIT 通道 2 忙等待 (单次最长约 54ms)
+void pit_wait_us(u32 us) {
+    while (us > 0) {
+        u32 chunk = us > 50000 ? 50000 : us;
+        u32 count = chunk * 1193 / 1000;
+        outb(0x61, (inb(0x61) & ~0x02) | 0x01);  // 打开通道 2 门控，关闭扬声器
+        outb(0x43, 0xB0);                        // 通道 2，先低后高，模式 0
+        outb(0x42, count & 0xFF);
+        outb(0x42, count >> 8);
+        while (!(inb(0x61) & 0x20)) {
+            __asm__ __volatile__ ("pause");
+        }
+        us -= chunk;
+    }
+}
+
+// LAPIC 定时器控制
+static void lapic_timer_periodic(void) {
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, TIMER_VECTOR | LAPIC_TIMER_PERIODIC);
+    lapic_write(LAPIC_TIMER_INIT, lapic_ticks_per_jiffy);
+}
+
+static void lapic_timer_oneshot(u32 count) {
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, TIMER_VECTOR | LAPIC_TIMER_ONESHOT);
+    lapic_write(LAPIC_TIMER_INIT, count);
+}
+
+static void lapic_timer_stop(void) {
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_MASKED);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+}
+
+// 用 PIT 校准 LAPIC 定时器
+static void lapic_timer_calibrate(void) {
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_MASKED);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    pit_wait_us(10000);
+    u32 elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+
+    lapic_ticks_per_jiffy = elapsed / 10 * 1000 / HZ;
+    if (lapic_ticks_per_jiffy == 0) {
+        lapic_ticks_per_jiffy = 1;
+    }
+    max_idle_ticks = 0xFFFFFFFF / lapic_ticks_per_jiffy;
+    if (max_idle_ticks > 10 * HZ) {
+        max_idle_ticks = 10 * HZ;
+    }
+}
+
+// 处理所有已到期的定时器 (CPU 0 的 SOFTIRQ_TIMER)
+static void timer_run(void) {
+    u64 now = get_jiffies();
+    ktimer_t* expired = NULL;
+
+    u32 flags = spin_lock_irqsave(&wheel_lock);
+    if (now - wheel_clock > TIMER_WHEEL_SIZE) {
+        wheel_clock = now - TIMER_WHEEL_SIZE; // 每个槽最多扫描一次
+    }
+    while (wheel_clock < now) {
+        wheel_clock++;
+        ktimer_t* timer = wheel[wheel_clock & (TIMER_WHEEL_SIZE - 1)];
+        while (timer) {
+            ktimer_t* next = timer->next;
+            if (timer->expires <= now) {
+                if (timer->prev) {
+                    timer->prev->next = timer->next;
+                } else {
+                    wheel[timer->expires & (TIMER_WHEEL_SIZE - 1)] = timer->next;
+                }
+                if (timer->next) {
+                    timer->next->prev = timer->prev;
+                }
+                timer->pending = TIMER_RUNNING;
+                timer->next = expired;
+                expired = timer;
+            }
+            timer = next;
+        }
+    }
+    spin_unlock_irqrestore(&wheel_lock, flags);
+
+    // 在锁外执行回调。回调返回后才清除 TIMER_RUNNING，此后定时器可能已被释放
+    while (expired) {
+        ktimer_t* next = expired->next;
+        expired->func(expired->data);
+        __sync_bool_compare_and_swap(&expired->pending, TIMER_RUNNING, 0); // 回调可能重新添加了它
+        expired = next;
+    }
+}
+
+static u64 timer_next_expiry(void) {
+    u64 next = TIMER_NEVER;
+    spin_lock(&wheel_lock);
+    for (int i = 0; i < TIMER_WHEEL_SIZE; i++) {
+        for (ktimer_t* timer = wheel[i]; timer; timer = timer->next) {
+            if (timer->expires < next) {
+                next = timer->expires;
+            }
+        }
+    }
+    spin_unlock(&wheel_lock);
+    return next;
+}
+
+// 时钟中断 (已由 irq_dispatch 应答，重新调度也在那里进行)
+static void timer_interrupt(irq_frame_t* frame) {
+    cpu_t* cpu = this_cpu();
+
+    // 空闲期间的节拍由 timer_idle_exit 统一补算
+    if (cpu->tickless) {
+        return;
+    }
+
+    profile_sample(frame);
+
+    if (cpu->id == 0) {
+        jiffies_advance(1);
+        softirq_raise(SOFTIRQ_TIMER);
+    }
+    sched_tick(cpu);
+}
+
+// 重新调度 IPI: 把 CPU 从 hlt 中唤醒。
+// 在 timer_init 之前上线的 AP 还没有节拍，timer_init 广播这个 IPI 让它们启动周期节拍
+static void resched_interrupt(irq_frame_t* frame) {
+    (void)frame;
+    if (timer_ready && use_lapic && !this_cpu()->tickless && lapic_read(LAPIC_TIMER_INIT) == 0) {
+        lapic_timer_periodic();
+    }
+}
+
+void timer_setup(ktimer_t* timer, void (*func)(void* data), void* data) {
+    timer->func = func;
+    timer->data = data;
+    timer->pending = 0;
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+// 当前节拍数 (调用者持有 wheel_lock)。CPU 0 空闲时 jiffies 停止推进，醒来才补算，
+// 这时按单调时钟推算；否则其他 CPU 用过时的 jiffies 计算到期时间，补算后定时器立即到期
+static u64 timer_now_locked(void) {
+    if (cpus[0].tickless) {
+        u64 elapsed = clock_now() - idle_start_ns;
+        return idle_start_jiffies + div_u64_rem(elapsed, (u32)(NSEC_PER_SEC / HZ), NULL);
+    }
+    return get_jiffies();
+}
+
+void timer_add(ktimer_t* timer, u32 ticks) {
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    u32 flags = spin_lock_irqsave(&wheel_lock);
+    u64 expires = timer_now_locked() + ticks;
+    timer->expires = expires;
+    ktimer_t** slot = &wheel[timer->expires & (TIMER_WHEEL_SIZE - 1)];
+    timer->prev = NULL;
+    timer->next = *slot;
+    if (*slot) {
+        (*slot)->prev = timer;
+    }
+    *slot = timer;
+    timer->pending = 1;
+    spin_unlock_irqrestore(&wheel_lock, flags);
+
+    // CPU 0 正在空闲且定时得比新定时器晚: 唤醒它重新设置
+    if (expires < idle_deadline && cpus[0].tickless && this_cpu() != &cpus[0]) {
+        lapic_send_ipi(cpus[0].apic_id, RESCHED_VECTOR);
+    }
+}
+
+int timer_del(ktimer_t* timer) {
+    u32 flags = spin_lock_irqsave(&wheel_lock);
+    int was_pending = timer->pending == 1;
+    if (was_pending) {
+        if (timer->prev) {
+            timer->prev->next = timer->next;
+        } else {
+            wheel[timer->expires & (TIMER_WHEEL_SIZE - 1)] = timer->next;
+        }
+        if (timer->next) {
+            timer->next->prev = timer->prev;
+        }
+        timer->pending = 0;
+    }
+    spin_unlock_irqrestore(&wheel_lock, flags);
+
+    // 已经摘下、回调还没执行完: 等它结束，返回后调用者才能释放定时器
+    while (timer->pending == TIMER_RUNNING) {
+        cpu_relax();
+    }
+    return was_pending;
+}
+
+// 进入空闲 (中断已关闭): 停止周期节拍
+void timer_idle_enter(void) {
+    cpu_t* cpu = this_cpu();
+    if (!timer_ready || !use_lapic) {
+        return;
+    }
+
+    if (cpu->id != 0) {
+        cpu->tickless = 1;
+        lapic_timer_stop();
+        return;
+    }
+
+    // 记下空闲起点供 timer_now_locked 推算，再停止推进 jiffies
+    u64 now = get_jiffies();
+    spin_lock(&wheel_lock);
+    idle_start_jiffies = now;
+    idle_start_ns = clock_now();
+    cpu->tickless = 1;
+    spin_unlock(&wheel_lock);
+
+    // CPU 0 定时到下一个定时器到期
+    u64 next = timer_next_expiry();
+    u64 delta = next > now ? next - now : 1;
+    if (delta > max_idle_ticks) {
+        delta = max_idle_ticks;
+    }
+    idle_deadline = now + delta;
+    idle_program = (u32)delta * lapic_ticks_per_jiffy;
+    lapic_timer_oneshot(idle_program);
+}
+
+// 退出空闲 (中断已关闭): 补算节拍并恢复周期节拍
+void timer_idle_exit(void) {
+    cpu_t* cpu = this_cpu();
+    if (!cpu->tickless) {
+        return;
+    }
+    cpu->tickless = 0;
+
+    if (cpu->id == 0) {
+        u32 elapsed = idle_program - lapic_read(LAPIC_TIMER_CURRENT) + idle_residual;
+        u32 ticks = elapsed / lapic_ticks_per_jiffy;
+        idle_residual = elapsed % lapic_ticks_per_jiffy;
+        idle_deadline = TIMER_NEVER;
+        if (ticks) {
+            jiffies_advance(ticks);
+            softirq_raise(SOFTIRQ_TIMER);
+        }
+    }
+    lapic_timer_periodic();
+}
+
+// 睡眠
+static void sleep_wakeup(void* data) {
+    sched_wakeup((task_t*)data);
+}
+
+void sleep(int ms) {
+    if (ms <= 0) {
+        return;
+    }
+
+    // 定时器就绪之前只能忙等
+    if (!timer_ready) {
+        pit_wait_us((u32)ms * 1000);
+        return;
+    }
+
+    task_t* task = current_task();
+    ktimer_t timer;
+    timer_setup(&timer, sleep_wakeup, task);
+
+    u32 flags = local_irq_save();
+    task->state = TASK_BLOCKED;
+    timer_add(&timer, ms_to_ticks(ms) + 1);
+    schedule();
+    local_irq_restore(flags);
+
+    // 被其他原因唤醒时定时器还在轮中，而它在本函数的栈上
+    timer_del(&timer);
+}
+
+// 定时器初始化
+void timer_init(void) {
+    irq_register(TIMER_VECTOR, timer_interrupt);
+    irq_register(RESCHED_VECTOR, resched_interrupt);
+    softirq_register(SOFTIRQ_TIMER, timer_run);
+
+    if (lapic_available()) {
+        use_lapic = 1;
+        lapic_timer_calibrate();
+        lapic_timer_periodic();
+        printf("LAPIC 定时器: %u 计数/节拍, HZ=%d\n", lapic_ticks_per_jiffy, HZ);
+    } else {
+        // 没有 APIC 时使用 PIT 通道 0 (IRQ0)
+        u32 divisor = PIT_FREQUENCY / HZ;
+        irq_register(IRQ_BASE + IRQ_PIT, timer_interrupt);
+        outb(0x43, 0x34);                   // 通道 0，先低后高，模式 2
+        outb(0x40, divisor & 0xFF);
+        outb(0x40, divisor >> 8);
+        irq_unmask(IRQ_PIT);
+        printf("PIT 定时器: HZ=%d\n", HZ);
+    }
+
+    timer_ready = 1;
+
+    // 已上线的 AP 在 hlt 中或正在运行任务，都要启动节拍
+    if (use_lapic) {
+        __sync_synchronize();
+        for (u32 i = 1; i < cpu_count; i++) {
+            if (cpus[i].online) {
+                lapic_send_ipi(cpus[i].apic_id, RESCHED_VECTOR);
+            }
+        }
+    }
+}
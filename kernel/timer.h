@@ -0,0 +1,50 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "kernel.h"
+
+// 时钟频率 (每秒节拍数)
+#define HZ                  1000
+
+// 中断向量
+#define TIMER_VECTOR        0x40
+#define RESCHED_VECTOR      0x41
+
+// 时间片 (节拍)
+#define TIME_SLICE_TICKS    10
+
+// 定时器轮槽数 (必须为 2 的幂)
+#define TIMER_WHEEL_SIZE    256
+
+#define TIMER_RUNNING       2
+
+// 内核定时器
+typedef struct ktimer {
+    u64 expires;                // 到期节拍
+    void (*func)(void* data);
+    void* data;
+    volatile int pending;       // 1: 在轮中; TIMER_RUNNING: 已到期，回调执行中
+    struct ktimer* next;
+    struct ktimer* prev;
+} ktimer_t;
+
+// 定时器初始化
+void timer_init(void);
+
+// 节拍计数
+u64 get_jiffies(void);
+u32 ms_to_ticks(u32 ms);
+
+// 定时器管理
+void timer_setup(ktimer_t* timer, void (*func)(void* data), void* data);
+void timer_add(ktimer_t* timer, u32 ticks);
+int timer_del(ktimer_t* timer);        // 回调正在执行时等它结束 (不能在自己的回调中调用)
+
+// 空闲时停止周期节拍
+void timer_idle_enter(void);
+void timer_idle_exit(void);
+
+// PIT 忙等待 (仅用于定时器就绪之前)
+void pit_wait_us(u32 us);
+
+#endif // TIMER_H
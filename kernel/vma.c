@@ -0,0 +1,180 @@
+#include "vmm.h"
+
+// VMA 的 AVL 树实现
+// 区间互不重叠，按起始地址排序，查找包含某地址的 VMA 为 O(log n)。
+
+static inline int vma_height(vma_t* node) {
+    return node ? node->height : 0;
+}
+
+static inline void vma_update(vma_t* node) {
+    int lh = vma_height(node->left);
+    int rh = vma_height(node->right);
+    node->height = (lh > rh ? lh : rh) + 1;
+}
+
+static vma_t* rotate_right(vma_t* node) {
+    vma_t* left = node->left;
+    node->left = left->right;
+    left->right = node;
+    vma_update(node);
+    vma_update(left);
+    return left;
+}
+
+static vma_t* rotate_left(vma_t* node) {
+    vma_t* right = node->right;
+    node->right = right->left;
+    right->left = node;
+    vma_update(node);
+    vma_update(right);
+    return right;
+}
+
+static vma_t* vma_balance(vma_t* node) {
+    vma_update(node);
+    int factor = vma_height(node->left) - vma_height(node->right);
+
+    if (factor > 1) {
+        if (vma_height(node->left->left) < vma_height(node->left->right)) {
+            node->left = rotate_left(node->left);
+        }
+        return rotate_right(node);
+    }
+    if (factor < -1) {
+        if (vma_height(node->right->right) < vma_height(node->right->left)) {
+            node->right = rotate_right(node->right);
+        }
+        return rotate_left(node);
+    }
+    return node;
+}
+
+static vma_t* avl_insert(vma_t* node, vma_t* vma) {
+    if (!node) {
+        return vma;
+    }
+    if (vma->start < node->start) {
+        node->left = avl_insert(node->left, vma);
+    } else {
+        node->right = avl_insert(node->right, vma);
+    }
+    return vma_balance(node);
+}
+
+// 摘下子树中最小的节点
+static vma_t* avl_remove_min(vma_t* node, vma_t** min) {
+    if (!node->left) {
+        *min = node;
+        return node->right;
+    }
+    node->left = avl_remove_min(node->left, min);
+    return vma_balance(node);
+}
+
+static vma_t* avl_remove(vma_t* node, vma_t* vma) {
+    if (!node) {
+        return NULL;
+    }
+    if (vma->start < node->start) {
+        node->left = avl_remove(node->left, vma);
+    } else if (vma->start > node->start) {
+        node->right = avl_remove(node->right, vma);
+    } else {
+        vma_t* left = node->left;
+        vma_t* right = node->right;
+        if (!right) {
+            return left;
+        }
+        vma_t* min;
+        right = avl_remove_min(right, &min);
+        min->left = left;
+        min->right = right;
+        return vma_balance(min);
+    }
+    return vma_balance(node);
+}
+
+// 查找包含 addr 的 VMA
+vma_t* vma_find(vm_space_t* space, u32 addr) {
+    vma_t* cached = space->vma_cache;
+    if (cached && addr >= cached->start && addr < cached->end) {
+        return cached;
+    }
+
+    vma_t* node = space->vma_root;
+    while (node) {
+        if (addr < node->start) {
+            node = node->left;
+        } else if (addr >= node->end) {
+            node = node->right;
+        } else {
+            space->vma_cache = node;
+            return node;
+        }
+    }
+    return NULL;
+}
+
+// 查找与 [start, end) 相交的任意一个 VMA
+vma_t* vma_find_overlap(vm_space_t* space, u32 start, u32 end) {
+    vma_t* node = space->vma_root;
+    while (node) {
+        if (end <= node->start) {
+            node = node->left;
+        } else if (start >= node->end) {
+            node = node->right;
+        } else {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+int vma_insert(vm_space_t* space, vma_t* vma) {
+    if (vma->start >= vma->end || vma_find_overlap(space, vma->start, vma->end)) {
+        return -1;
+    }
+    vma->left = NULL;
+    vma->right = NULL;
+    vma->height = 1;
+    space->vma_root = avl_insert(space->vma_root, vma);
+    space->vma_count++;
+    return 0;
+}
+
+void vma_remove(vm_space_t* space, vma_t* vma) {
+    space->vma_root = avl_remove(space->vma_root, vma);
+    space->vma_count--;
+    if (space->vma_cache == vma) {
+        space->vma_cache = NULL;
+    }
+}
+
+// 中序遍历寻找第一个足够大的空洞
+static int gap_walk(vma_t* node, u32* candidate, u32 length) {
+    if (!node) {
+        return 0;
+    }
+    if (gap_walk(node->left, candidate, length)) {
+        return 1;
+    }
+    if (node->start >= *candidate && node->start - *candidate >= length) {
+        return 1;
+    }
+    if (node->end > *candidate) {
+        *candidate = node->end;
+    }
+    return gap_walk(node->right, candidate, length);
+}
+
+u32 vma_find_gap(vm_space_t* space, u32 length) {
+    u32 candidate = USER_BASE;
+    if (gap_walk(space->vma_root, &candidate, length)) {
+        return candidate;
+    }
+    if (USER_TOP - candidate >= length) {
+        return candidate;
+    }
+    return 0;
+}
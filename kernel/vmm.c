@@ -0,0 +1,725 @@
+#include "vmm.h"
+#include "irq.h"
+#include "smp.h"
+#include "clock.h"
+#include "io.h"
+#include "sched.h"
+#include "ioring.h"
+#include <string.h>
+#include <stdio.h>
+
+// 虚拟内存管理: 两级页表、地址空间、按需清零的匿名映射与写时复制
+
+static vm_space_t kernel_space;
+static int use_pse = 0;         // 已开启 4MB 大页
+
+// 本 CPU 已加载的地址空间
+static inline vm_space_t* current_space(void) {
+    vm_space_t* space = this_cpu()->space;
+    return space ? space : &kernel_space;
+}
+
+static inline u32 read_cr2(void) {
+    u32 value;
+    __asm__ __volatile__ ("movl %%cr2, %0" : "=r"(value));
+    return value;
+}
+
+static inline void load_cr3(u32 page_dir) {
+    __asm__ __volatile__ ("movl %0, %%cr3" : : "r"(page_dir) : "memory");
+}
+
+static inline void invlpg(u32 va) {
+    __asm__ __volatile__ ("invlpg (%0)" : : "r"(va) : "memory");
+}
+
+static inline int is_user_addr(u32 va) {
+    return va >= USER_BASE && va < USER_TOP;
+}
+
+static u32* alloc_table(void) {
+    u32* table = page_alloc(0);
+    if (table) {
+        memset(table, 0, PAGE_SIZE);
+    }
+    return table;
+}
+
+// 页错误无法处理: 用户态的访问终止当前任务。内核只在不持有锁时访问用户内存
+// (系统调用先按 VMA 检查过用户指针)，在用户地址上出错同样终止任务；其他内核错误只能停机
+static void page_fault_fatal(irq_frame_t* frame, u32 addr) {
+    printf("页错误: 地址 0x%x, 错误码 0x%x, EIP 0x%x\n", addr, frame->error_code, frame->eip);
+    if ((frame->error_code & PF_USER) || (is_user_addr(addr) && current_space() != &kernel_space)) {
+        printf("终止任务 %u\n", current_task()->pid);
+        local_irq_restore(frame->eflags); // 退出时可能睡眠，恢复出错前的中断状态
+        task_exit(-1);
+    }
+    for (;;) {
+        __asm__ __volatile__ ("cli; hlt");
+    }
+}
+
+// 分页初始化
+void vmm_init(void) {
+    memset(&kernel_space, 0, sizeof(kernel_space));
+    kernel_space.page_dir = alloc_table();
+    if (!kernel_space.page_dir) {
+        printf("无法分配内核页目录\n");
+        return;
+    }
+
+    u32 eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    use_pse = (edx & (1 << 3)) != 0;
+
+    // 直接映射全部物理内存。对齐的整 4MB 区间用大页，一个 TLB 项覆盖 1024 页；
+    // 第一个 4MB 仍用 4KB 页以保留第 0 页捕获空指针，末尾不足 4MB 的部分同样退回 4KB 页
+    u32 limit = page_max_pfn() << PAGE_SHIFT;
+    u32 large = 0;
+    u32 pa = PAGE_SIZE;
+    while (pa < limit) {
+        if (use_pse && !(pa & ~LARGE_PAGE_MASK) && limit - pa >= LARGE_PAGE_SIZE) {
+            vmm_map_large(pa, pa, PTE_WRITE | PTE_GLOBAL);
+            pa += LARGE_PAGE_SIZE;
+            large++;
+        } else {
+            vmm_map_page(&kernel_space, pa, pa, PTE_WRITE | PTE_GLOBAL);
+            pa += PAGE_SIZE;
+        }
+    }
+
+    irq_register(14, page_fault_handler);
+
+    // 开启全局页 (CR4.PGE) 与大页 (CR4.PSE)，再开启分页和写保护 (CR0.PG | CR0.WP)
+    u32 cr4_bits = 0x80 | (use_pse ? 0x10 : 0);
+    __asm__ __volatile__ (
+        "movl %%cr4, %%eax\n"
+        "orl %0, %%eax\n"
+        "movl %%eax, %%cr4\n"
+        : : "r"(cr4_bits) : "eax"
+    );
+    load_cr3((u32)kernel_space.page_dir);
+    __asm__ __volatile__ (
+        "movl %%cr0, %%eax\n"
+        "orl $0x80010000, %%eax\n"
+        "movl %%eax, %%cr0\n"
+        : : : "eax", "memory"
+    );
+
+    printf("分页已启用: 直接映射 %u MB (%u 个 4MB 大页)\n", limit >> 20, large);
+}
+
+// 地址空间管理
+vm_space_t* vmm_kernel_space(void) {
+    return &kernel_space;
+}
+
+vm_space_t* vmm_current_space(void) {
+    return current_space();
+}
+
+vm_space_t* vmm_create_space(void) {
+    vm_space_t* space = kmalloc(sizeof(vm_space_t));
+    if (!space) {
+        return NULL;
+    }
+
+    memset(space, 0, sizeof(vm_space_t));
+    space->page_dir = alloc_table();
+    if (!space->page_dir) {
+        kfree(space);
+        return NULL;
+    }
+
+    // 共享内核区的页表
+    for (u32 i = 0; i < 1024; i++) {
+        if (!is_user_addr(i << 22)) {
+            space->page_dir[i] = kernel_space.page_dir[i];
+        }
+    }
+    return space;
+}
+
+// 解除 [start, end) 的映射并释放物理页
+static void unmap_range(vm_space_t* space, u32 start, u32 end) {
+    u32 va = start;
+    while (va < end) {
+        if (!(space->page_dir[PDE_INDEX(va)] & PTE_PRESENT)) {
+            // 整个页表不存在，跳到下一个 4MB 边界
+            u32 next = (va + 0x400000) & ~0x3FFFFF;
+            if (next <= va) {
+                break;
+            }
+            va = next;
+            continue;
+        }
+        u32 pa = vmm_unmap_page(space, va);
+        if (pa) {
+            page_put((void*)pa); // 写时复制共享的页在最后一个引用消失时才释放
+            space->rss_pages--;
+        }
+        va += PAGE_SIZE;
+    }
+}
+
+static void vma_destroy_all(vm_space_t* space, vma_t* node) {
+    if (!node) {
+        return;
+    }
+    vma_destroy_all(space, node->left);
+    vma_destroy_all(space, node->right);
+    unmap_range(space, node->start, node->end);
+    if (node->ops && node->ops->close) {
+        node->ops->close(node);
+    }
+    kfree(node);
+}
+
+void vmm_destroy_space(vm_space_t* space) {
+    if (!space || space == &kernel_space) {
+        return;
+    }
+    if (current_space() == space) {
+        vmm_switch(&kernel_space);
+    }
+
+    vma_destroy_all(space, space->vma_root);
+
+    // 释放用户区页表
+    for (u32 i = PDE_INDEX(USER_BASE); i < PDE_INDEX(USER_TOP); i++) {
+        if (space->page_dir[i] & PTE_PRESENT) {
+            page_free((void*)(space->page_dir[i] & PTE_FRAME), 0);
+        }
+    }
+    page_free(space->page_dir, 0);
+    kfree(space);
+}
+
+// 切换本 CPU 的地址空间 (NULL 表示内核地址空间)
+void vmm_switch(vm_space_t* space) {
+    if (!space) {
+        space = &kernel_space;
+    }
+    if (space != current_space()) {
+        this_cpu()->space = space;
+        load_cr3((u32)space->page_dir);
+    }
+}
+
+static vma_t* vma_clone_all(vm_space_t* dst, vma_t* node) {
+    if (!node) {
+        return NULL;
+    }
+    vma_t* vma = kmalloc(sizeof(vma_t));
+    if (!vma) {
+        return node;
+    }
+    *vma = *node;
+    if (vma_insert(dst, vma) < 0) {
+        kfree(vma);
+        return node;
+    }
+    if (vma->ops && vma->ops->open) {
+        vma->ops->open(vma);
+    }
+    vma_t* failed = vma_clone_all(dst, node->left);
+    return failed ? failed : vma_clone_all(dst, node->right);
+}
+
+// 复制一张用户页表: 可写页在双方都改为只读并打上 PTE_COW，物理页引用数加 1
+static int fork_table(vm_space_t* dst, vm_space_t* src, u32 index) {
+    u32* src_table = (u32*)(src->page_dir[index] & PTE_FRAME);
+    u32* dst_table = alloc_table();
+    if (!dst_table) {
+        return -1;
+    }
+    for (u32 i = 0; i < 1024; i++) {
+        u32 pte = src_table[i];
+        if (!(pte & PTE_PRESENT)) {
+            continue;
+        }
+        if (pte & (PTE_WRITE | PTE_COW)) {
+            pte = (pte & ~PTE_WRITE) | PTE_COW;
+            src_table[i] = pte;
+        }
+        page_get((void*)(pte & PTE_FRAME));
+        dst_table[i] = pte;
+    }
+    dst->page_dir[index] = (u32)dst_table | (src->page_dir[index] & 0xFFF);
+    return 0;
+}
+
+vm_space_t* vmm_fork_space(vm_space_t* src) {
+    vm_space_t* dst = vmm_create_space();
+    if (!dst) {
+        return NULL;
+    }
+
+    // 先复制 VMA，失败时 vmm_destroy_space 才能按 VMA 归还已共享的页
+    if (vma_clone_all(dst, src->vma_root)) {
+        vmm_destroy_space(dst);
+        return NULL;
+    }
+
+    for (u32 i = PDE_INDEX(USER_BASE); i < PDE_INDEX(USER_TOP); i++) {
+        if (!(src->page_dir[i] & PTE_PRESENT)) {
+            continue;
+        }
+        if (fork_table(dst, src, i) < 0) {
+            vmm_destroy_space(dst);
+            return NULL;
+        }
+    }
+    dst->rss_pages = src->rss_pages;
+    dst->ioring = src->ioring;  // 环所在的 VMA 已随之复制
+    dst->ioring_entries = src->ioring_entries;
+
+    // 父进程的可写页已改为只读，刷新 TLB (用户页不是全局页，重新加载 CR3 即可)
+    if (src == current_space()) {
+        load_cr3((u32)src->page_dir);
+    }
+    return dst;
+}
+
+// 页映射 (4MB 大页没有页表项，返回 NULL)
+u32* vmm_get_pte(vm_space_t* space, u32 va, int create) {
+    u32* pde = &space->page_dir[PDE_INDEX(va)];
+    if (*pde & PTE_PS) {
+        return NULL;
+    }
+    if (!(*pde & PTE_PRESENT)) {
+        if (!create) {
+            return NULL;
+        }
+        u32* table = alloc_table();
+        if (!table) {
+            return NULL;
+        }
+        *pde = (u32)table | PTE_PRESENT | PTE_WRITE | (is_user_addr(va) ? PTE_USER : 0);
+    }
+    u32* table = (u32*)(*pde & PTE_FRAME);
+    return &table[PTE_INDEX(va)];
+}
+
+int vmm_map_page(vm_space_t* space, u32 va, u32 pa, u32 flags) {
+    // 内核区映射只建立在内核页目录中，其他地址空间在页错误时同步
+    if (!is_user_addr(va)) {
+        space = &kernel_space;
+    }
+
+    u32* pte = vmm_get_pte(space, va, 1);
+    if (!pte) {
+        return -1;
+    }
+    *pte = (pa & PTE_FRAME) | (flags & 0xFFF) | PTE_PRESENT;
+    invlpg(va);
+    return 0;
+}
+
+// 大页只用于内核区: 用户区的页表复制、写时复制与解除映射都以 4KB 页为单位。
+// 大页项只写在内核页目录中，与普通内核页表一样在页错误时同步到其他地址空间。
+int vmm_map_large(u32 va, u32 pa, u32 flags) {
+    if (!use_pse || is_user_addr(va) || ((va | pa) & ~LARGE_PAGE_MASK)) {
+        return -1;
+    }
+    u32* pde = &kernel_space.page_dir[PDE_INDEX(va)];
+    if ((*pde & PTE_PRESENT) && !(*pde & PTE_PS)) {
+        return -1; // 已有页表
+    }
+    *pde = pa | (flags & 0xFFF) | PTE_PS | PTE_PRESENT;
+    invlpg(va);
+    return 0;
+}
+
+int vmm_large_pages(void) {
+    return use_pse;
+}
+
+// 解除一页映射，返回原物理地址 (未映射时返回 0)
+u32 vmm_unmap_page(vm_space_t* space, u32 va) {
+    u32* pte = vmm_get_pte(space, va, 0);
+    if (!pte || !(*pte & PTE_PRESENT)) {
+        return 0;
+    }
+    u32 pa = *pte & PTE_FRAME;
+    *pte = 0;
+    if (space == current_space() || !is_user_addr(va)) {
+        invlpg(va);
+    }
+    return pa;
+}
+
+// 把设备内存恒等映射到 MMIO 区 (不缓存)
+void* vmm_map_mmio(u32 phys, u32 size) {
+    u32 start = phys & PAGE_MASK;
+    u32 end = (phys + size + PAGE_SIZE - 1) & PAGE_MASK;
+    if (start < MMIO_BASE) {
+        return (void*)phys; // 已在直接映射中
+    }
+    u32 flags = PTE_WRITE | PTE_PCD | PTE_PWT | PTE_GLOBAL;
+    u32 va = start;
+    while (va < end && va >= start) {
+        // 已被大页覆盖，或可以整块用大页映射 (如线性帧缓冲区)
+        u32 pde = kernel_space.page_dir[PDE_INDEX(va)];
+        if ((pde & PTE_PS) ||
+            (!(va & ~LARGE_PAGE_MASK) && end - va >= LARGE_PAGE_SIZE &&
+             vmm_map_large(va, va, flags) == 0)) {
+            va = (va & LARGE_PAGE_MASK) + LARGE_PAGE_SIZE;
+            if (va == 0) {
+                break;
+            }
+            continue;
+        }
+        if (vmm_map_page(&kernel_space, va, va, flags) < 0) {
+            return NULL;
+        }
+        va += PAGE_SIZE;
+    }
+    return (void*)phys;
+}
+
+// 写时复制: 最后一个引用者直接恢复写权限，否则复制一份私有页
+static int cow_fault(u32* pte, u32 addr) {
+    u32 old = *pte & PTE_FRAME;
+    u32 flags = (*pte & 0xFFF & ~PTE_COW) | PTE_WRITE;
+
+    if (page_refcount((void*)old) == 1) {
+        *pte = old | flags;
+        invlpg(addr & PAGE_MASK);
+        return 0;
+    }
+
+    void* page = page_alloc(0);
+    if (!page) {
+        return -1;
+    }
+    memcpy(page, (void*)old, PAGE_SIZE);
+    *pte = (u32)page | flags;
+    invlpg(addr & PAGE_MASK);
+    page_put((void*)old);
+    return 0;
+}
+
+// 页错误处理
+void page_fault_handler(irq_frame_t* frame) {
+    u32 error_code = frame->error_code;
+    u32 addr = read_cr2();
+    vm_space_t* space = current_space();
+
+    if (!is_user_addr(addr)) {
+        // 内核区页表在本地址空间创建之后才出现，从内核页目录同步
+        u32 index = PDE_INDEX(addr);
+        if (space != &kernel_space && !(space->page_dir[index] & PTE_PRESENT) &&
+            (kernel_space.page_dir[index] & PTE_PRESENT)) {
+            space->page_dir[index] = kernel_space.page_dir[index];
+            return;
+        }
+        page_fault_fatal(frame, addr);
+        return;
+    }
+
+    vma_t* vma = vma_find(space, addr);
+
+    // 写已存在的页: 只可能是写时复制
+    if (vma && (error_code & PF_PRESENT) && (error_code & PF_WRITE) && (vma->flags & VM_WRITE)) {
+        u32* pte = vmm_get_pte(space, addr, 0);
+        if (pte && (*pte & PTE_PRESENT) && (*pte & PTE_COW)) {
+            if (cow_fault(pte, addr) < 0) {
+                printf("页错误: 内存不足\n");
+                page_fault_fatal(frame, addr);
+            }
+            return;
+        }
+    }
+
+    if (!vma || (error_code & PF_PRESENT) ||
+        ((error_code & PF_WRITE) && !(vma->flags & VM_WRITE))) {
+        page_fault_fatal(frame, addr);
+        return;
+    }
+
+    // 文件映射由 VMA 提供页，匿名映射按需清零: 首次访问时才分配物理页
+    void* page;
+    if (vma->ops && vma->ops->fault) {
+        page = (void*)vma->ops->fault(vma, addr & PAGE_MASK);
+    } else {
+        page = page_alloc(0);
+        if (page) {
+            memset(page, 0, PAGE_SIZE);
+        }
+    }
+    if (!page) {
+        printf("页错误: 内存不足或读取失败\n");
+        page_fault_fatal(frame, addr);
+        return;
+    }
+
+    u32 flags = PTE_USER | ((vma->flags & VM_WRITE) ? PTE_WRITE : 0);
+    if (vmm_map_page(space, addr & PAGE_MASK, (u32)page, flags) < 0) {
+        page_put(page);
+        page_fault_fatal(frame, addr);
+        return;
+    }
+    space->rss_pages++;
+}
+
+int vmm_user_access_ok(u32 addr, u32 size, int write) {
+    vm_space_t* space = current_space();
+    if (space == &kernel_space) {
+        return 0;
+    }
+    u32 end = addr + size;
+    while (addr < end) {
+        vma_t* vma = vma_find(space, addr);
+        if (!vma || (write && !(vma->flags & VM_WRITE))) {
+            return 0;
+        }
+        addr = vma->end;
+    }
+    return 1;
+}
+
+// 系统调用
+void* sys_mmap(void* addr, size_t length, int prot, int flags) {
+    vm_space_t* space = current_space();
+
+    // 目前只支持匿名映射
+    if (length == 0 || !(flags & MAP_ANONYMOUS)) {
+        return MAP_FAILED;
+    }
+
+    u32 len = (length + PAGE_SIZE - 1) & PAGE_MASK;
+    u32 start = (u32)addr;
+    if (len == 0 || len > USER_TOP - USER_BASE) {
+        return MAP_FAILED;
+    }
+
+    if (flags & MAP_FIXED) {
+        if ((start & ~PAGE_MASK) || start < USER_BASE || start > USER_TOP - len) {
+            return MAP_FAILED;
+        }
+        sys_munmap(addr, len); // 替换已有映射
+    } else if ((start & ~PAGE_MASK) || start < USER_BASE || start > USER_TOP - len ||
+               vma_find_overlap(space, start, start + len)) {
+        // 提示地址不可用时另找空洞
+        start = vma_find_gap(space, len);
+        if (!start) {
+            return MAP_FAILED;
+        }
+    }
+
+    vma_t* vma = kmalloc(sizeof(vma_t));
+    if (!vma) {
+        return MAP_FAILED;
+    }
+    memset(vma, 0, sizeof(vma_t));
+    vma->start = start;
+    vma->end = start + len;
+    vma->flags = VM_ANON;
+    if (prot & PROT_READ) vma->flags |= VM_READ;
+    if (prot & PROT_WRITE) vma->flags |= VM_WRITE;
+    if (prot & PROT_EXEC) vma->flags |= VM_EXEC;
+
+    if (vma_insert(space, vma) < 0) {
+        kfree(vma);
+        return MAP_FAILED;
+    }
+
+    // 不分配物理页，首次访问时由页错误处理
+    return (void*)start;
+}
+
+// 从 VMA 头部去掉 bytes 字节，文件映射的偏移随之前移
+static void vma_skip(vma_t* vma, u32 bytes) {
+    vma->start += bytes;
+    vma->offset += bytes;
+    vma->filesz = vma->filesz > bytes ? vma->filesz - bytes : 0;
+}
+
+int sys_munmap(void* addr, size_t length) {
+    vm_space_t* space = current_space();
+    u32 start = (u32)addr;
+    u32 end = start + ((length + PAGE_SIZE - 1) & PAGE_MASK);
+
+    if ((start & ~PAGE_MASK) || length == 0 || start < USER_BASE || end > USER_TOP || end <= start) {
+        return -1;
+    }
+
+    ioring_unmapped(space, start, end);
+
+    vma_t* vma;
+    while ((vma = vma_find_overlap(space, start, end)) != NULL) {
+        u32 s = vma->start > start ? vma->start : start;
+        u32 e = vma->end < end ? vma->end : end;
+        unmap_range(space, s, e);
+
+        if (s == vma->start && e == vma->end) {
+            vma_remove(space, vma);
+            if (vma->ops && vma->ops->close) {
+                vma->ops->close(vma);
+            }
+            kfree(vma);
+        } else if (s == vma->start) {
+            vma_skip(vma, e - vma->start);
+        } else if (e == vma->end) {
+            vma->end = s;
+        } else {
+            // 从中间挖洞: 拆成两个 VMA
+            vma_t* tail = kmalloc(sizeof(vma_t));
+            if (!tail) {
+                return -1;
+            }
+            *tail = *vma;
+            vma_skip(tail, e - vma->start);
+            vma->end = s;
+            vma_insert(space, tail);
+            if (tail->ops && tail->ops->open) {
+                tail->ops->open(tail);
+            }
+        }
+    }
+    return 0;
+}
+
+// 页移交
+int vmm_take_pages(u32 start, u32 count, u32* pages) {
+    vm_space_t* space = current_space();
+    if (space == &kernel_space || (start & ~PAGE_MASK) || count == 0 ||
+        count > (USER_TOP - USER_BASE) >> PAGE_SHIFT) {
+        return -1;
+    }
+    u32 end = start + count * PAGE_SIZE;
+    if (start < USER_BASE || end > USER_TOP || end <= start) {
+        return -1;
+    }
+
+    // 只移交整段位于同一个可写匿名 VMA 内的页 (文件映射的页属于映像缓存)
+    vma_t* vma = vma_find(space, start);
+    if (!vma || vma->ops || !(vma->flags & VM_WRITE) || end > vma->end) {
+        return -1;
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        u32 va = start + i * PAGE_SIZE;
+        u32* pte = vmm_get_pte(space, va, 0);
+        if (pte && (*pte & PTE_PRESENT)) {
+            pages[i] = *pte & PTE_FRAME;
+            page_get((void*)pages[i]);
+            continue;
+        }
+        // 还没访问过的页: 移交一个清零页，与按需清零的结果相同
+        void* page = page_alloc(0);
+        if (!page) {
+            while (i > 0) {
+                page_put((void*)pages[--i]);
+            }
+            return -1;
+        }
+        memset(page, 0, PAGE_SIZE);
+        pages[i] = (u32)page;
+    }
+
+    // 解除映射时释放的是发送方的引用，pages[] 持有的引用保留下来
+    sys_munmap((void*)start, count * PAGE_SIZE);
+    return 0;
+}
+
+u32 vmm_give_pages(const u32* pages, u32 count) {
+    vm_space_t* space = current_space();
+    if (space == &kernel_space || count == 0 || count > (USER_TOP - USER_BASE) >> PAGE_SHIFT) {
+        return 0;
+    }
+    u32 len = count * PAGE_SIZE;
+    u32 start = vma_find_gap(space, len);
+    vma_t* vma = kmalloc(sizeof(vma_t));
+    if (!start || !vma) {
+        kfree(vma);
+        return 0;
+    }
+    memset(vma, 0, sizeof(vma_t));
+    vma->start = start;
+    vma->end = start + len;
+    vma->flags = VM_READ | VM_WRITE | VM_ANON;
+    if (vma_insert(space, vma) < 0) {
+        kfree(vma);
+        return 0;
+    }
+
+    for (u32 i = 0; i < count; i++) {
+        // 仍被其他地址空间共享 (写时复制) 的页只读映射，写入时再复制
+        u32 flags = PTE_USER | (page_refcount((void*)pages[i]) > 1 ? PTE_COW : PTE_WRITE);
+        if (vmm_map_page(space, start + i * PAGE_SIZE, pages[i], flags) < 0) {
+            // 已映射的页随 VMA 一起释放，其余的在这里放掉
+            for (u32 j = i; j < count; j++) {
+                page_put((void*)pages[j]);
+            }
+            sys_munmap((void*)start, len);
+            return 0;
+        }
+        space->rss_pages++;
+    }
+    return start;
+}
+
+// fork 性能测试: 构造一个已填满的地址空间，比较写时复制与逐页复制的耗时
+#define FORK_BENCH_PAGES    1024    // 4MB
+
+void vmm_fork_benchmark(void) {
+    vm_space_t* space = vmm_create_space();
+    vma_t* vma = kmalloc(sizeof(vma_t));
+    if (!space || !vma) {
+        printf("fork 测试: 内存不足\n");
+        kfree(vma);
+        vmm_destroy_space(space);
+        return;
+    }
+    memset(vma, 0, sizeof(vma_t));
+    vma->start = USER_BASE;
+    vma->end = USER_BASE + FORK_BENCH_PAGES * PAGE_SIZE;
+    vma->flags = VM_READ | VM_WRITE | VM_ANON;
+    vma_insert(space, vma);
+
+    for (u32 i = 0; i < FORK_BENCH_PAGES; i++) {
+        void* page = page_alloc(0);
+        if (!page) {
+            break;
+        }
+        memset(page, i, PAGE_SIZE);
+        if (vmm_map_page(space, USER_BASE + i * PAGE_SIZE, (u32)page, PTE_USER | PTE_WRITE) < 0) {
+            page_free(page, 0);
+            break;
+        }
+        space->rss_pages++;
+    }
+
+    u64 start = clock_now();
+    vm_space_t* child = vmm_fork_space(space);
+    u64 cow_ns = clock_now() - start;
+
+    // 对比: 为每一页分配新页并复制内容
+    start = clock_now();
+    u32 copied = 0;
+    for (u32 i = 0; i < space->rss_pages; i++) {
+        u32* pte = vmm_get_pte(space, USER_BASE + i * PAGE_SIZE, 0);
+        void* page = page_alloc(0);
+        if (!pte || !page) {
+            page_free(page, 0);
+            break;
+        }
+        memcpy(page, (void*)(*pte & PTE_FRAME), PAGE_SIZE);
+        page_free(page, 0);
+        copied++;
+    }
+    u64 copy_ns = clock_now() - start;
+
+    if (child) {
+        printf("fork %u KB 地址空间: 写时复制 %u us, 逐页复制 %u us (%u 页)\n",
+               space->rss_pages * PAGE_SIZE / 1024,
+               (u32)div_u64_rem(cow_ns, NSEC_PER_USEC, NULL),
+               (u32)div_u64_rem(copy_ns, NSEC_PER_USEC, NULL), copied);
+    } else {
+        printf("fork 测试: 复制地址空间失败\n");
+    }
+    vmm_destroy_space(child);
+    vmm_destroy_space(space);
+}
@@ -0,0 +1,145 @@
+#ifndef VMM_H
+#define VMM_H
+
+#include "kernel.h"
+#include "mm.h"
+#include "irq.h"
+
+// 虚拟地址空间布局
+// [0, 1GB)           内核直接映射 (物理地址 = 虚拟地址)
+// [1GB, 3GB)         用户空间
+// [3GB, 4GB)         设备内存 (LAPIC、帧缓冲区等)，恒等映射
+#define USER_BASE       0x40000000
+#define USER_TOP        0xC0000000
+#define MMIO_BASE       0xC0000000
+
+// 页表项标志
+#define PTE_PRESENT     0x001
+#define PTE_WRITE       0x002
+#define PTE_USER        0x004
+#define PTE_PWT         0x008
+#define PTE_PCD         0x010
+#define PTE_ACCESSED    0x020
+#define PTE_DIRTY       0x040
+#define PTE_PS          0x080   // 页目录项: 4MB 大页
+#define PTE_GLOBAL      0x100
+#define PTE_COW         0x200   // 软件位: 写时复制 (与其他地址空间共享，只读)
+#define PTE_FRAME       0xFFFFF000
+
+// 4MB 大页 (CR4.PSE)
+#define LARGE_PAGE_SIZE 0x400000
+#define LARGE_PAGE_MASK (~(LARGE_PAGE_SIZE - 1))
+
+#define PDE_INDEX(va)   ((u32)(va) >> 22)
+#define PTE_INDEX(va)   (((u32)(va) >> 12) & 0x3FF)
+
+// 页错误码
+#define PF_PRESENT      0x01    // 页存在 (保护违例)
+#define PF_WRITE        0x02    // 写访问
+#define PF_USER         0x04    // 用户态访问
+
+// mmap 保护位与标志
+#define PROT_NONE       0x0
+#define PROT_READ       0x1
+#define PROT_WRITE      0x2
+#define PROT_EXEC       0x4
+
+#define MAP_SHARED      0x01
+#define MAP_PRIVATE     0x02
+#define MAP_FIXED       0x10
+#define MAP_ANONYMOUS   0x20
+
+#define MAP_FAILED      ((void*)-1)
+
+// VMA 标志
+#define VM_READ         0x01
+#define VM_WRITE        0x02
+#define VM_EXEC         0x04
+#define VM_ANON         0x08
+
+struct vma;
+
+// 文件映射等非匿名 VMA 的操作
+typedef struct vm_ops {
+    void (*open)(struct vma* vma);      // VMA 被复制 (fork) 或拆分时
+    void (*close)(struct vma* vma);     // VMA 被删除时
+    // 缺页时返回要映射的物理页 (已为本次映射加一次引用)，失败返回 0
+    u32 (*fault)(struct vma* vma, u32 va);
+} vm_ops_t;
+
+// 虚拟内存区域 (按起始地址组织为 AVL 树)
+typedef struct vma {
+    u32 start;              // 起始地址 (页对齐)
+    u32 end;                // 结束地址 (不含，页对齐)
+    u32 flags;              // VM_*
+    const vm_ops_t* ops;    // NULL 表示匿名映射
+    void* private_data;
+    u32 offset;             // start 对应的文件偏移
+    u32 filesz;             // 从 start 起由文件提供的字节数，其后补零
+    int height;
+    struct vma* left;
+    struct vma* right;
+} vma_t;
+
+// 地址空间
+typedef struct vm_space {
+    u32* page_dir;          // 页目录 (直接映射中的地址)
+    vma_t* vma_root;        // VMA 树
+    vma_t* vma_cache;       // 最近一次查找命中的 VMA
+    u32 vma_count;
+    u32 rss_pages;          // 已分配的物理页数
+    u32 ioring;             // 异步 I/O 环的用户地址 (0 表示没有)
+    u32 ioring_entries;
+} vm_space_t;
+
+// 分页初始化
+void vmm_init(void);
+
+// 地址空间管理
+vm_space_t* vmm_kernel_space(void);
+vm_space_t* vmm_current_space(void);
+vm_space_t* vmm_create_space(void);
+void vmm_destroy_space(vm_space_t* space);
+void vmm_switch(vm_space_t* space);
+
+// 复制地址空间 (写时复制): 双方的可写页都改为只读共享，写入时再复制
+vm_space_t* vmm_fork_space(vm_space_t* src);
+
+// 页映射
+int vmm_map_page(vm_space_t* space, u32 va, u32 pa, u32 flags);
+u32 vmm_unmap_page(vm_space_t* space, u32 va);
+u32* vmm_get_pte(vm_space_t* space, u32 va, int create);
+void* vmm_map_mmio(u32 phys, u32 size);
+
+// 内核区 4MB 大页映射 (va 与 pa 须 4MB 对齐，CPU 不支持或该处已有页表时返回 -1)
+int vmm_map_large(u32 va, u32 pa, u32 flags);
+int vmm_large_pages(void);
+
+// 在地址空间之间移交物理页 (当前地址空间，零拷贝 IPC 使用)
+// vmm_take_pages: 把 [start, start + count 页) 的匿名映射摘下，页的引用转给 pages[]
+// vmm_give_pages: 把 pages[] 映射到一段新的匿名区域并接管其引用，返回用户地址，失败返回 0
+int vmm_take_pages(u32 start, u32 count, u32* pages);
+u32 vmm_give_pages(const u32* pages, u32 count);
+
+// 页错误处理
+void page_fault_handler(irq_frame_t* frame);
+
+// 当前地址空间中 [addr, addr + size) 是否都在允许这种访问的 VMA 内。
+// 系统调用访问用户内存之前检查，之后的缺页都能按需处理
+int vmm_user_access_ok(u32 addr, u32 size, int write);
+
+// VMA 树
+vma_t* vma_find(vm_space_t* space, u32 addr);
+vma_t* vma_find_overlap(vm_space_t* space, u32 start, u32 end);
+int vma_insert(vm_space_t* space, vma_t* vma);
+void vma_remove(vm_space_t* space, vma_t* vma);
+u32 vma_find_gap(vm_space_t* space, u32 length);
+
+// 系统调用
+void* sys_mmap(void* addr, size_t length, int prot, int flags);
+int sys_munmap(void* addr, size_t length);
+
+// fork 性能测试
+void vmm_fork_benchmark(void);
+
+#endif // VMM_H
@@ -0,0 +1,75 @@
+#include "wait.h"
+#include "sched.h"
+
+void wait_queue_init(wait_queue_t* wq) {
+    wq->lock = (spinlock_t)SPINLOCK_INIT;
+    wq->head = NULL;
+    wq->tail = NULL;
+}
+
+static void wait_unlink(wait_queue_t* wq, wait_entry_t* wait) {
+    if (wait->prev) {
+        wait->prev->next = wait->next;
+    } else {
+        wq->head = wait->next;
+    }
+    if (wait->next) {
+        wait->next->prev = wait->prev;
+    } else {
+        wq->tail = wait->prev;
+    }
+    wait->next = NULL;
+    wait->prev = NULL;
+    wait->queued = 0;
+}
+
+void prepare_to_wait(wait_queue_t* wq, wait_entry_t* wait) {
+    task_t* task = current_task();
+    u32 flags = spin_lock_irqsave(&wq->lock);
+    if (!wait->queued) {
+        wait->task = task;
+        wait->next = NULL;
+        wait->prev = wq->tail;
+        if (wq->tail) {
+            wq->tail->next = wait;
+        } else {
+            wq->head = wait;
+        }
+        wq->tail = wait;
+        wait->queued = 1;
+    }
+    // 在队列锁内置为阻塞，唤醒者一定能看到
+    task->state = TASK_BLOCKED;
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+void finish_wait(wait_queue_t* wq, wait_entry_t* wait) {
+    task_t* task = current_task();
+    u32 flags = spin_lock_irqsave(&task->lock);
+    task->state = TASK_RUNNING;
+    spin_unlock_irqrestore(&task->lock, flags);
+
+    if (wait->queued) {
+        flags = spin_lock_irqsave(&wq->lock);
+        if (wait->queued) {
+            wait_unlink(wq, wait);
+        }
+        spin_unlock_irqrestore(&wq->lock, flags);
+    }
+}
+
+int wake_up_nr(wait_queue_t* wq, int nr) {
+    int woken = 0;
+    u32 flags = spin_lock_irqsave(&wq->lock);
+    wait_entry_t* wait = wq->head;
+    while (wait && (nr <= 0 || woken < nr)) {
+        wait_entry_t* next = wait->next;
+        // 已被唤醒但还没运行到 finish_wait 的任务不计数
+        if (sched_wakeup(wait->task)) {
+            woken++;
+        }
+        wait = next;
+    }
+    spin_unlock_irqrestore(&wq->lock, flags);
+    return woken;
+}
@@ -0,0 +1,65 @@
+#ifndef WAIT_H
+#define WAIT_H
+
+#include "kernel.h"
+#include "spinlock.h"
+
+struct task;
+
+// 等待队列: 阻塞的任务离开运行队列，由事件的产生者精确唤醒
+// 用法 (与 Linux 相同的先登记再检查，避免丢失唤醒):
+//     wait_entry_t wait;
+//     for (;;) {
+//         prepare_to_wait(wq, &wait);
+//         if (条件成立) break;
+//         schedule();
+//     }
+//     finish_wait(wq, &wait);
+// 唤醒者先使条件成立再调用 wake_up，可以在中断中调用。
+
+typedef struct wait_entry {
+    struct task* task;
+    struct wait_entry* next;
+    struct wait_entry* prev;
+    int queued;
+} wait_entry_t;
+
+typedef struct wait_queue {
+    spinlock_t lock;
+    wait_entry_t* head;
+    wait_entry_t* tail;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT     { SPINLOCK_INIT, NULL, NULL }
+
+void wait_queue_init(wait_queue_t* wq);
+
+// 登记到队列尾并把当前任务置为阻塞 (可重复调用)
+void prepare_to_wait(wait_queue_t* wq, wait_entry_t* wait);
+
+// 恢复运行状态并离开队列
+void finish_wait(wait_queue_t* wq, wait_entry_t* wait);
+
+// 按登记顺序唤醒最多 nr 个仍在阻塞的任务 (nr <= 0 表示全部)，返回唤醒的个数
+int wake_up_nr(wait_queue_t* wq, int nr);
+
+static inline int wake_up(wait_queue_t* wq) {
+    return wake_up_nr(wq, 0);
+}
+
+// 阻塞直到条件成立
+#define wait_event(wq, condition)                   \
+    do {                                            \
+        wait_entry_t __wait;                        \
+        __wait.queued = 0;                          \
+        for (;;) {                                  \
+            prepare_to_wait((wq), &__wait);         \
+            if (condition) {                        \
+                break;                              \
+            }                                       \
+            schedule();                             \
+        }                                           \
+        finish_wait((wq), &__wait);                 \
+    } while (0)
+
+#endif // WAIT_H
@@ -0,0 +1,36 @@
+#!/bin/sh
+# 从 nm -n 的输出生成内核符号表 (C 源文件)，供采样分析器和异常报告解析地址
+# 用法: nm -n kernel.bin | sh tools/ksyms.sh > kernel/ksyms_gen.c
+# 输入为空时生成空表 (第一遍链接使用)
+
+echo "// 由 tools/ksyms.sh 生成，请勿编辑"
+echo "#include \"ksyms.h\""
+echo ""
+awk '
+BEGIN {
+    n = 0
+}
+NF == 3 && $2 ~ /^[tTwW]$/ && $3 !~ /^\./ {
+    addr[n] = $1
+    name[n] = $3
+    n++
+}
+END {
+    printf "const u32 ksym_count = %d;\n\n", n
+    printf "const u32 ksym_addrs[] = {\n"
+    for (i = 0; i < n; i++) {
+        printf "    0x%s,\n", addr[i]
+    }
+    if (n == 0) {
+        printf "    0\n"
+    }
+    printf "};\n\n"
+    printf "const char* const ksym_names[] = {\n"
+    for (i = 0; i < n; i++) {
+        printf "    \"%s\",\n", name[i]
+    }
+    if (n == 0) {
+        printf "    0\n"
+    }
+    printf "};\n"
+}'
@@ -0,0 +1,216 @@
+// 在宿主机上生成 QYFS 镜像，供 QEMU 的 -initrd 或 GRUB 的 module 作为引导模块加载
+// 用法: mkqyfs <镜像文件> <大小KB> [源目录]
+// 源目录中的普通文件和子目录 (递归) 被复制到镜像的根目录下。
+// 镜像按顺序分配，每个文件和目录的内容都是一个连续的 extent。
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "../fs/qyfs.h"
+
+static uint8_t* image;
+static qyfs_super_t sb;
+
+static uint8_t* block_ptr(uint32_t block) {
+    return image + (size_t)block * QYFS_BLOCK_SIZE;
+}
+
+static void bitmap_set(uint32_t start, uint32_t bit) {
+    uint8_t* map = block_ptr(start);
+    map[bit >> 3] |= 1 << (bit & 7);
+}
+
+static qyfs_inode_t* inode_ptr(uint32_t ino) {
+    return (qyfs_inode_t*)(block_ptr(sb.inode_table + ino / QYFS_INODES_PER_BLOCK) +
+                           (ino % QYFS_INODES_PER_BLOCK) * QYFS_INODE_SIZE);
+}
+
+// 连续分配 count 个块
+static uint32_t alloc_blocks(uint32_t count) {
+    if (count > sb.total_blocks - sb.alloc_hint) {
+        fprintf(stderr, "mkqyfs: 镜像空间不足\n");
+        exit(1);
+    }
+    uint32_t start = sb.alloc_hint;
+    for (uint32_t i = 0; i < count; i++) {
+        bitmap_set(sb.block_bitmap, start + i);
+    }
+    sb.alloc_hint += count;
+    sb.free_blocks -= count;
+    return start;
+}
+
+static uint32_t alloc_inode(void) {
+    uint32_t ino = sb.inode_count - sb.free_inodes;
+    if (sb.free_inodes == 0) {
+        fprintf(stderr, "mkqyfs: inode 不足\n");
+        exit(1);
+    }
+    bitmap_set(sb.inode_bitmap, ino);
+    sb.free_inodes--;
+    return ino;
+}
+
+// 为 inode 分配 size 字节的连续空间，返回数据起始地址
+static uint8_t* inode_fill(qyfs_inode_t* inode, uint64_t size) {
+    uint32_t blocks = (uint32_t)((size + QYFS_BLOCK_SIZE - 1) / QYFS_BLOCK_SIZE);
+    inode->size = size;
+    if (blocks == 0) {
+        return NULL;
+    }
+    uint32_t start = alloc_blocks(blocks);
+    inode->nr_extents = 1;
+    inode->extents[0].file_block = 0;
+    inode->extents[0].start = start;
+    inode->extents[0].count = blocks;
+    return block_ptr(start);
+}
+
+static void inode_init(qyfs_inode_t* inode, uint16_t type, const struct stat* st) {
+    memset(inode, 0, sizeof(*inode));
+    inode->type = type;
+    inode->permissions = QYFS_PERM_READ | QYFS_PERM_WRITE;
+    if (type == QYFS_FT_DIR || (st && (st->st_mode & S_IXUSR))) {
+        inode->permissions |= QYFS_PERM_EXECUTE;
+    }
+    inode->links = type == QYFS_FT_DIR ? 2 : 1;
+    if (st) {
+        inode->create_time = (uint64_t)st->st_ctime;
+        inode->modify_time = (uint64_t)st->st_mtime;
+        inode->access_time = (uint64_t)st->st_atime;
+    }
+}
+
+static void add_file(uint32_t ino, const char* path, const struct stat* st) {
+    qyfs_inode_t* inode = inode_ptr(ino);
+    inode_init(inode, QYFS_FT_FILE, st);
+    uint8_t* data = inode_fill(inode, (uint64_t)st->st_size);
+    if (!data) {
+        return;
+    }
+    FILE* file = fopen(path, "rb");
+    if (!file || fread(data, 1, st->st_size, file) != (size_t)st->st_size) {
+        fprintf(stderr, "mkqyfs: 无法读取 %s\n", path);
+        exit(1);
+    }
+    fclose(file);
+}
+
+typedef struct {
+    char name[QYFS_NAME_LEN + 1];
+    uint32_t ino;
+    uint8_t type;
+} entry_t;
+
+// 递归复制目录 (source 为 NULL 时只建立 "." 和 "..")
+static void add_dir(uint32_t ino, uint32_t parent, const char* source, const struct stat* st) {
+    entry_t* entries = NULL;
+    size_t count = 0;
+    DIR* dir = source ? opendir(source) : NULL;
+    struct dirent* de;
+
+    inode_init(inode_ptr(ino), QYFS_FT_DIR, st);
+    while (dir && (de = readdir(dir)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+            continue;
+        }
+        if (strlen(de->d_name) > QYFS_NAME_LEN) {
+            fprintf(stderr, "mkqyfs: 跳过名字过长的 %s/%s\n", source, de->d_name);
+            continue;
+        }
+
+        size_t len = strlen(source) + strlen(de->d_name) + 2;
+        char* path = malloc(len);
+        struct stat child_st;
+        snprintf(path, len, "%s/%s", source, de->d_name);
+        if (stat(path, &child_st) < 0 || !(S_ISREG(child_st.st_mode) || S_ISDIR(child_st.st_mode))) {
+            free(path);
+            continue;
+        }
+
+        entries = realloc(entries, (count + 1) * sizeof(entry_t));
+        entry_t* entry = &entries[count++];
+        memset(entry, 0, sizeof(*entry));
+        strcpy(entry->name, de->d_name);
+        entry->ino = alloc_inode();
+        if (S_ISDIR(child_st.st_mode)) {
+            entry->type = QYFS_FT_DIR;
+            add_dir(entry->ino, ino, path, &child_st);
+            inode_ptr(ino)->links++; // 子目录的 ".."
+        } else {
+            entry->type = QYFS_FT_FILE;
+            add_file(entry->ino, path, &child_st);
+        }
+        free(path);
+    }
+    if (dir) {
+        closedir(dir);
+    }
+
+    // 子项的内容已经分配，目录内容放在它们之后
+    qyfs_dirent_t* dirents = (qyfs_dirent_t*)inode_fill(inode_ptr(ino), (count + 2) * QYFS_DIRENT_SIZE);
+    for (size_t i = 0; i < count + 2; i++) {
+        qyfs_dirent_t* dirent = &dirents[i];
+        if (i < 2) {
+            dirent->inode = i == 0 ? ino : parent;
+            dirent->type = QYFS_FT_DIR;
+            strcpy(dirent->name, i == 0 ? "." : "..");
+        } else {
+            dirent->inode = entries[i - 2].ino;
+            dirent->type = entries[i - 2].type;
+            strcpy(dirent->name, entries[i - 2].name);
+        }
+        dirent->name_len = (uint8_t)strlen(dirent->name);
+    }
+    free(entries);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || argc > 4) {
+        fprintf(stderr, "用法: %s <镜像文件> <大小KB> [源目录]\n", argv[0]);
+        return 1;
+    }
+
+    uint32_t blocks = (uint32_t)(strtoul(argv[2], NULL, 0) * 1024 / QYFS_BLOCK_SIZE);
+    uint32_t inodes = blocks / 4 < 64 ? 64 : blocks / 4;
+    qyfs_layout(&sb, blocks, inodes);
+    if (sb.data_start >= blocks) {
+        fprintf(stderr, "mkqyfs: 镜像太小\n");
+        return 1;
+    }
+
+    image = calloc(blocks, QYFS_BLOCK_SIZE);
+    if (!image) {
+        fprintf(stderr, "mkqyfs: 内存不足\n");
+        return 1;
+    }
+
+    // 元数据区已用，inode 0 保留
+    for (uint32_t b = 0; b < sb.data_start; b++) {
+        bitmap_set(sb.block_bitmap, b);
+    }
+    bitmap_set(sb.inode_bitmap, 0);
+
+    struct stat st;
+    const char* source = argc == 4 ? argv[3] : NULL;
+    if (source && (stat(source, &st) < 0 || !S_ISDIR(st.st_mode))) {
+        fprintf(stderr, "mkqyfs: %s 不是目录，生成空文件系统\n", source);
+        source = NULL;
+    }
+    uint32_t root = alloc_inode();
+    add_dir(root, root, source, source ? &st : NULL);
+
+    memcpy(image, &sb, sizeof(sb));
+    FILE* out = fopen(argv[1], "wb");
+    if (!out || fwrite(image, QYFS_BLOCK_SIZE, blocks, out) != blocks) {
+        fprintf(stderr, "mkqyfs: 无法写入 %s\n", argv[1]);
+        return 1;
+    }
+    fclose(out);
+    printf("mkqyfs: %s, %u 块 (%u 空闲), %u 个 inode (%u 空闲)\n", argv[1],
+           sb.total_blocks, sb.free_blocks, sb.inode_count, sb.free_inodes);
+    free(image);
+    return 0;
+}